@@ -0,0 +1,84 @@
+#pragma once
+// 微基准框架：每个用例先 setup（不计时）构造订单簿状态与输入，再计时执行 run，
+// 重复 reps 次取最小值与中位数。输入由固定种子生成，同一参数的多次运行可以直接对比。
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+// 阻止编译器把结果未被使用的计算整个优化掉
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Case
+{
+    std::string name;           // 形如 group/variant/param=value
+    size_t ops;                 // 每次 run 的操作数
+    std::function<void()> setup;
+    std::function<void()> run;
+};
+
+struct Result
+{
+    std::string name;
+    size_t ops;
+    double minNs;
+    double medianNs;
+    double maxNs;
+};
+
+class Harness
+{
+public:
+    void add(std::string name, size_t ops, std::function<void()> setup, std::function<void()> run)
+    {
+        cases_.push_back({std::move(name), ops, std::move(setup), std::move(run)});
+    }
+
+    // filter 为空时运行全部用例，否则只运行名字包含 filter 的用例
+    std::vector<Result> runAll(const std::string &filter, int reps, bool csv) const
+    {
+        std::vector<Result> results;
+        if (csv)
+            std::printf("name,ops,min_ns_per_op,median_ns_per_op,max_ns_per_op\n");
+        else
+            std::printf("%-48s %10s %12s %12s %12s\n", "benchmark", "ops", "min ns/op", "median", "max");
+        for (const Case &c : cases_)
+        {
+            if (!filter.empty() && c.name.find(filter) == std::string::npos)
+                continue;
+            std::vector<double> samples;
+            for (int r = 0; r < reps; ++r)
+            {
+                if (c.setup)
+                    c.setup();
+                auto start = std::chrono::steady_clock::now();
+                c.run();
+                auto end = std::chrono::steady_clock::now();
+                samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() /
+                                  static_cast<double>(c.ops));
+            }
+            std::sort(samples.begin(), samples.end());
+            Result res{c.name, c.ops, samples.front(), samples[samples.size() / 2], samples.back()};
+            if (csv)
+                std::printf("%s,%zu,%.2f,%.2f,%.2f\n", res.name.c_str(), res.ops, res.minNs, res.medianNs, res.maxNs);
+            else
+                std::printf("%-48s %10zu %12.1f %12.1f %12.1f\n", res.name.c_str(), res.ops, res.minNs,
+                            res.medianNs, res.maxNs);
+            std::fflush(stdout);
+            results.push_back(std::move(res));
+        }
+        return results;
+    }
+
+private:
+    std::vector<Case> cases_;
+};
+} // namespace bench
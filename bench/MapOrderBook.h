@@ -0,0 +1,42 @@
+#pragma once
+// 基线实现：std::map<double, std::list<Order>> 订单簿，仅用于基准对比
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include "core/Order.h"
+#include "core/ExecutionReport.h"
+class MapOrderBook
+{
+public:
+    using MatchCallback = std::function<void(const ExecutionReport &)>;
+    MapOrderBook();
+    ~MapOrderBook() = default;
+
+    bool matchOrder(Order order, MatchCallback callback);
+    bool cancelOrder(const OrderId &id, MatchCallback callback);
+    double getLastTradedPrice()
+    {
+        return lastTradedPrice;
+    }
+
+private:
+    template <typename BookType, typename TradePredicate>
+    void matchAgainstBook(Order &order, BookType &book, TradePredicate canTrade, MatchCallback &callback);
+    void generateReport(
+        const Order &order,
+        int32_t last_shares,
+        ExecType type,
+        MatchCallback &callback);
+    double lastTradedPrice = 0.0;
+    std::map<double, std::list<Order>, std::greater<double>> buyBook;
+    std::map<double, std::list<Order>, std::less<double>> sellBook;
+
+    struct OrderHandle
+    {
+        double price;
+        std::list<Order>::iterator iter;
+        OrderSide side;
+    };
+    std::unordered_map<std::string, OrderHandle> orderIndex;
+};
\ No newline at end of file
@@ -0,0 +1,476 @@
+// 微基准：订单簿撮合 / 撤单、消息编解码、订单序列化
+// 用法：micro_bench [--filter=SUBSTR] [--reps=N] [--seed=N] [--csv]
+// 订单簿状态与订单流由固定种子生成，参数写在用例名里，结果可跨提交对比
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "BenchHarness.h"
+#include "core/OrderBook.h"
+#include "protocol/MessageCodec.h"
+
+namespace
+{
+constexpr double TICK = 0.01;
+constexpr Ticks MID_TICKS = 100000;
+constexpr Ticks SWEEP_BASE_TICKS = 50000; // 扫单用例的卖方起点，留足向上的档位
+
+InstrumentSpec benchSpec()
+{
+    InstrumentSpec spec;
+    spec.tick_size = TICK;
+    spec.base_price = 0.0;
+    spec.num_levels = 1u << 18;
+    return spec;
+}
+
+Order makeOrder(uint64_t id, OrderSide side, Ticks ticks, int32_t qty)
+{
+    Order o{};
+    o.user_id = UserId::fromString("bench");
+    o.order_id = OrderId::fromString("B" + std::to_string(id));
+    o.side = side;
+    o.price = static_cast<double>(ticks) * TICK;
+    o.quantity = qty;
+    o.remaining_quantity = qty;
+    o.timestamp = id;
+    return o;
+}
+
+// 订单簿 + 输入订单流，setup 时整体重建
+struct BookState
+{
+    std::unique_ptr<OrderBook> book;
+    std::vector<Order> input;
+    std::vector<OrderId> cancels;
+    size_t reports = 0;
+    // 回报计数；订单簿按具体类型调用，与撮合线程上的回报投递方式一致
+    struct CountingSink
+    {
+        size_t *reports;
+        void operator()(const ExecutionReport &report) const
+        {
+            ++*reports;
+            bench::doNotOptimize(report.leaves_qty);
+        }
+    } sink{&reports};
+
+    void reset(uint32_t poolCapacity)
+    {
+        book.reset();
+        book = std::make_unique<OrderBook>(benchSpec(), poolCapacity);
+        input.clear();
+        cancels.clear();
+        reports = 0;
+    }
+};
+
+// 不交叉的挂单：买单在中间价以下、卖单在中间价以上，每侧分布在 levels 个档位
+std::vector<Order> passiveOrders(std::mt19937_64 &rng, uint64_t firstId, size_t count, int levels)
+{
+    std::uniform_int_distribution<int> offset(1, levels);
+    std::uniform_int_distribution<int> qty(1, 100);
+    std::vector<Order> orders;
+    orders.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        OrderSide side = (i & 1) ? OrderSide::BUY : OrderSide::SELL;
+        Ticks ticks = side == OrderSide::BUY ? MID_TICKS - offset(rng) : MID_TICKS + offset(rng);
+        orders.push_back(makeOrder(firstId + i, side, ticks, qty(rng)));
+    }
+    return orders;
+}
+
+void prefill(BookState &st, std::mt19937_64 &rng, size_t depth, int levels)
+{
+    for (const Order &o : passiveOrders(rng, 0, depth, levels))
+        st.book->matchOrder(o, st.sink);
+}
+
+void addOrderBookCases(bench::Harness &h, uint64_t seed)
+{
+    // 挂单插入：不同既有深度下追加不交叉的订单
+    for (size_t depth : {size_t(0), size_t(10000), size_t(100000)})
+    {
+        constexpr size_t BATCH = 20000;
+        constexpr int LEVELS = 1000;
+        auto st = std::make_shared<BookState>();
+        h.add("order_book/passive_insert/depth=" + std::to_string(depth) + "/levels=" + std::to_string(LEVELS),
+              BATCH,
+              [st, seed, depth]
+              {
+                  std::mt19937_64 rng(seed);
+                  st->reset(static_cast<uint32_t>(depth + BATCH));
+                  prefill(*st, rng, depth, LEVELS);
+                  st->input = passiveOrders(rng, depth, BATCH, LEVELS);
+              },
+              [st]
+              {
+                  for (const Order &o : st->input)
+                      st->book->matchOrder(o, st->sink);
+              });
+    }
+
+    // 主动单扫过 N 个档位：卖方每档一笔，每笔买单恰好吃掉接下来的 N 档
+    for (int levels : {1, 10, 100})
+    {
+        constexpr size_t SWEEPS = 2000;
+        auto st = std::make_shared<BookState>();
+        h.add("order_book/aggressive_sweep/levels=" + std::to_string(levels), SWEEPS,
+              [st, levels]
+              {
+                  size_t resting = SWEEPS * static_cast<size_t>(levels);
+                  st->reset(static_cast<uint32_t>(resting + SWEEPS));
+                  for (size_t i = 0; i < resting; ++i)
+                      st->book->matchOrder(makeOrder(i, OrderSide::SELL, SWEEP_BASE_TICKS + static_cast<Ticks>(i), 10),
+                                           st->sink);
+                  for (size_t i = 0; i < SWEEPS; ++i)
+                  {
+                      Ticks limit = SWEEP_BASE_TICKS + static_cast<Ticks>((i + 1) * levels - 1);
+                      st->input.push_back(makeOrder(resting + i, OrderSide::BUY, limit, 10 * levels));
+                  }
+              },
+              [st]
+              {
+                  for (const Order &o : st->input)
+                      st->book->matchOrder(o, st->sink);
+              });
+    }
+
+    // 部分成交：同一档位 R 笔 10 股卖单，每笔 5 股买单只吃掉队首的一半
+    for (size_t restingCount : {size_t(1000), size_t(10000)})
+    {
+        auto st = std::make_shared<BookState>();
+        h.add("order_book/partial_fill/resting=" + std::to_string(restingCount), restingCount * 2,
+              [st, restingCount]
+              {
+                  st->reset(static_cast<uint32_t>(restingCount * 3));
+                  for (size_t i = 0; i < restingCount; ++i)
+                      st->book->matchOrder(makeOrder(i, OrderSide::SELL, MID_TICKS, 10), st->sink);
+                  for (size_t i = 0; i < restingCount * 2; ++i)
+                      st->input.push_back(makeOrder(restingCount + i, OrderSide::BUY, MID_TICKS, 5));
+              },
+              [st]
+              {
+                  for (const Order &o : st->input)
+                      st->book->matchOrder(o, st->sink);
+              });
+    }
+
+    // 撤单：不同深度的订单簿中按随机顺序撤掉一批挂单
+    for (size_t depth : {size_t(1000), size_t(100000), size_t(500000)})
+    {
+        constexpr int LEVELS = 1000;
+        size_t batch = std::min(depth, size_t(10000));
+        auto st = std::make_shared<BookState>();
+        h.add("order_book/cancel/depth=" + std::to_string(depth) + "/levels=" + std::to_string(LEVELS), batch,
+              [st, seed, depth, batch]
+              {
+                  std::mt19937_64 rng(seed);
+                  st->reset(static_cast<uint32_t>(depth));
+                  auto orders = passiveOrders(rng, 0, depth, LEVELS);
+                  for (const Order &o : orders)
+                      st->book->matchOrder(o, st->sink);
+                  std::shuffle(orders.begin(), orders.end(), rng);
+                  for (size_t i = 0; i < batch; ++i)
+                      st->cancels.push_back(orders[i].order_id);
+              },
+              [st]
+              {
+                  for (const OrderId &id : st->cancels)
+                      st->book->cancelOrder(id, st->sink);
+              });
+    }
+
+    // 改价 / 改量：深订单簿上随机挑挂单重新报价，对比撤单 + 新单与一条改单
+    {
+        constexpr size_t DEPTH = 100000;
+        constexpr size_t REQUOTES = 20000;
+        constexpr int LEVELS = 1000;
+        for (const char *mode : {"cancel_new", "replace_price", "replace_qty_down"})
+        {
+            auto st = std::make_shared<BookState>();
+            auto requotes = std::make_shared<std::vector<Order>>();
+            bool cancelNew = std::strcmp(mode, "cancel_new") == 0;
+            bool qtyDown = std::strcmp(mode, "replace_qty_down") == 0;
+            h.add(std::string("order_book/requote/") + mode + "/depth=" + std::to_string(DEPTH), REQUOTES,
+                  [st, requotes, seed, qtyDown]
+                  {
+                      std::mt19937_64 rng(seed);
+                      st->reset(static_cast<uint32_t>(DEPTH + 1));
+                      auto orders = passiveOrders(rng, 0, DEPTH, LEVELS);
+                      for (Order &o : orders)
+                      {
+                          o.quantity = o.remaining_quantity = 1000; // 留足减量空间
+                          st->book->matchOrder(o, st->sink);
+                      }
+                      // 每个订单至多重报一次：改价仍在本方一侧，不与对手方交叉
+                      std::shuffle(orders.begin(), orders.end(), rng);
+                      std::uniform_int_distribution<int> offset(1, LEVELS);
+                      requotes->clear();
+                      for (size_t i = 0; i < REQUOTES; ++i)
+                      {
+                          Order o = orders[i];
+                          if (qtyDown)
+                          {
+                              o.quantity = o.remaining_quantity = 500;
+                          }
+                          else
+                          {
+                              Ticks ticks = o.side == OrderSide::BUY ? MID_TICKS - offset(rng) : MID_TICKS + offset(rng);
+                              o.price = static_cast<double>(ticks) * TICK;
+                          }
+                          requotes->push_back(o);
+                      }
+                  },
+                  [st, requotes, cancelNew]
+                  {
+                      for (const Order &o : *requotes)
+                      {
+                          if (cancelNew)
+                          {
+                              st->book->cancelOrder(o.order_id, st->sink);
+                              st->book->matchOrder(o, st->sink);
+                          }
+                          else
+                          {
+                              st->book->replaceOrder(o.order_id, o.price, o.remaining_quantity, st->sink);
+                          }
+                      }
+                  });
+        }
+    }
+
+    // 撤回做市商的全部报价：逐笔撤单与一次按用户批量撤单（其他用户的挂单作为背景深度）
+    {
+        constexpr size_t DEPTH = 100000;
+        constexpr size_t QUOTES = 2000;
+        constexpr int LEVELS = 1000;
+        for (const char *mode : {"cancel_each", "mass_cancel_user"})
+        {
+            auto st = std::make_shared<BookState>();
+            bool mass = std::strcmp(mode, "mass_cancel_user") == 0;
+            h.add(std::string("order_book/pull_quotes/") + mode + "/quotes=" + std::to_string(QUOTES) +
+                      "/depth=" + std::to_string(DEPTH),
+                  QUOTES,
+                  [st, seed]
+                  {
+                      std::mt19937_64 rng(seed);
+                      st->reset(static_cast<uint32_t>(DEPTH + QUOTES));
+                      prefill(*st, rng, DEPTH, LEVELS);
+                      st->cancels.clear();
+                      for (Order &o : passiveOrders(rng, DEPTH, QUOTES, LEVELS))
+                      {
+                          o.user_id = UserId::fromString("mm");
+                          st->book->matchOrder(o, st->sink, 7);
+                          st->cancels.push_back(o.order_id);
+                      }
+                  },
+                  [st, mass]
+                  {
+                      if (mass)
+                      {
+                          MassCancelFilter filter{MassCancelScope::USER, MassCancelFilter::BOTH_SIDES,
+                                                  UserId::fromString("mm"), 0};
+                          st->book->massCancel(filter, st->sink);
+                          return;
+                      }
+                      for (const OrderId &id : st->cancels)
+                          st->book->cancelOrder(id, st->sink);
+                  });
+        }
+    }
+
+    // FOK 可行性：限价内 N 个档位的挂单量不够，每笔都只读价位聚合后整单撤销（订单簿不变）
+    for (int levels : {1, 10, 100})
+    {
+        constexpr size_t ORDERS = 20000;
+        constexpr size_t PER_LEVEL = 10;
+        auto st = std::make_shared<BookState>();
+        h.add("order_book/fok_reject/levels=" + std::to_string(levels) + "/orders_per_level=" +
+                  std::to_string(PER_LEVEL),
+              ORDERS,
+              [st, levels]
+              {
+                  size_t resting = static_cast<size_t>(levels) * PER_LEVEL;
+                  st->reset(static_cast<uint32_t>(resting + 1));
+                  for (size_t i = 0; i < resting; ++i)
+                      st->book->matchOrder(makeOrder(i, OrderSide::SELL, MID_TICKS + static_cast<Ticks>(i / PER_LEVEL), 10),
+                                           st->sink);
+                  for (size_t i = 0; i < ORDERS; ++i)
+                  {
+                      Order o = makeOrder(resting + i, OrderSide::BUY, MID_TICKS + levels - 1,
+                                          static_cast<int32_t>(resting * 10 + 1));
+                      o.type = OrderType::FOK;
+                      st->input.push_back(o);
+                  }
+              },
+              [st]
+              {
+                  for (const Order &o : st->input)
+                      st->book->matchOrder(o, st->sink);
+              });
+    }
+
+    // 深度查询：深订单簿上取每侧前 N 档的聚合
+    for (size_t levels : {size_t(5), size_t(20)})
+    {
+        constexpr size_t QUERIES = 100000;
+        constexpr size_t DEPTH = 100000;
+        constexpr int LEVELS = 1000;
+        auto st = std::make_shared<BookState>();
+        h.add("order_book/depth_query/depth=" + std::to_string(DEPTH) + "/top=" + std::to_string(levels), QUERIES,
+              [st, seed]
+              {
+                  std::mt19937_64 rng(seed);
+                  st->reset(static_cast<uint32_t>(DEPTH));
+                  prefill(*st, rng, DEPTH, LEVELS);
+              },
+              [st, levels]
+              {
+                  DepthLevel out[20];
+                  for (size_t i = 0; i < QUERIES; ++i)
+                  {
+                      OrderSide side = (i & 1) ? OrderSide::BUY : OrderSide::SELL;
+                      bench::doNotOptimize(st->book->depth(side, out, levels));
+                      bench::doNotOptimize(out[0].quantity);
+                  }
+              });
+    }
+}
+
+Order sampleOrder(uint64_t id)
+{
+    return makeOrder(id, (id & 1) ? OrderSide::BUY : OrderSide::SELL, MID_TICKS + static_cast<Ticks>(id % 100), 100);
+}
+
+void addCodecCases(bench::Harness &h)
+{
+    constexpr size_t COUNT = 100000;
+    auto payload = std::make_shared<std::vector<uint8_t>>(sampleOrder(1).serialize());
+
+    // 分配式编码（返回 std::vector）
+    h.add("codec/encode/payload=" + std::to_string(payload->size()), COUNT, nullptr,
+          [payload]
+          {
+              for (size_t i = 0; i < COUNT; ++i)
+                  bench::doNotOptimize(MessageCodec::encode(MessageType::NEW_ORDER, *payload).data()[0]);
+          });
+
+    // 只写帧头、payload 由调用方写在其后（回报发送路径的用法）
+    auto out = std::make_shared<std::vector<uint8_t>>(COUNT * (MessageCodec::HEADER_SIZE + payload->size()));
+    h.add("codec/encode_header/payload=" + std::to_string(payload->size()), COUNT, nullptr,
+          [payload, out]
+          {
+              uint8_t *p = out->data();
+              for (size_t i = 0; i < COUNT; ++i)
+              {
+                  MessageCodec::encodeHeader(p, MessageType::NEW_ORDER, static_cast<uint16_t>(payload->size()));
+                  std::memcpy(p + MessageCodec::HEADER_SIZE, payload->data(), payload->size());
+                  p += MessageCodec::HEADER_SIZE + payload->size();
+              }
+              bench::doNotOptimize(out->data()[0]);
+          });
+
+    // 在连续的帧流上逐帧解码（接收路径的用法）
+    auto stream = std::make_shared<std::vector<uint8_t>>();
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        auto frame = MessageCodec::encode(MessageType::NEW_ORDER, sampleOrder(i).serialize());
+        stream->insert(stream->end(), frame.begin(), frame.end());
+    }
+    h.add("codec/decode/payload=" + std::to_string(payload->size()), COUNT, nullptr,
+          [stream]
+          {
+              const uint8_t *p = stream->data();
+              size_t left = stream->size();
+              while (left > 0)
+              {
+                  size_t consumed = 0;
+                  auto frame = MessageCodec::decode(p, left, consumed);
+                  bench::doNotOptimize(frame->payload.size);
+                  p += consumed;
+                  left -= consumed;
+              }
+          });
+}
+
+void addOrderCases(bench::Harness &h)
+{
+    constexpr size_t COUNT = 100000;
+    auto orders = std::make_shared<std::vector<Order>>();
+    for (size_t i = 0; i < COUNT; ++i)
+        orders->push_back(sampleOrder(i));
+
+    h.add("order/serialize", COUNT, nullptr,
+          [orders]
+          {
+              for (const Order &o : *orders)
+                  bench::doNotOptimize(o.serialize().data()[0]);
+          });
+
+    auto wire = std::make_shared<std::vector<uint8_t>>(COUNT * Order::WIRE_SIZE);
+    h.add("order/serialize_to", COUNT, nullptr,
+          [orders, wire]
+          {
+              uint8_t *p = wire->data();
+              for (const Order &o : *orders)
+              {
+                  o.serializeTo(p);
+                  p += Order::WIRE_SIZE;
+              }
+              bench::doNotOptimize(wire->data()[0]);
+          });
+
+    auto encoded = std::make_shared<std::vector<uint8_t>>(COUNT * Order::WIRE_SIZE);
+    for (size_t i = 0; i < COUNT; ++i)
+        (*orders)[i].serializeTo(encoded->data() + i * Order::WIRE_SIZE);
+    h.add("order/deserialize", COUNT, nullptr,
+          [encoded]
+          {
+              for (size_t i = 0; i < COUNT; ++i)
+              {
+                  auto order = Order::deserialize(encoded->data() + i * Order::WIRE_SIZE, Order::WIRE_SIZE);
+                  bench::doNotOptimize(order->quantity);
+              }
+          });
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    spdlog::set_level(spdlog::level::err);
+
+    std::string filter;
+    int reps = 5;
+    uint64_t seed = 20240601;
+    bool csv = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0)
+            filter = arg.substr(9);
+        else if (arg.rfind("--reps=", 0) == 0)
+            reps = std::max(1, std::stoi(arg.substr(7)));
+        else if (arg.rfind("--seed=", 0) == 0)
+            seed = std::stoull(arg.substr(7));
+        else if (arg == "--csv")
+            csv = true;
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--filter=SUBSTR] [--reps=N] [--seed=N] [--csv]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bench::Harness harness;
+    addOrderBookCases(harness, seed);
+    addCodecCases(harness);
+    addOrderCases(harness);
+    harness.runAll(filter, reps, csv);
+    return 0;
+}
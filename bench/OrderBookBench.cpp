@@ -0,0 +1,118 @@
+// 订单簿基准：价格阶梯 OrderBook 与基线 std::map 订单簿对比
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include "core/OrderBook.h"
+#include "MapOrderBook.h"
+
+namespace
+{
+constexpr uint64_t SEED = 20240601;
+constexpr double TICK = 0.001;
+constexpr int MID_TICKS = 100000;
+
+Order makeOrder(int id, OrderSide side, int ticks, int32_t qty)
+{
+    Order o;
+    o.user_id = UserId::fromString("bench");
+    o.order_id = OrderId::fromString("O" + std::to_string(id));
+    o.side = side;
+    o.price = ticks * TICK;
+    o.quantity = qty;
+    o.remaining_quantity = qty;
+    o.timestamp = static_cast<uint64_t>(id);
+    return o;
+}
+
+// 不交叉的挂单：买单在中间价以下，卖单在中间价以上
+std::vector<Order> passiveFlow(int n, int spreadTicks)
+{
+    std::mt19937_64 rng(SEED);
+    std::uniform_int_distribution<int> offset(1, spreadTicks);
+    std::uniform_int_distribution<int> qty(1, 100);
+    std::vector<Order> orders;
+    orders.reserve(n);
+    for (int i = 0; i < n; ++i)
+    {
+        OrderSide side = (i & 1) ? OrderSide::BUY : OrderSide::SELL;
+        int ticks = side == OrderSide::BUY ? MID_TICKS - offset(rng) : MID_TICKS + offset(rng);
+        orders.push_back(makeOrder(i, side, ticks, qty(rng)));
+    }
+    return orders;
+}
+
+// 主动单：跨越整个卖方深度，每笔扫过若干档位
+std::vector<Order> aggressiveFlow(int n, int firstId, int spreadTicks)
+{
+    std::mt19937_64 rng(SEED + 1);
+    std::uniform_int_distribution<int> qty(50, 500);
+    std::vector<Order> orders;
+    orders.reserve(n);
+    for (int i = 0; i < n; ++i)
+    {
+        orders.push_back(makeOrder(firstId + i, OrderSide::BUY, MID_TICKS + spreadTicks, qty(rng)));
+    }
+    return orders;
+}
+
+template <typename Fn>
+double nsPerOp(size_t ops, Fn fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(ops);
+}
+
+template <typename Book>
+void run(const char *name, Book &book, const std::vector<Order> &resting,
+         const std::vector<Order> &aggressive, const std::vector<OrderId> &cancelIds)
+{
+    size_t reports = 0;
+    auto cb = [&reports](const ExecutionReport &)
+    { ++reports; };
+
+    double insertNs = nsPerOp(resting.size(), [&]
+                              { for (const auto &o : resting) book.matchOrder(o, cb); });
+    double matchNs = nsPerOp(aggressive.size(), [&]
+                             { for (const auto &o : aggressive) book.matchOrder(o, cb); });
+    double cancelNs = nsPerOp(cancelIds.size(), [&]
+                              { for (const auto &id : cancelIds) book.cancelOrder(id, cb); });
+
+    std::printf("%-12s insert %8.1f ns/op   match %8.1f ns/op   cancel %8.1f ns/op   (%zu reports)\n",
+                name, insertNs, matchNs, cancelNs, reports);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    spdlog::set_level(spdlog::level::err);
+
+    int n = argc > 1 ? std::stoi(argv[1]) : 200000;
+    int spread = argc > 2 ? std::stoi(argv[2]) : 500;
+
+    auto resting = passiveFlow(n, spread);
+    auto aggressive = aggressiveFlow(n / 10, n, spread);
+
+    std::vector<OrderId> cancelIds;
+    for (const auto &o : resting)
+        cancelIds.push_back(o.order_id);
+    std::shuffle(cancelIds.begin(), cancelIds.end(), std::mt19937_64(SEED + 2));
+
+    std::printf("orders=%d spread=%d ticks aggressive=%zu\n", n, spread, aggressive.size());
+    {
+        MapOrderBook book;
+        run("map", book, resting, aggressive, cancelIds);
+    }
+    {
+        InstrumentSpec spec;
+        spec.tick_size = TICK;
+        OrderBook book(spec, static_cast<uint32_t>(n));
+        run("ladder", book, resting, aggressive, cancelIds);
+    }
+    return 0;
+}
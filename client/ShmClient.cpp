@@ -0,0 +1,134 @@
+#include "ShmClient.h"
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+
+bool ShmClient::connect(const std::string &prefix, uint32_t slots, std::chrono::milliseconds timeout)
+{
+    if (slot_)
+        return true;
+    for (uint32_t i = 0; i < slots; ++i)
+    {
+        auto candidate = std::make_unique<ShmSlot>();
+        if (!candidate->open(ShmSlot::name(prefix, i)))
+            continue;
+        ShmSlotHeader *header = candidate->header();
+        uint32_t expected = static_cast<uint32_t>(ShmSlotState::FREE);
+        if (!header->state.compare_exchange_strong(expected, static_cast<uint32_t>(ShmSlotState::CLAIMING),
+                                                   std::memory_order_acq_rel))
+            continue;
+        header->client_pid.store(getpid(), std::memory_order_relaxed);
+        header->state.store(static_cast<uint32_t>(ShmSlotState::REQUESTED), std::memory_order_release);
+
+        // 引擎在事件循环中清零环下标后把 REQUESTED CAS 为 ACTIVE
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (header->state.load(std::memory_order_acquire) == static_cast<uint32_t>(ShmSlotState::REQUESTED))
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+                break;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        expected = static_cast<uint32_t>(ShmSlotState::REQUESTED);
+        if (header->state.compare_exchange_strong(expected, static_cast<uint32_t>(ShmSlotState::CLOSED),
+                                                  std::memory_order_acq_rel) ||
+            expected != static_cast<uint32_t>(ShmSlotState::ACTIVE))
+            return false; // 引擎没有响应：置 CLOSED 交还槽位，引擎恢复后回收
+
+        candidate->attachRings();
+        slot_ = std::move(candidate);
+        return true;
+    }
+    return false;
+}
+
+void ShmClient::disconnect()
+{
+    if (!slot_)
+        return;
+    // ACTIVE 或引擎已置 DISCONNECTED，都由客户端置 CLOSED，引擎随后回收为 FREE
+    slot_->header()->state.store(static_cast<uint32_t>(ShmSlotState::CLOSED), std::memory_order_release);
+    slot_.reset();
+}
+
+bool ShmClient::connected() const
+{
+    return slot_ &&
+           slot_->header()->state.load(std::memory_order_acquire) == static_cast<uint32_t>(ShmSlotState::ACTIVE);
+}
+
+bool ShmClient::send(MessageType type, const uint8_t *payload, uint16_t len)
+{
+    if (!connected())
+        return false;
+    ShmRing &ring = slot_->toEngine();
+    if (!ring.reserve(MessageCodec::HEADER_SIZE + len))
+        return false;
+    // 帧头与 payload 分两次写入、一次发布，引擎不会看到半帧
+    uint8_t header[MessageCodec::HEADER_SIZE];
+    MessageCodec::encodeHeader(header, type, len);
+    ring.stage(header, sizeof(header));
+    ring.stage(payload, len);
+    ring.publish();
+    return true;
+}
+
+bool ShmClient::sendOrder(const Order &order)
+{
+    uint8_t payload[Order::WIRE_SIZE];
+    order.serializeTo(payload);
+    return send(MessageType::NEW_ORDER, payload, sizeof(payload));
+}
+
+bool ShmClient::sendCancel(const OrderId &orderId, uint32_t symbolId)
+{
+    wire::CancelOrder msg{};
+    std::memcpy(msg.order_id, orderId.data, sizeof(msg.order_id));
+    msg.symbol_id = symbolId;
+    return send(wire::CancelOrder::TYPE, reinterpret_cast<const uint8_t *>(&msg), sizeof(msg));
+}
+
+bool ShmClient::sendReplace(const OrderId &orderId, uint32_t symbolId, double price, int32_t quantity,
+                            const UserId &userId)
+{
+    wire::ReplaceOrder msg{};
+    std::memcpy(msg.order_id, orderId.data, sizeof(msg.order_id));
+    msg.symbol_id = symbolId;
+    msg.price = price;
+    msg.quantity = quantity;
+    std::memcpy(msg.user_id, userId.data, sizeof(msg.user_id));
+    return send(wire::ReplaceOrder::TYPE, reinterpret_cast<const uint8_t *>(&msg), sizeof(msg));
+}
+
+bool ShmClient::sendOrderBatch(const Order *orders, size_t count)
+{
+    if (count == 0 || count > MAX_BATCH_ORDERS || !connected())
+        return false;
+    // 定长部分 + count 个订单，逐笔编码进环里，整帧一次发布
+    wire::NewOrderBatch batch{};
+    batch.count = static_cast<uint16_t>(count);
+    uint16_t len = static_cast<uint16_t>(wire::NewOrderBatch::sizeFor(count));
+    ShmRing &ring = slot_->toEngine();
+    if (!ring.reserve(MessageCodec::HEADER_SIZE + len))
+        return false;
+    uint8_t header[MessageCodec::HEADER_SIZE];
+    MessageCodec::encodeHeader(header, wire::NewOrderBatch::TYPE, len);
+    ring.stage(header, sizeof(header));
+    ring.stage(reinterpret_cast<const uint8_t *>(&batch), sizeof(batch));
+    uint8_t payload[Order::WIRE_SIZE];
+    for (size_t i = 0; i < count; ++i)
+    {
+        orders[i].serializeTo(payload);
+        ring.stage(payload, sizeof(payload));
+    }
+    ring.publish();
+    return true;
+}
+
+bool ShmClient::sendMassCancel(uint8_t scope, uint8_t side, const UserId &userId)
+{
+    wire::MassCancel msg{};
+    msg.scope = scope;
+    msg.side = side;
+    std::memcpy(msg.user_id, userId.data, sizeof(msg.user_id));
+    return send(wire::MassCancel::TYPE, reinterpret_cast<const uint8_t *>(&msg), sizeof(msg));
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "core/Order.h"
+#include "network/ShmRing.h"
+#include "protocol/MessageCodec.h"
+
+// 同机客户端的共享内存传输：与引擎的 --shm-prefix 配套，帧格式与 TCP 相同。
+// 单线程使用：send 与 poll 必须在同一线程（或由调用方串行化）。
+//
+//     ShmClient client;
+//     if (!client.connect("/matching-engine", 4))
+//         ...
+//     client.sendOrder(order);
+//     client.poll([](MessageType type, PayloadView payload) { ... });
+class ShmClient
+{
+public:
+    ShmClient() = default;
+    ~ShmClient() { disconnect(); }
+    ShmClient(const ShmClient &) = delete;
+    ShmClient &operator=(const ShmClient &) = delete;
+
+    // 依次尝试 <prefix>-0 .. <prefix>-(slots-1)，占用第一个空闲槽位并等待引擎接受
+    bool connect(const std::string &prefix, uint32_t slots,
+                 std::chrono::milliseconds timeout = std::chrono::seconds(5));
+    void disconnect();
+    // 引擎断开（慢消费者、非法帧或引擎退出前）后返回 false
+    bool connected() const;
+
+    // 写入一帧并立即发布；环满返回 false（可稍后 poll 回报再重试）
+    bool send(MessageType type, const uint8_t *payload, uint16_t len);
+    bool sendOrder(const Order &order);
+    bool sendCancel(const OrderId &orderId, uint32_t symbolId);
+    // 改单：quantity 为改后的剩余数量，userId 为订单所属用户（引擎据此核对归属并检查名义金额）
+    bool sendReplace(const OrderId &orderId, uint32_t symbolId, double price, int32_t quantity,
+                     const UserId &userId);
+    // 批量下单：一帧至多 MAX_BATCH_ORDERS 笔，回报以 EXECUTION_REPORT_BATCH 帧返回（每个涉及的分片一帧）
+    static constexpr size_t MAX_BATCH_ORDERS = (0xFFFF - sizeof(wire::NewOrderBatch)) / sizeof(wire::NewOrder);
+    bool sendOrderBatch(const Order *orders, size_t count);
+    // 批量撤单：scope 0 撤销本会话的挂单，1 撤销 userId 的挂单；side 为 OrderSide 的取值，2 表示双边
+    bool sendMassCancel(uint8_t scope, uint8_t side, const UserId &userId = UserId{});
+
+    // 处理最多 limit 帧已到达的回报，回调签名 void(MessageType, PayloadView)，返回处理的帧数
+    template <typename Fn>
+    size_t poll(Fn &&fn, size_t limit = SIZE_MAX)
+    {
+        if (!slot_)
+            return 0;
+        ShmRing &ring = slot_->toClient();
+        size_t n = 0;
+        size_t readable;
+        while (n < limit && (readable = ring.readable()) > 0)
+        {
+            size_t consumed = 0;
+            auto frame = MessageCodec::decode(ring.readPtr(), readable, consumed);
+            if (frame)
+            {
+                fn(frame->type, frame->payload);
+                ++n;
+            }
+            ring.consume(consumed);
+            if (!frame)
+                break;
+        }
+        return n;
+    }
+
+private:
+    std::unique_ptr<ShmSlot> slot_; // 已连接的槽位，未连接时为空
+};
@@ -0,0 +1,153 @@
+"""行情订阅示例：通过 TCP 或 UDP 接收行情，维护 L2 订单簿并检查序号连续性。
+
+    python3 md_subscriber.py tcp 127.0.0.1 9998            # 增量 + 快照
+    python3 md_subscriber.py tcp 127.0.0.1 9998 --tob      # 合并后的最优价
+    python3 md_subscriber.py udp 239.1.1.1 30001           # 组播（或单播）增量 + 快照
+
+Ctrl+C 退出时打印各品种的订单簿。
+"""
+import os
+import socket
+import struct
+import sys
+
+# === 线上格式：由 protocol/messages.schema 生成的编解码器（与 C++ 端同源）===
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'protocol'))
+import wiregen  # noqa: E402
+
+wire = wiregen.load()
+HEADER, MESSAGE = wire.MdPacketHeader, wire.MdMessage
+
+CH_INCREMENTAL, CH_SNAPSHOT, CH_TOP_OF_BOOK = wire.MdChannel.INCREMENTAL, wire.MdChannel.SNAPSHOT, wire.MdChannel.TOP_OF_BOOK
+LEVEL_DELETE, TRADE, SNAPSHOT_BEGIN = wire.MdMessageType.LEVEL_DELETE, wire.MdMessageType.TRADE, wire.MdMessageType.SNAPSHOT_BEGIN
+SUB_INCREMENTAL, SUB_TOP_OF_BOOK = wire.MdSubscription.INCREMENTAL, wire.MdSubscription.TOP_OF_BOOK
+BUY = wire.OrderSide.BUY
+
+
+class Book:
+    """按快照 + 增量维护的 L2 订单簿，{(symbol, side): {price: (qty, count)}}"""
+
+    def __init__(self):
+        self.levels = {}
+        self.seq = None          # 已应用的最后一条增量序号，None 表示尚未同步
+        self.pending = []        # 同步前缓存的增量
+        self.snapshot = None     # 正在接收的快照 [seq, 剩余条数, levels]
+        self.trades = 0
+        self.gaps = 0
+        self.tob = {}
+
+    def on_packet(self, data):
+        header = HEADER.unpack(data)
+        channel, seq = header['channel'], header['seq']
+        msgs = [MESSAGE.unpack(data, HEADER.size + i * MESSAGE.size) for i in range(header['count'])]
+        if channel == CH_INCREMENTAL:
+            for i, m in enumerate(msgs):
+                self.on_incremental(seq + i, m)
+        elif channel == CH_SNAPSHOT:
+            self.on_snapshot(seq, msgs)
+        elif channel == CH_TOP_OF_BOOK:
+            for m in msgs:
+                self.tob[(m['symbol_id'], m['side'])] = (m['price'], m['quantity'], m['order_count'])
+
+    def on_incremental(self, seq, m):
+        if self.seq is None:
+            self.pending.append((seq, m))
+            return
+        if seq <= self.seq:
+            return
+        if seq != self.seq + 1:
+            # 丢包：等下一轮快照重新同步
+            self.gaps += 1
+            self.seq = None
+            self.pending = [(seq, m)]
+            return
+        self.apply(m)
+        self.seq = seq
+
+    def on_snapshot(self, seq, msgs):
+        for m in msgs:
+            if m['type'] == SNAPSHOT_BEGIN:
+                self.snapshot = [seq, m['quantity'], {}]
+            elif self.snapshot is not None and self.snapshot[0] == seq:
+                key = (m['symbol_id'], m['side'])
+                self.snapshot[2].setdefault(key, {})[m['price']] = (m['quantity'], m['order_count'])
+                self.snapshot[1] -= 1
+        if self.snapshot is None or self.snapshot[1] != 0:
+            return
+        snap_seq, _, levels = self.snapshot
+        self.snapshot = None
+        if self.seq is not None:
+            return  # 已同步，周期快照只用于后加入者
+        self.levels = levels
+        self.seq = snap_seq
+        pending, self.pending = self.pending, []
+        for s, m in pending:
+            self.on_incremental(s, m)
+
+    def apply(self, m):
+        if m['type'] == TRADE:
+            self.trades += 1
+            return
+        side_levels = self.levels.setdefault((m['symbol_id'], m['side']), {})
+        if m['type'] == LEVEL_DELETE:
+            side_levels.pop(m['price'], None)
+        else:
+            side_levels[m['price']] = (m['quantity'], m['order_count'])
+
+    def dump(self):
+        for (symbol, side), levels in sorted(self.levels.items()):
+            prices = sorted(levels, reverse=(side == BUY))
+            for price in prices:
+                qty, count = levels[price]
+                print(f"{symbol} {'BID' if side == BUY else 'ASK'} {price:.6f} {qty} {count}")
+        for (symbol, side), (price, qty, count) in sorted(self.tob.items()):
+            print(f"{symbol} TOB {'BID' if side == BUY else 'ASK'} {price:.6f} {qty} {count}")
+        print(f"# seq={self.seq} trades={self.trades} gaps={self.gaps}", file=sys.stderr)
+
+
+def run_tcp(host, port, mode, book):
+    sock = socket.create_connection((host, port))
+    sock.sendall(wire.MdSubscribeRequest.pack(mode=mode))
+    buf = b''
+    while True:
+        data = sock.recv(1 << 16)
+        if not data:
+            break
+        buf += data
+        while len(buf) >= HEADER.size:
+            size = HEADER.size + HEADER.unpack(buf)['count'] * MESSAGE.size
+            if len(buf) < size:
+                break
+            book.on_packet(buf[:size])
+            buf = buf[size:]
+
+
+def run_udp(group, port, book):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(('', port))
+    if 224 <= int(group.split('.')[0]) <= 239:
+        mreq = struct.pack('4s4s', socket.inet_aton(group), socket.inet_aton('0.0.0.0'))
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    while True:
+        book.on_packet(sock.recv(65536))
+
+
+def main():
+    if len(sys.argv) < 4:
+        print(__doc__)
+        sys.exit(1)
+    transport, host, port = sys.argv[1], sys.argv[2], int(sys.argv[3])
+    book = Book()
+    try:
+        if transport == 'tcp':
+            run_tcp(host, port, SUB_TOP_OF_BOOK if '--tob' in sys.argv else SUB_INCREMENTAL, book)
+        else:
+            run_udp(host, port, book)
+    except KeyboardInterrupt:
+        pass
+    book.dump()
+
+
+if __name__ == '__main__':
+    main()
@@ -1,94 +1,57 @@
-import struct
+"""单笔下单 / 撤单示例，编解码器由 protocol/messages.schema 生成。压测请用 C++ 的 load_gen。
+
+    python3 test_client.py [host] [port] [order|cancel|replace|batch|mass_cancel]
+"""
+import os
 import socket
+import sys
 
-# === 配置（必须与 C++ 端一致）===
-MAGIC = 0xabcdef00
-MESSAGE_TYPE_ORDER = 1
-HEADER_SIZE = 7  # 4 (magic) + 2 (len) + 1 (type)
+# 线上格式由 protocol/messages.schema 定义，编解码器在加载时按 schema 生成，与 C++ 端同源
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'protocol'))
+import wiregen  # noqa: E402
 
-HOST = '192.168.1.21'
-PORT = 9999
+wire = wiregen.load()
+MessageType, OrderSide, OrderType, ExecType = wire.MessageType, wire.OrderSide, wire.OrderType, wire.ExecType
+SIDE_BOTH = 2  # 批量撤单的 side 取值，双边
 
-# === 序列化：Order -> bytes (73B) ===
-def serialize_order(user_id: str, order_id: str, side: int, price: float, quantity: int, timestamp: int) -> bytes:
-    buf = bytearray(73)
-    
-    # user_id: 15 bytes at [0, 15)
-    uid_bytes = user_id.encode('utf-8')[:15]
-    buf[0:15] = uid_bytes.ljust(15, b'\x00')
-    
-    # order_id: 31 bytes at [16, 47)
-    oid_bytes = order_id.encode('utf-8')[:31]
-    buf[16:47] = oid_bytes.ljust(31, b'\x00')
-    
-    # side: 1 byte at offset 47
-    buf[48] = side
-    
-    # price: double at 48 (8 bytes)
-    struct.pack_into('<d', buf, 49, price)
-    
-    # quantity: int32 at 56 (4 bytes)
-    struct.pack_into('<i', buf, 57, quantity)
-    
-    # remaining_quantity: int32 at 60 (4 bytes)
-    struct.pack_into('<i', buf, 61, quantity)
-    
-    # timestamp: uint64 at 64 (8 bytes)
-    struct.pack_into('<Q', buf, 63, timestamp)
-    
-    return bytes(buf)
+HOST = sys.argv[1] if len(sys.argv) > 1 else '127.0.0.1'
+PORT = int(sys.argv[2]) if len(sys.argv) > 2 else 9999
 
-def serialize_cancel_order(order_id: str) -> bytes:
-    buf = bytearray(32)
-    oid_bytes = order_id.encode('utf-8')[:31]
-    buf[0:31] = oid_bytes.ljust(31, b'\x00')
-    return bytes(buf)
+def serialize_order(user_id: str, order_id: str, side: int, price: float, quantity: int, timestamp: int,
+                    symbol_id: int = 0, order_type: int = OrderType.LIMIT) -> bytes:
+    return wire.NewOrder.pack(user_id=user_id, order_id=order_id, side=side, price=price, quantity=quantity,
+                              remaining_quantity=quantity, timestamp=timestamp, symbol_id=symbol_id,
+                              order_type=order_type)
 
-# === 反序列化：-> dict ===
-def deserialize_order(payload: bytes) -> dict:
-    order_id = payload[0:31].split(b'\x00', 1)[0].decode('utf-8')
-    
-    # side
-    side_int = payload[32]
-    side_str = "BUY" if side_int == 1 else "SELL"  # 根据你的 OrderSide 调整
-    
-    # quantity
-    quantity = struct.unpack_from('<i', payload, 33)[0]
-    
-    return {
-        "order_id": order_id,
-        "side": side_str,
-        "quantity": quantity,
-    }
+# quantity 为改后的剩余数量，user_id 为订单所属用户
+def serialize_replace_order(user_id: str, order_id: str, price: float, quantity: int, symbol_id: int = 0) -> bytes:
+    return wire.ReplaceOrder.pack(order_id=order_id, symbol_id=symbol_id, price=price, quantity=quantity,
+                                  user_id=user_id)
+
+# SESSION 范围撤销本连接的挂单，忽略 user_id
+def serialize_mass_cancel(scope: int, side: int = SIDE_BOTH, user_id: str = '') -> bytes:
+    return wire.MassCancel.pack(scope=scope, side=side, user_id=user_id)
+
+def named_report(report: dict) -> dict:
+    exec_type = report['exec_type']
+    report['exec_type'] = ExecType(exec_type).name if exec_type in ExecType._value2member_map_ else exec_type
+    return report
+
+def deserialize_report(payload: bytes) -> dict:
+    return named_report(wire.ExecutionReport.unpack(payload))
+
+def deserialize_report_batch(payload: bytes) -> list:
+    return [named_report(r) for r in wire.ExecutionReportBatch.unpack(payload)['reports']]
 
-# === 编码完整消息 ===
 def encode_message(msg_type: int, payload: bytes) -> bytes:
-    length = len(payload)
-    header = struct.pack('<IH', MAGIC, length)
-    return header + struct.pack('B', msg_type) + payload
+    return wire.frame(msg_type, payload=payload)
 
-# === 解码完整消息 ===
 def decode_message(data: bytes):
-    if len(data) < HEADER_SIZE:
-        raise ValueError("Message too short for header")
-    
-    # 解析 header
-    magic, length = struct.unpack_from('<IH', data, 0)
-    msg_type = data[6]
-    
-    if magic != MAGIC:
-        raise ValueError(f"Invalid magic: expected {MAGIC:08x}, got {magic:08x}")
-    
-    payload = data[HEADER_SIZE:HEADER_SIZE + length]
-    if len(payload) != length:
-        raise ValueError(f"Payload truncated: expected {length}, got {len(payload)}")
-    
-    return {
-        "magic": magic,
-        "length": length,
-        "type": msg_type,
-        "payload": payload
-    }
+    frame = wire.parse_frame(data)
+    if frame is None:
+        raise ValueError("Message truncated")
+    msg_type, payload, _ = frame
+    return {"type": msg_type, "length": len(payload), "payload": payload}
 
 # === 主测试逻辑 ===
 def add_order():
@@ -96,7 +59,7 @@ def add_order():
     test_data = {
         'user_id': 'trader_006',
         'order_id': 'O3',
-        'side':0, 
+        'side': OrderSide.SELL,
         'price':2.365,
         'quantity': 33300,
         'timestamp': 1731691200000000  # 微秒时间戳
@@ -105,14 +68,14 @@ def add_order():
     print("📦 Sending order:")
     print(f"  User: {test_data['user_id']}")
     print(f"  Order ID: {test_data['order_id']}")
-    print(f"  Side: {'BUY' if test_data['side'] == 0 else 'SELL'}")
+    print(f"  Side: {OrderSide(test_data['side']).name}")
     print(f"  Price: {test_data['price']}")
     print(f"  Quantity: {test_data['quantity']}")
     print()
     
     # 序列化并编码
     payload = serialize_order(**test_data)
-    full_msg = encode_message(MESSAGE_TYPE_ORDER, payload)
+    full_msg = encode_message(MessageType.NEW_ORDER, payload)
     
     try:
         # 发送并接收（假设服务端原样返回）
@@ -121,7 +84,7 @@ def add_order():
             s.sendall(full_msg)
             print("✅ Sent to server.")
             
-            # 接收响应（简单起见，假设一次 recv 拿到全部）
+            # 接收回报（简单起见，假设一次 recv 拿到全部）
             response = s.recv(1024)
             print("Response:", response.hex())
             if not response:
@@ -133,26 +96,30 @@ def add_order():
             # 解析响应
             decoded = decode_message(response)
             
-            # 反序列化订单
-            order_dict = deserialize_order(decoded['payload'])
-            
-            print("\n📄 Parsed order:")
-            for k, v in order_dict.items():
+            report = deserialize_report(decoded['payload'])
+
+            print("\n📄 Execution report:")
+            for k, v in report.items():
                 print(f"  {k}: {v}")
                 
     except Exception as e:
         print(f"❌ Error: {e}")
 
 def cancel_order():
-    payload =serialize_cancel_order('O2')
-    full_msg = encode_message(2, payload)
+    send_and_print_report(wire.frame(wire.CancelOrder, order_id='O3'))
+
+def replace_order():
+    # 把 O3 改为 2.366 / 10000：同价减量原地修改，改价则移到新价位队尾
+    send_and_print_report(encode_message(MessageType.REPLACE_ORDER, serialize_replace_order('trader_006', 'O3', 2.366, 10000)))
+
+def send_and_print_report(full_msg: bytes):
     with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
         s.connect((HOST, PORT))
         s.sendall(full_msg)
         print("✅ Sent to server.")
         
-        # 接收响应（简单起见，假设一次 recv 拿到全部）
-        response = s.recv(1024)
+        # 接收回报（订单不存在时引擎不回报，这里会一直等待）
+        response = s.recv(65536)
         print("Response:", response.hex())
         if not response:
             print("❌ No response from server.")
@@ -161,13 +128,38 @@ def cancel_order():
         print(f"\n📥 Received {len(response)} bytes from server.")
         
         # 解析响应
-        decoded = decode_message(response)
-        
-        # 反序列化订单
-        order_dict = deserialize_order(decoded['payload'])
-        
-        print("\n📄 Parsed order:")
-        for k, v in order_dict.items():
-            print(f"  {k}: {v}")
+        print_reports(decode_message(response))
+def batch_orders():
+    # 一帧三笔报价，回报合并为一帧 EXECUTION_REPORT_BATCH
+    orders = [serialize_order('trader_006', f'Q{i}', OrderSide.SELL, 2.37 + i * 0.001, 1000, 1731691200000000)
+              for i in range(3)]
+    send_and_print_report(wire.frame(wire.NewOrderBatch, orders=orders))
+
+def mass_cancel():
+    # 撤销 trader_006 的全部挂单（任意连接下的）
+    send_and_print_report(encode_message(MessageType.MASS_CANCEL,
+                                         serialize_mass_cancel(wire.MassCancelScope.USER, SIDE_BOTH, 'trader_006')))
+
+def print_reports(decoded: dict):
+    if decoded['type'] == MessageType.EXECUTION_REPORT_BATCH:
+        reports = deserialize_report_batch(decoded['payload'])
+        print(f"\n📄 Execution report batch ({len(reports)} reports):")
+        for report in reports:
+            print(f"  {report}")
+        return
+    report = deserialize_report(decoded['payload'])
+    print("\n📄 Execution report:")
+    for k, v in report.items():
+        print(f"  {k}: {v}")
+
 if __name__ == '__main__':
-    cancel_order()
+    if len(sys.argv) > 3 and sys.argv[3] == 'cancel':
+        cancel_order()
+    elif len(sys.argv) > 3 and sys.argv[3] == 'replace':
+        replace_order()
+    elif len(sys.argv) > 3 and sys.argv[3] == 'batch':
+        batch_orders()
+    elif len(sys.argv) > 3 and sys.argv[3] == 'mass_cancel':
+        mass_cancel()
+    else:
+        add_order()
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include "Order.h"
+#include "ExecutionReport.h"
+#include "utils/LatencyTrace.h"
+
+// I/O 线程投递给撮合分片的指令（定长、可平凡拷贝，直接放入无锁队列）
+enum class CommandType : uint8_t
+{
+    NEW_ORDER = 0,
+    CANCEL_ORDER = 1,
+    REPLACE_ORDER = 2,
+    MASS_CANCEL = 3, // 批量撤单：作用于分片内全部订单簿，每个分片各投递一条
+    RISK_REJECTED = 4, // 风控拒绝的新单 / 改单（目标订单号在 cancel_id）：分片只回报 REJECTED，不落日志
+    NONE = 0xFF // 占位：批内已被拒绝、不再执行的指令
+};
+
+// EngineCommand::flags：批量消息拆出的指令，回报合并为一帧 EXECUTION_REPORT_BATCH 发出
+constexpr uint8_t COMMAND_BATCHED = 1;   // 回报进入该连接的批量回报帧
+constexpr uint8_t COMMAND_BATCH_END = 2; // 本分片收到的该批最后一条：执行后把批量回报帧发出
+// REPLACE_ORDER：风控线程已给出 risk_budget，改单增加的名义金额不得超过它（见 RiskShard）
+constexpr uint8_t COMMAND_RISK_BUDGET = 4;
+
+struct EngineCommand
+{
+    CommandType type;
+    uint8_t flags;
+    uint8_t mass_scope; // MASS_CANCEL：MassCancelScope
+    uint8_t mass_side;  // MASS_CANCEL：OrderSide 的取值，或 MassCancelFilter::BOTH_SIDES
+    uint32_t symbol_id;
+    uint64_t conn_id;   // 发起连接，成交回报按此路由；挂单的所属会话
+    Order order;        // NEW_ORDER；REPLACE_ORDER 只用 price / quantity（新价格、新剩余数量）
+                        // 与 user_id（订单所属用户，旧格式为空）；MASS_CANCEL 只用 user_id
+    OrderId cancel_id;  // CANCEL_ORDER / REPLACE_ORDER 的目标订单
+    double risk_budget; // REPLACE_ORDER 且带 COMMAND_RISK_BUDGET：该用户剩余的未结名义金额额度
+#ifdef LATENCY_TRACE_ENABLED
+    uint64_t trace_ingress; // 帧开始解码的 TSC 时间戳
+    uint64_t trace_enqueue; // 进入分片输入队列的 TSC 时间戳
+#endif
+};
+
+// OutboundReport::flags
+constexpr uint8_t REPORT_BATCHED = 1;   // 属于批量指令，暂存到批量回报帧
+constexpr uint8_t REPORT_BATCH_END = 2; // 标记（report 无内容）：该连接的批量回报帧到此结束
+
+// 撮合分片产生、待发回客户端的成交回报
+struct OutboundReport
+{
+    uint64_t conn_id;
+    ExecutionReport report;
+    uint8_t flags = 0;
+    uint8_t lane = 0; // 指令来自哪个风控线程（未启用风控时为 0）：批量回报按分片与此分别暂存
+#ifdef LATENCY_TRACE_ENABLED
+    uint64_t trace_ingress = 0; // 来自触发该回报的指令
+#endif
+};
+static_assert(std::is_trivially_copyable<OutboundReport>::value, "OutboundReport is copied through ring buffers");
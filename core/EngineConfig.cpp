@@ -0,0 +1,378 @@
+#include "EngineConfig.h"
+#include "utils/Logger.h"
+#include <string>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include "protocol/MessageCodec.h"
+
+namespace
+{
+constexpr uint32_t MAX_IO_THREADS = 64; // 连接 ID 中反应器下标占 8 位，再留出余量
+constexpr uint32_t MAX_RISK_THREADS = 64; // 回报中的来源下标（OutboundReport::lane）占 8 位
+
+// 品种文件每行：symbol_id tick_size [base_price] [price_levels]，# 开头为注释
+bool loadSymbolFile(const std::string &path, const InstrumentSpec &defaults, std::vector<SymbolConfig> &out)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        spdlog::error("Cannot open symbol file: {}", path);
+        return false;
+    }
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line))
+    {
+        ++lineNo;
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        SymbolConfig symbol{0, defaults};
+        if (!(fields >> symbol.symbol_id >> symbol.spec.tick_size))
+        {
+            spdlog::error("Symbol file {}:{}: expected 'symbol_id tick_size [base_price] [price_levels]'", path, lineNo);
+            return false;
+        }
+        double basePrice;
+        uint32_t levels;
+        if (fields >> basePrice)
+        {
+            symbol.spec.base_price = basePrice;
+            if (fields >> levels)
+                symbol.spec.num_levels = levels;
+        }
+        if (symbol.spec.tick_size <= 0 || symbol.spec.num_levels == 0)
+        {
+            spdlog::error("Symbol file {}:{}: invalid tick_size or price_levels", path, lineNo);
+            return false;
+        }
+        out.push_back(symbol);
+    }
+    return true;
+}
+
+// 逗号分隔的 CPU 编号列表，如 2,3
+std::vector<int> parseCpuList(const std::string &value)
+{
+    std::vector<int> cpus;
+    std::istringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ','))
+        cpus.push_back(std::stoi(item));
+    return cpus;
+}
+
+bool validCpuList(const std::vector<int> &cpus, uint32_t expected, const char *option, const char *countOption)
+{
+    if (cpus.empty())
+        return true;
+    if (cpus.size() != expected)
+    {
+        spdlog::error("Invalid config: {} must list exactly {} CPUs ({})", option, countOption, expected);
+        return false;
+    }
+    for (int cpu : cpus)
+    {
+        if (cpu < 0 || cpu >= CPU_SETSIZE)
+        {
+            spdlog::error("Invalid config: {} contains invalid CPU {}", option, cpu);
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+std::optional<EngineConfig> parseEngineConfig(int argc, char **argv)
+{
+    EngineConfig config;
+    uint32_t symbolCount = 1;
+    std::string symbolFile;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos)
+        {
+            spdlog::error("Invalid argument: {} (expected --key=value)", arg);
+            return std::nullopt;
+        }
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+
+        try
+        {
+            if (key == "port")
+                config.port = std::stoi(value);
+            else if (key == "tick-size")
+                config.instrument.tick_size = std::stod(value);
+            else if (key == "base-price")
+                config.instrument.base_price = std::stod(value);
+            else if (key == "price-levels")
+                config.instrument.num_levels = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "order-pool-size")
+                config.order_pool_size = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "symbols")
+                symbolCount = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "symbol-file")
+                symbolFile = value;
+            else if (key == "shards")
+                config.shards = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "io-threads")
+                config.io_threads = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "io-backend")
+            {
+                if (value != "epoll" && value != "uring")
+                {
+                    spdlog::error("Invalid value for --io-backend: {} (expected epoll|uring)", value);
+                    return std::nullopt;
+                }
+                config.io_uring = value == "uring";
+            }
+            else if (key == "uring-entries")
+                config.uring_entries = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "uring-buffers")
+                config.uring_buffers = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "uring-buffer-size")
+                config.uring_buffer_size = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "queue-capacity")
+                config.queue_capacity = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "egress-thread")
+                config.egress_thread = std::stoi(value) != 0;
+            else if (key == "stats-interval")
+                config.stats_interval_sec = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "recv-buffer-size")
+                config.recv_buffer_size = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "journal-dir")
+                config.journal_dir = value;
+            else if (key == "journal-segment-size")
+                config.journal_segment_size = std::stoull(value);
+            else if (key == "journal-sync")
+                config.journal_sync = std::stoi(value) != 0;
+            else if (key == "md-port")
+                config.md_port = std::stoi(value);
+            else if (key == "md-multicast")
+                config.md_multicast = value;
+            else if (key == "md-tob-multicast")
+                config.md_tob_multicast = value;
+            else if (key == "md-interface")
+                config.md_interface = value;
+            else if (key == "md-snapshot-interval-ms")
+                config.md_snapshot_interval_ms = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "md-tob-interval-ms")
+                config.md_tob_interval_ms = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "snapshot-interval")
+                config.snapshot_interval_sec = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "event-log")
+                config.event_log = value;
+            else if (key == "event-log-ring")
+                config.event_log_ring = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "max-batch")
+                config.max_batch = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "output-buffer-size")
+                config.output_buffer_size = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "shm-prefix")
+                config.shm_prefix = value;
+            else if (key == "shm-slots")
+                config.shm_slots = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "shm-ring-size")
+                config.shm_ring_size = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "idle")
+            {
+                if (value == "block")
+                    config.idle = IdleStrategy::BLOCK;
+                else if (value == "spin-yield")
+                    config.idle = IdleStrategy::SPIN_YIELD;
+                else if (value == "spin")
+                    config.idle = IdleStrategy::SPIN;
+                else
+                {
+                    spdlog::error("Invalid value for --idle: {} (expected block|spin-yield|spin)", value);
+                    return std::nullopt;
+                }
+            }
+            else if (key == "idle-spin-us")
+                config.idle_spin_us = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "io-cpus")
+                config.io_cpus = parseCpuList(value);
+            else if (key == "shard-cpus")
+                config.shard_cpus = parseCpuList(value);
+            else if (key == "rt-priority")
+                config.rt_priority = std::stoi(value);
+            else if (key == "busy-poll-us")
+                config.busy_poll_us = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "risk-threads")
+                config.risk_threads = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "risk-cpus")
+                config.risk_cpus = parseCpuList(value);
+            else if (key == "risk-max-order-qty")
+                config.risk.max_order_qty = std::stoi(value);
+            else if (key == "risk-price-band")
+                config.risk.price_band = std::stod(value);
+            else if (key == "risk-max-open-orders")
+                config.risk.max_open_orders = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "risk-max-notional")
+                config.risk.max_notional = std::stod(value);
+            else if (key == "slow-consumer")
+            {
+                if (value != "disconnect" && value != "throttle")
+                {
+                    spdlog::error("Invalid value for --slow-consumer: {} (expected disconnect|throttle)", value);
+                    return std::nullopt;
+                }
+                config.throttle_slow_consumers = value == "throttle";
+            }
+            else
+            {
+                spdlog::error("Unknown option: --{}", key);
+                return std::nullopt;
+            }
+        }
+        catch (const std::exception &)
+        {
+            spdlog::error("Invalid value for --{}: {}", key, value);
+            return std::nullopt;
+        }
+    }
+
+    if (config.instrument.tick_size <= 0 || config.instrument.num_levels == 0 || config.order_pool_size == 0)
+    {
+        spdlog::error("Invalid config: tick-size, price-levels and order-pool-size must be positive");
+        return std::nullopt;
+    }
+
+    if (!symbolFile.empty())
+    {
+        if (!loadSymbolFile(symbolFile, config.instrument, config.symbols))
+            return std::nullopt;
+    }
+    else
+    {
+        for (uint32_t id = 0; id < symbolCount; ++id)
+            config.symbols.push_back({id, config.instrument});
+    }
+    if (config.egress_thread && config.shards == 0)
+    {
+        config.shards = 1; // 出口线程需要独立的撮合线程
+    }
+    if (config.io_threads == 0 || config.io_threads > MAX_IO_THREADS)
+    {
+        spdlog::error("Invalid config: io-threads must be in [1, {}]", MAX_IO_THREADS);
+        return std::nullopt;
+    }
+    if (config.io_threads > 1)
+    {
+        // 多个 I/O 线程不能同时调用订单簿：撮合必须在分片线程上进行
+        if (config.shards == 0)
+        {
+            spdlog::error("Invalid config: io-threads > 1 requires shards >= 1");
+            return std::nullopt;
+        }
+        // 出口线程的连接开关控制队列只有一个生产者
+        if (config.egress_thread)
+        {
+            spdlog::error("Invalid config: io-threads > 1 cannot be combined with egress-thread");
+            return std::nullopt;
+        }
+    }
+    if (config.io_uring)
+    {
+        // 提供缓冲区编号只有 16 位，环的容量上限 32768
+        if (config.uring_entries == 0 || config.uring_buffers == 0 || config.uring_buffers > 32768 ||
+            (config.uring_buffers & (config.uring_buffers - 1)) != 0 || config.uring_buffer_size == 0)
+        {
+            spdlog::error("Invalid config: uring-buffers must be a power of 2 in [1, 32768], "
+                          "uring-entries and uring-buffer-size must be positive");
+            return std::nullopt;
+        }
+        // 出口线程直接对 socket 做非阻塞 writev，与 io_uring 的异步写不能同时进行
+        if (config.egress_thread)
+        {
+            spdlog::error("Invalid config: io-backend=uring cannot be combined with egress-thread");
+            return std::nullopt;
+        }
+    }
+    if (!config.shard_cpus.empty() && config.shards == 0)
+    {
+        spdlog::error("Invalid config: shard-cpus requires shards >= 1");
+        return std::nullopt;
+    }
+    if (config.risk_threads > 0)
+    {
+        // 风控线程把指令转发给撮合线程，不能在 I/O 线程内联撮合
+        if (config.shards == 0)
+        {
+            spdlog::error("Invalid config: risk-threads requires shards >= 1");
+            return std::nullopt;
+        }
+        if (config.risk_threads > MAX_RISK_THREADS)
+        {
+            spdlog::error("Invalid config: risk-threads must be at most {}", MAX_RISK_THREADS);
+            return std::nullopt;
+        }
+    }
+    else if (config.risk.any() || !config.risk_cpus.empty())
+    {
+        spdlog::error("Invalid config: risk limits and risk-cpus require risk-threads >= 1");
+        return std::nullopt;
+    }
+    if (config.risk.max_order_qty < 0 || config.risk.price_band < 0 || config.risk.max_notional < 0)
+    {
+        spdlog::error("Invalid config: risk limits must not be negative");
+        return std::nullopt;
+    }
+    if (!validCpuList(config.io_cpus, config.io_threads, "io-cpus", "io-threads") ||
+        !validCpuList(config.shard_cpus, config.shards, "shard-cpus", "shards") ||
+        !validCpuList(config.risk_cpus, config.risk_threads, "risk-cpus", "risk-threads"))
+        return std::nullopt;
+    if (config.rt_priority < 0 || config.rt_priority > 99)
+    {
+        spdlog::error("Invalid config: rt-priority must be in [0, 99]");
+        return std::nullopt;
+    }
+    if (!config.journal_dir.empty() && config.journal_segment_size < (1u << 16))
+    {
+        spdlog::error("Invalid config: journal-segment-size must be at least 65536");
+        return std::nullopt;
+    }
+    if (config.md_snapshot_interval_ms == 0 || config.md_tob_interval_ms == 0)
+    {
+        spdlog::error("Invalid config: md-snapshot-interval-ms and md-tob-interval-ms must be positive");
+        return std::nullopt;
+    }
+    if (config.snapshot_interval_sec > 0 && config.journal_dir.empty())
+    {
+        spdlog::error("Invalid config: snapshot-interval requires journal-dir");
+        return std::nullopt;
+    }
+    if (!config.shm_prefix.empty())
+    {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        if (config.shm_prefix[0] != '/' || config.shm_prefix.find('/', 1) != std::string::npos)
+        {
+            spdlog::error("Invalid config: shm-prefix must look like /name");
+            return std::nullopt;
+        }
+        if (config.shm_slots == 0 || config.shm_ring_size % page != 0 ||
+            config.shm_ring_size < MessageCodec::MAX_FRAME_SIZE)
+        {
+            spdlog::error("Invalid config: shm-slots must be positive and shm-ring-size a page multiple >= {}",
+                          MessageCodec::MAX_FRAME_SIZE);
+            return std::nullopt;
+        }
+        if (config.egress_thread)
+        {
+            // 出口线程直接写 socket fd，共享内存会话的回报环只能由 I/O 线程写
+            spdlog::error("Invalid config: shm-prefix cannot be combined with egress-thread");
+            return std::nullopt;
+        }
+    }
+    if (config.symbols.empty() || config.queue_capacity == 0 || config.output_buffer_size < 4096)
+    {
+        spdlog::error("Invalid config: at least one symbol, a positive queue-capacity and output-buffer-size >= 4096 are required");
+        return std::nullopt;
+    }
+    return config;
+}
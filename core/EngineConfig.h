@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Instrument.h"
+#include "RiskLimits.h"
+#include "utils/ThreadTuning.h"
+
+struct SymbolConfig
+{
+    uint32_t symbol_id;
+    InstrumentSpec spec;
+};
+
+// 引擎启动配置，由命令行参数 --key=value 覆盖默认值
+struct EngineConfig
+{
+    int port = 9999;
+    InstrumentSpec instrument;            // 默认品种参数（tick 大小、价格阶梯）
+    uint32_t order_pool_size = 1u << 20;  // 每个撮合分片预分配的订单记录数
+    std::vector<SymbolConfig> symbols;    // 品种表；为空时按 --symbols=N 生成 0..N-1
+    uint32_t shards = 0;                  // 撮合线程数，0 表示在 I/O 线程内联撮合
+    uint32_t io_threads = 1;              // I/O 线程（反应器）数，大于 1 时各自 SO_REUSEPORT 监听（需 shards >= 1）
+    bool io_uring = false;                // I/O 后端：true 用 io_uring（不可用时退回 epoll），false 用 epoll
+    uint32_t uring_entries = 4096;        // io_uring 提交队列深度
+    uint32_t uring_buffers = 1024;        // 每个 I/O 线程的 recv 提供缓冲区个数（2 的幂）
+    uint32_t uring_buffer_size = 16384;   // 每个提供缓冲区的字节数
+    IdleStrategy idle = IdleStrategy::BLOCK; // I/O 与撮合线程的空闲策略（出口线程始终阻塞）
+    uint32_t idle_spin_us = 100;          // spin-yield：连续空闲多少微秒后开始让出 CPU
+    std::vector<int> io_cpus;             // 各 I/O 线程绑定的 CPU，为空不绑定，否则个数等于 io_threads
+    std::vector<int> shard_cpus;          // 各撮合线程绑定的 CPU，为空不绑定，否则个数等于 shards
+    int rt_priority = 0;                  // I/O 与撮合线程的 SCHED_FIFO 优先级，0 保持普通调度
+    uint32_t busy_poll_us = 0;            // socket 的 SO_BUSY_POLL 微秒数，0 关闭
+    uint32_t queue_capacity = 1u << 16;   // 分片输入 / 输出队列容量
+    bool egress_thread = false;           // 流水线模式：回报由独立出口线程发送（隐含 shards >= 1）
+    uint32_t stats_interval_sec = 0;      // 流水线计数器日志间隔，0 表示关闭
+    uint32_t recv_buffer_size = 1u << 17;   // 每个连接的接收环形缓冲区字节数
+    uint32_t output_buffer_size = 1u << 20; // 每个连接的发送缓冲区字节数
+    std::string journal_dir;              // 预写日志目录，空串关闭；启动时重放其中已有的日志
+    uint64_t journal_segment_size = 64ull << 20; // 日志段文件预分配字节数
+    bool journal_sync = true;             // 组提交时 fdatasync；关闭后只防进程崩溃、不防掉电
+    uint32_t snapshot_interval_sec = 0;   // 订单簿快照间隔（写入 journal_dir），0 表示关闭
+    std::string event_log = "logs/events.bin"; // 热路径二进制事件日志，空串关闭
+    uint32_t event_log_ring = 1u << 15;   // 每个线程的事件环容量（条），满时丢弃
+    uint32_t max_batch = 64;              // 每批最多处理的帧 / 指令 / 回报数，批末统一唤醒与写出，0 不限
+    int md_port = 0;                      // 行情 TCP 订阅端口，0 关闭
+    std::string md_multicast;             // 行情增量与快照的 UDP 目的地 ADDR:PORT，空串关闭
+    std::string md_tob_multicast;         // 合并最优价的 UDP 目的地 ADDR:PORT，空串关闭
+    std::string md_interface;             // 组播出口地址，空串由内核选择
+    uint32_t md_snapshot_interval_ms = 1000; // 行情全量快照间隔
+    uint32_t md_tob_interval_ms = 100;    // 合并最优价的发布间隔
+    bool throttle_slow_consumers = false; // 慢消费者：true 暂停读取，false 断开连接
+    std::string shm_prefix;               // 共享内存传输的槽位名前缀（如 /matching-engine），空串关闭
+    uint32_t shm_slots = 4;               // 共享内存会话槽位数
+    uint32_t shm_ring_size = 1u << 20;    // 每个槽位每个方向的环形缓冲区字节数
+    uint32_t risk_threads = 0;            // 事前风控线程数（按 user_id 分片），0 关闭；需要 shards >= 1
+    std::vector<int> risk_cpus;           // 各风控线程绑定的 CPU，为空不绑定，否则个数等于 risk_threads
+    RiskLimits risk;                      // 每个用户的风控限额
+};
+
+// 解析命令行，参数非法时返回 std::nullopt
+std::optional<EngineConfig> parseEngineConfig(int argc, char **argv);
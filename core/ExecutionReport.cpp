@@ -0,0 +1,17 @@
+#include "ExecutionReport.h"
+#include <cstring>
+
+std::vector<uint8_t> ExecutionReport::serialize() const
+{
+    std::vector<uint8_t> payload(WIRE_SIZE);
+    serializeTo(payload.data());
+    return payload;
+}
+
+void ExecutionReport::serializeTo(uint8_t *out) const
+{
+    auto *msg = reinterpret_cast<wire::ExecutionReport *>(out);
+    std::memcpy(msg->order_id, order_id.data, sizeof(msg->order_id));
+    msg->exec_type = static_cast<uint8_t>(exec_type);
+    msg->leaves_qty = leaves_qty;
+}
@@ -1,20 +1,24 @@
 #pragma once
-#include <string>
 #include <cstdint>
-
-enum class ExecType : uint8_t
-{
-    NEW = 0,
-    PARTIAL_FILL = 1,
-    FILL = 2,
-    CANCELED = 3
-};
+#include <type_traits>
+#include <vector>
+#include "FixedString.h"
+#include "protocol/WireMessages.h"
 
 struct ExecutionReport
 {
-    std::string order_id;
+    OrderId order_id;
     double price;
     int32_t last_shares;
     int32_t leaves_qty;
     ExecType exec_type;
-};
\ No newline at end of file
+
+    // 线上格式为 wire::ExecutionReport（简化）：order_id + exec_type + leaves_qty
+    static constexpr size_t WIRE_SIZE = sizeof(wire::ExecutionReport);
+    std::vector<uint8_t> serialize() const;
+    // 写入调用方提供的 WIRE_SIZE 字节缓冲区，不分配内存
+    void serializeTo(uint8_t *out) const;
+};
+// 回报在撮合线程、输出队列与 IO 线程之间按值拷贝，须保持平凡可复制、不含堆内存
+static_assert(std::is_trivially_copyable<ExecutionReport>::value, "ExecutionReport must be trivially copyable");
+static_assert(sizeof(ExecutionReport) == 56, "ExecutionReport should stay within one cache line");
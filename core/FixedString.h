@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// 定长、以 \0 填充的字符串，与线上协议的定长字段一一对应。
+// 可平凡拷贝，比较和哈希都不涉及堆分配。
+template <size_t N>
+struct FixedString
+{
+    char data[N] = {};
+
+    // 从线上定长字段构造；第一个 \0 之后的字节清零，保证按字节比较有效
+    static FixedString fromBytes(const uint8_t *bytes)
+    {
+        FixedString s;
+        std::memcpy(s.data, bytes, N);
+        size_t len = strnlen(s.data, N);
+        std::memset(s.data + len, 0, N - len);
+        return s;
+    }
+
+    static FixedString fromString(std::string_view str)
+    {
+        FixedString s;
+        std::memcpy(s.data, str.data(), str.size() < N ? str.size() : N);
+        return s;
+    }
+
+    std::string_view view() const { return std::string_view(data, strnlen(data, N)); }
+    std::string str() const { return std::string(view()); }
+    bool empty() const { return data[0] == '\0'; }
+
+    bool operator==(const FixedString &other) const { return std::memcmp(data, other.data, N) == 0; }
+    bool operator!=(const FixedString &other) const { return !(*this == other); }
+};
+
+using UserId = FixedString<16>;
+using OrderId = FixedString<32>;
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+
+// 价格以整数 tick 表示：ticks = (price - base_price) / tick_size
+using Ticks = int64_t;
+
+struct InstrumentSpec
+{
+    double tick_size = 0.001;  // 最小变动价位
+    double base_price = 0.0;   // 价格阶梯起点（tick 0 对应的价格）
+    uint32_t num_levels = 1u << 18; // 价格阶梯档位数
+
+    // 价格 -> tick，价格不在 tick 网格上或越界时返回 -1
+    Ticks toTicks(double price) const
+    {
+        double raw = (price - base_price) / tick_size;
+        Ticks ticks = std::llround(raw);
+        if (std::fabs(raw - static_cast<double>(ticks)) > 1e-6 ||
+            ticks < 0 || ticks >= static_cast<Ticks>(num_levels))
+        {
+            return -1;
+        }
+        return ticks;
+    }
+
+    double toPrice(Ticks ticks) const
+    {
+        return base_price + static_cast<double>(ticks) * tick_size;
+    }
+};
@@ -0,0 +1,434 @@
+#include "Journal.h"
+#include "utils/Logger.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+constexpr char MAGIC[8] = {'M', 'E', 'J', 'R', 'N', 'L', '1', '\0'};
+constexpr uint32_t VERSION = 1;
+constexpr uint64_t HEADER_SIZE = 64; // 段头占一条缓存行，记录从 64 字节处开始
+
+struct SegmentHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t shard;
+    uint32_t shard_count;
+    uint32_t segment;
+    uint32_t reserved;
+    uint64_t first_seq;
+    uint64_t segment_size;
+};
+static_assert(sizeof(SegmentHeader) <= HEADER_SIZE, "segment header must fit in HEADER_SIZE");
+
+#pragma pack(push, 1)
+struct JournalRecord
+{
+    uint64_t seq; // 从 1 开始，0 表示空槽
+    uint8_t type;
+    uint8_t side;
+    uint8_t order_type; // OrderType，旧日志中为 0（限价单）；MASS_CANCEL 为范围
+    uint8_t flags;      // REPLACE_ORDER：RECORD_RISK_BUDGET，旧日志中为 0
+    uint32_t symbol_id;
+    double price;
+    int32_t quantity;
+    int32_t remaining_quantity;
+    union
+    {
+        uint64_t timestamp; // NEW_ORDER
+        double risk_budget; // REPLACE_ORDER：风控线程给出的额度，重放时做同样的检查
+    };
+    uint64_t conn_id; // 挂单的所属会话，重放时用于重建会话索引（按会话批量撤单）
+    char user_id[16];  // REPLACE_ORDER 为消息所带的订单所属用户（旧格式为空）
+    char order_id[32]; // NEW_ORDER 为订单号，CANCEL_ORDER / REPLACE_ORDER 为目标订单号
+    uint32_t checksum;
+    uint32_t padding;
+};
+#pragma pack(pop)
+static_assert(sizeof(JournalRecord) == 104, "JournalRecord layout is part of the file format");
+constexpr uint8_t RECORD_RISK_BUDGET = 1;
+
+// FNV-1a，覆盖 checksum 之前的全部字节
+uint32_t checksumOf(const JournalRecord &rec)
+{
+    const auto *p = reinterpret_cast<const uint8_t *>(&rec);
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(JournalRecord, checksum); ++i)
+    {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+JournalRecord toRecord(uint64_t seq, const EngineCommand &cmd)
+{
+    JournalRecord rec{};
+    rec.seq = seq;
+    rec.type = static_cast<uint8_t>(cmd.type);
+    rec.symbol_id = cmd.symbol_id;
+    rec.conn_id = cmd.conn_id;
+    if (cmd.type == CommandType::NEW_ORDER)
+    {
+        const Order &o = cmd.order;
+        rec.side = static_cast<uint8_t>(o.side);
+        rec.order_type = static_cast<uint8_t>(o.type);
+        rec.price = o.price;
+        rec.quantity = o.quantity;
+        rec.remaining_quantity = o.remaining_quantity;
+        rec.timestamp = o.timestamp;
+        std::memcpy(rec.user_id, o.user_id.data, sizeof(rec.user_id));
+        std::memcpy(rec.order_id, o.order_id.data, sizeof(rec.order_id));
+    }
+    else if (cmd.type == CommandType::MASS_CANCEL)
+    {
+        rec.side = cmd.mass_side;
+        rec.order_type = cmd.mass_scope;
+        std::memcpy(rec.user_id, cmd.order.user_id.data, sizeof(rec.user_id));
+    }
+    else
+    {
+        std::memcpy(rec.order_id, cmd.cancel_id.data, sizeof(rec.order_id));
+        if (cmd.type == CommandType::REPLACE_ORDER)
+        {
+            rec.price = cmd.order.price;
+            rec.quantity = cmd.order.quantity;
+            std::memcpy(rec.user_id, cmd.order.user_id.data, sizeof(rec.user_id));
+            if (cmd.flags & COMMAND_RISK_BUDGET)
+            {
+                rec.flags = RECORD_RISK_BUDGET;
+                rec.risk_budget = cmd.risk_budget;
+            }
+        }
+    }
+    rec.checksum = checksumOf(rec);
+    return rec;
+}
+
+EngineCommand fromRecord(const JournalRecord &rec)
+{
+    EngineCommand cmd{};
+    cmd.type = static_cast<CommandType>(rec.type);
+    cmd.symbol_id = rec.symbol_id;
+    cmd.conn_id = rec.conn_id;
+    if (cmd.type == CommandType::NEW_ORDER)
+    {
+        Order &o = cmd.order;
+        o.side = static_cast<OrderSide>(rec.side);
+        o.type = static_cast<OrderType>(rec.order_type);
+        o.price = rec.price;
+        o.quantity = rec.quantity;
+        o.remaining_quantity = rec.remaining_quantity;
+        o.timestamp = rec.timestamp;
+        o.symbol_id = rec.symbol_id;
+        o.user_id = UserId::fromBytes(reinterpret_cast<const uint8_t *>(rec.user_id));
+        o.order_id = OrderId::fromBytes(reinterpret_cast<const uint8_t *>(rec.order_id));
+    }
+    else if (cmd.type == CommandType::MASS_CANCEL)
+    {
+        cmd.mass_side = rec.side;
+        cmd.mass_scope = rec.order_type;
+        cmd.order.user_id = UserId::fromBytes(reinterpret_cast<const uint8_t *>(rec.user_id));
+    }
+    else
+    {
+        cmd.cancel_id = OrderId::fromBytes(reinterpret_cast<const uint8_t *>(rec.order_id));
+        if (cmd.type == CommandType::REPLACE_ORDER)
+        {
+            cmd.order.price = rec.price;
+            cmd.order.quantity = rec.quantity;
+            cmd.order.user_id = UserId::fromBytes(reinterpret_cast<const uint8_t *>(rec.user_id));
+            if (rec.flags & RECORD_RISK_BUDGET)
+            {
+                cmd.flags = COMMAND_RISK_BUDGET;
+                cmd.risk_budget = rec.risk_budget;
+            }
+        }
+    }
+    return cmd;
+}
+} // namespace
+
+Journal::Journal(const JournalOptions &options) : options_(options)
+{
+}
+
+Journal::~Journal()
+{
+    commit();
+    unmapSegment();
+}
+
+std::string Journal::segmentPath(uint32_t segment) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/shard-%u-%06u.journal", options_.shard, segment);
+    return options_.dir + name;
+}
+
+bool Journal::mapSegment(uint32_t segment, bool create)
+{
+    std::string path = segmentPath(segment);
+    int flags = create ? (O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC) : (O_RDWR | O_CLOEXEC);
+    int fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0)
+    {
+        if (!create && errno == ENOENT)
+            return false; // 没有更多段
+        spdlog::error("Journal: cannot open {}: {}", path, strerror(errno));
+        return false;
+    }
+
+    uint64_t size = options_.segment_size;
+    if (create)
+    {
+        // 预分配：追加时不再扩展文件，fdatasync 也不必写元数据
+        int rc = posix_fallocate(fd, 0, static_cast<off_t>(size));
+        if (rc != 0)
+        {
+            spdlog::error("Journal: cannot preallocate {} ({} bytes): {}", path, size, strerror(rc));
+            ::close(fd);
+            unlink(path.c_str());
+            return false;
+        }
+    }
+    else
+    {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < HEADER_SIZE + sizeof(JournalRecord))
+        {
+            spdlog::error("Journal: segment {} is truncated", path);
+            ::close(fd);
+            return false;
+        }
+        size = static_cast<uint64_t>(st.st_size);
+    }
+
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        spdlog::error("Journal: mmap {} failed: {}", path, strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    auto *header = static_cast<SegmentHeader *>(addr);
+    if (create)
+    {
+        std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+        header->version = VERSION;
+        header->record_size = sizeof(JournalRecord);
+        header->shard = options_.shard;
+        header->shard_count = options_.shard_count;
+        header->segment = segment;
+        header->first_seq = nextSeq_;
+        header->segment_size = size;
+        if (options_.sync)
+            fdatasync(fd);
+    }
+    else if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION ||
+             header->record_size != sizeof(JournalRecord) || header->shard != options_.shard)
+    {
+        spdlog::error("Journal: {} is not a valid segment for shard {}", path, options_.shard);
+        munmap(addr, size);
+        ::close(fd);
+        return false;
+    }
+    else if (header->shard_count != options_.shard_count)
+    {
+        spdlog::error("Journal: {} was written with {} shard(s), engine runs {}; symbol routing would differ",
+                      path, header->shard_count, options_.shard_count);
+        munmap(addr, size);
+        ::close(fd);
+        return false;
+    }
+
+    if (segments_.empty() || segments_.back().first < segment)
+        segments_.emplace_back(segment, header->first_seq);
+    unmapSegment();
+    fd_ = fd;
+    base_ = static_cast<uint8_t *>(addr);
+    mappedSize_ = size;
+    segment_ = segment;
+    writePos_ = HEADER_SIZE;
+    commitPos_ = writePos_;
+    return true;
+}
+
+void Journal::unmapSegment()
+{
+    if (base_)
+    {
+        munmap(base_, mappedSize_);
+        base_ = nullptr;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool Journal::open(uint64_t snapshotSeq, const std::function<void(uint64_t, const EngineCommand &)> &replay)
+{
+    if (mkdir(options_.dir.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        spdlog::error("Journal: cannot create directory {}: {}", options_.dir, strerror(errno));
+        return false;
+    }
+
+    // 快照之前的段可能已被删除，按目录中实际存在的段号排序扫描
+    std::vector<uint32_t> segments;
+    if (DIR *dir = opendir(options_.dir.c_str()))
+    {
+        while (dirent *entry = readdir(dir))
+        {
+            unsigned shard = 0, segment = 0;
+            int end = 0;
+            if (sscanf(entry->d_name, "shard-%u-%u.journal%n", &shard, &segment, &end) == 2 &&
+                entry->d_name[end] == '\0' && shard == options_.shard && segment > 0)
+            {
+                segments.push_back(segment);
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(segments.begin(), segments.end());
+
+    uint64_t replayed = 0;
+    for (uint32_t segment : segments)
+    {
+        if (!mapSegment(segment, false))
+            return false;
+        uint64_t firstSeq = reinterpret_cast<const SegmentHeader *>(base_)->first_seq;
+        if (segments_.size() == 1)
+        {
+            if (firstSeq > snapshotSeq + 1)
+            {
+                spdlog::error("Journal: shard {} starts at seq {} but the snapshot ends at seq {}; records are missing",
+                              options_.shard, firstSeq, snapshotSeq);
+                return false;
+            }
+            nextSeq_ = firstSeq;
+        }
+        else if (firstSeq != nextSeq_)
+        {
+            spdlog::error("Journal: shard {} segment {} starts at seq {}, expected {}",
+                          options_.shard, segment, firstSeq, nextSeq_);
+            return false;
+        }
+
+        // 顺序扫描到第一个空槽或校验失败的记录
+        while (writePos_ + sizeof(JournalRecord) <= mappedSize_)
+        {
+            JournalRecord rec;
+            std::memcpy(&rec, base_ + writePos_, sizeof(rec));
+            if (rec.seq == 0)
+                break;
+            if (rec.seq != nextSeq_ || rec.checksum != checksumOf(rec))
+            {
+                spdlog::warn("Journal: shard {} segment {} ends with a torn record at seq {}",
+                             options_.shard, segment, nextSeq_);
+                // 截断：清掉残缺记录，之后从这里继续追加
+                std::memset(base_ + writePos_, 0, sizeof(JournalRecord));
+                break;
+            }
+            if (rec.seq > snapshotSeq)
+            {
+                replay(rec.seq, fromRecord(rec));
+                ++replayed;
+            }
+            ++nextSeq_;
+            writePos_ += sizeof(JournalRecord);
+        }
+    }
+
+    if (!base_)
+    {
+        nextSeq_ = snapshotSeq + 1;
+        if (!mapSegment(1, true))
+            return false;
+    }
+    else if (nextSeq_ <= snapshotSeq)
+    {
+        // 未同步的日志尾部在掉电中丢失，但快照已落盘：从快照之后另起一段
+        spdlog::warn("Journal: shard {} ends at seq {} before snapshot seq {}; continuing after the snapshot",
+                     options_.shard, lastSeq(), snapshotSeq);
+        nextSeq_ = snapshotSeq + 1;
+        if (!mapSegment(segment_ + 1, true))
+            return false;
+    }
+    commitPos_ = writePos_;
+    if (replayed > 0)
+    {
+        spdlog::info("Journal: shard {} replayed {} command(s) after seq {}, last seq {}",
+                     options_.shard, replayed, snapshotSeq, lastSeq());
+    }
+    return true;
+}
+
+size_t Journal::releaseThrough(uint64_t seq)
+{
+    size_t released = 0;
+    // 段 i 的最后一条记录是段 i+1 的首条序号减一
+    while (segments_.size() > 1 && segments_[1].second - 1 <= seq)
+    {
+        std::string path = segmentPath(segments_.front().first);
+        if (unlink(path.c_str()) != 0 && errno != ENOENT)
+        {
+            spdlog::warn("Journal: cannot remove {}: {}", path, strerror(errno));
+            break;
+        }
+        segments_.erase(segments_.begin());
+        ++released;
+    }
+    return released;
+}
+
+uint64_t Journal::append(const EngineCommand &cmd)
+{
+    if (!base_ || failed_)
+        return 0;
+    if (writePos_ + sizeof(JournalRecord) > mappedSize_)
+    {
+        // 段写满：先提交旧段再切换，新段按配置大小预分配
+        if (!commit() || !mapSegment(segment_ + 1, true))
+            return 0;
+    }
+
+    JournalRecord rec = toRecord(nextSeq_, cmd);
+    std::memcpy(base_ + writePos_, &rec, sizeof(rec));
+    writePos_ += sizeof(JournalRecord);
+    dirty_ = true;
+    return nextSeq_++;
+}
+
+bool Journal::commit()
+{
+    if (failed_)
+        return false;
+    if (!dirty_)
+        return true;
+    dirty_ = false;
+    ++commits_;
+    if (options_.sync && fdatasync(fd_) != 0)
+    {
+        // 这批记录是否落盘未知，而调用方会拒绝它们：清零使重放止于上次提交处（序号为 0 即日志末尾）
+        spdlog::error("Journal: fdatasync failed on shard {}: {}", options_.shard, strerror(errno));
+        std::memset(base_ + commitPos_, 0, writePos_ - commitPos_);
+        nextSeq_ -= (writePos_ - commitPos_) / sizeof(JournalRecord);
+        writePos_ = commitPos_;
+        failed_ = true;
+        return false;
+    }
+    commitPos_ = writePos_;
+    return true;
+}
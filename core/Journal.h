@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "EngineCommand.h"
+
+// 输入预写日志（WAL）。每个撮合分片一份，由若干预分配的段文件组成：
+//   <dir>/shard-<分片号>-<段号>.journal
+// 段文件用 MAP_SHARED 映射，追加只是一次定长 memcpy；进程崩溃后已写入的页仍在
+// 页缓存中，commit() 的 fdatasync 保证掉电后也不丢。一批指令只 commit 一次（组提交），
+// 回报在 commit 之后才对外可见。
+//
+// 记录定长、带校验和：段内第一个序号为 0 或校验失败的记录即为日志末尾
+// （未写入或写了一半），重放到此为止，之后从这里继续追加。
+//
+// 有快照时只重放快照序号之后的记录；快照完整覆盖的旧段由 releaseThrough 删除，
+// 段号因此不一定从 1 开始，但相邻段的序号必须连续。
+struct JournalOptions
+{
+    std::string dir;
+    uint32_t shard = 0;
+    uint32_t shard_count = 1;            // 写入段头，重放时分片数不一致则拒绝启动
+    uint64_t segment_size = 64ull << 20; // 每个段文件的预分配字节数
+    bool sync = true;                    // commit 时是否 fdatasync
+};
+
+class Journal
+{
+public:
+    explicit Journal(const JournalOptions &options);
+    ~Journal();
+
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    // 按序扫描已有的全部段，序号大于 snapshotSeq 的记录各回调一次，之后定位到末尾准备追加。
+    // 目录不存在时创建；段头不合法、分片数不一致或日志与快照之间有缺口时返回 false
+    bool open(uint64_t snapshotSeq, const std::function<void(uint64_t seq, const EngineCommand &)> &replay);
+
+    // 追加一条指令并返回其序号；段写满时切换到新段，失败（或日志已失效）返回 0
+    uint64_t append(const EngineCommand &cmd);
+    // 组提交：把上次 commit 以来追加的记录刷到磁盘。fdatasync 失败时清除这些记录并返回 false，
+    // 之后日志失效：append 一律失败，不再接受新的指令
+    bool commit();
+    bool failed() const { return failed_; }
+
+    // 删除记录全部不晚于 seq 的旧段（快照已覆盖），当前段保留。返回删除的段数
+    size_t releaseThrough(uint64_t seq);
+
+    uint64_t lastSeq() const { return nextSeq_ - 1; }
+    const JournalOptions &options() const { return options_; }
+    uint64_t commits() const { return commits_; }
+
+private:
+    bool mapSegment(uint32_t segment, bool create);
+    void unmapSegment();
+    std::string segmentPath(uint32_t segment) const;
+
+    JournalOptions options_;
+    int fd_ = -1;
+    uint8_t *base_ = nullptr;
+    uint64_t mappedSize_ = 0;   // 当前段的映射长度（旧段可能与配置的段大小不同）
+    uint32_t segment_ = 0;      // 当前段号，从 1 开始
+    uint64_t writePos_ = 0;     // 当前段内下一条记录的偏移
+    uint64_t commitPos_ = 0;    // 当前段内最近一次提交成功时的 writePos_
+    uint64_t nextSeq_ = 1;
+    std::vector<std::pair<uint32_t, uint64_t>> segments_; // 现存的段：(段号, 首条序号)，按段号递增
+    bool dirty_ = false;
+    bool failed_ = false;
+    uint64_t commits_ = 0;
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <thread>
+#include "Order.h"
+#include "Instrument.h"
+#include "utils/SpscQueue.h"
+#include "utils/WaitNotifier.h"
+
+// 订单簿变化事件：撮合线程产生、行情发布线程消费。只携带价位聚合后的结果，
+// 新增 / 修改 / 删除的区分和序号都由发布线程负责，撮合侧每次变化只是一次入队
+enum class MarketDataEventType : uint8_t
+{
+    LEVEL = 1, // 价位的最新聚合数量与订单数，数量为 0 表示价位已空
+    TRADE = 2  // 一笔成交，side 为主动方
+};
+
+struct MarketDataEvent
+{
+    MarketDataEventType type;
+    OrderSide side;
+    uint32_t symbol_id;
+    Ticks ticks;
+    int64_t quantity;
+    uint32_t count;
+};
+
+// 一个撮合分片到发布线程的事件通道
+class MarketDataChannel
+{
+public:
+    MarketDataChannel(uint32_t capacity, WaitNotifier &notifier) : queue_(capacity), notifier_(notifier) {}
+
+    // 生产者调用。队列满时唤醒发布线程并等待：丢事件会让下游的订单簿镜像失真
+    void push(const MarketDataEvent &event)
+    {
+        while (!queue_.push(event))
+        {
+            notifier_.wake();
+            std::this_thread::yield();
+        }
+        pending_ = true;
+    }
+
+    // 生产者在批末调用：本批有新事件时唤醒发布线程一次
+    void flush()
+    {
+        if (pending_)
+        {
+            pending_ = false;
+            notifier_.notify();
+        }
+    }
+
+    // 发布线程调用
+    template <typename Fn>
+    size_t drain(Fn &&fn, size_t limit)
+    {
+        size_t n = 0;
+        while (n < limit)
+        {
+            const MarketDataEvent *event = queue_.front();
+            if (!event)
+                break;
+            fn(*event);
+            queue_.pop();
+            ++n;
+        }
+        return n;
+    }
+
+    bool empty() const { return queue_.empty(); }
+
+private:
+    SpscQueue<MarketDataEvent> queue_;
+    WaitNotifier &notifier_;
+    bool pending_ = false; // 仅生产者访问
+};
@@ -0,0 +1,534 @@
+#include "MarketDataPublisher.h"
+#include "utils/Logger.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+constexpr size_t DRAIN_LIMIT = 1024; // 每个通道每轮至多取出的事件数
+
+// 收集一串消息，按 MTU 切包；SNAPSHOT / TOP_OF_BOOK 的每个包 seq 相同
+class PacketBuilder
+{
+public:
+    PacketBuilder(MdChannel channel, uint64_t seq, const std::function<void(const uint8_t *, size_t)> &emit)
+        : channel_(channel), seq_(seq), emit_(emit) {}
+    ~PacketBuilder() { finish(); }
+
+    void add(const MdMessage &msg)
+    {
+        if (count_ == MD_MAX_MESSAGES)
+            finish();
+        std::memcpy(buffer_ + sizeof(MdPacketHeader) + count_ * sizeof(MdMessage), &msg, sizeof(msg));
+        ++count_;
+    }
+
+    void finish()
+    {
+        if (count_ == 0)
+            return;
+        MdPacketHeader header{};
+        header.channel = static_cast<uint8_t>(channel_);
+        header.count = count_;
+        header.seq = seq_;
+        std::memcpy(buffer_, &header, sizeof(header));
+        emit_(buffer_, sizeof(MdPacketHeader) + count_ * sizeof(MdMessage));
+        count_ = 0;
+    }
+
+private:
+    MdChannel channel_;
+    uint64_t seq_;
+    const std::function<void(const uint8_t *, size_t)> &emit_;
+    uint8_t buffer_[MD_MAX_PACKET];
+    uint16_t count_ = 0;
+};
+
+bool parseEndpoint(const std::string &text, sockaddr_in &addr)
+{
+    auto colon = text.rfind(':');
+    if (colon == std::string::npos)
+        return false;
+    addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(std::atoi(text.c_str() + colon + 1)));
+    return addr.sin_port != 0 && inet_pton(AF_INET, text.substr(0, colon).c_str(), &addr.sin_addr) == 1;
+}
+
+int openUdp(const std::string &endpoint, const std::string &interfaceAddr, sockaddr_in &addr)
+{
+    if (!parseEndpoint(endpoint, addr))
+    {
+        spdlog::error("Market data: invalid UDP endpoint '{}', expected ADDR:PORT", endpoint);
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (IN_MULTICAST(ntohl(addr.sin_addr.s_addr)))
+    {
+        // 默认只在本机和本网段内可见，本机订阅者也能收到
+        unsigned char ttl = 1, loop = 1;
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        if (!interfaceAddr.empty())
+        {
+            in_addr iface{};
+            if (inet_pton(AF_INET, interfaceAddr.c_str(), &iface) != 1 ||
+                setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) != 0)
+            {
+                spdlog::error("Market data: cannot use interface {} for multicast", interfaceAddr);
+                close(fd);
+                return -1;
+            }
+        }
+    }
+    spdlog::info("Market data: publishing to udp://{}", endpoint);
+    return fd;
+}
+} // namespace
+
+MarketDataPublisher::MarketDataPublisher(const std::vector<SymbolConfig> &symbols, size_t channelCount,
+                                         uint32_t queueCapacity, const MarketDataOptions &options)
+    : options_(options)
+{
+    for (size_t i = 0; i < channelCount; ++i)
+        channels_.push_back(std::make_unique<MarketDataChannel>(queueCapacity, notifier_));
+    for (const auto &symbol : symbols)
+    {
+        books_[symbol.symbol_id].spec = symbol.spec;
+        symbolOrder_.push_back(symbol.symbol_id);
+    }
+    std::sort(symbolOrder_.begin(), symbolOrder_.end());
+}
+
+MarketDataPublisher::~MarketDataPublisher()
+{
+    stop();
+    for (auto &entry : subscribers_)
+        close(entry.first);
+    for (int fd : {listenFd_, udpFd_, tobUdpFd_, epollFd_})
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+bool MarketDataPublisher::start()
+{
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = notifier_.fd();
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, notifier_.fd(), &ev);
+
+    if (!options_.multicast.empty() &&
+        (udpFd_ = openUdp(options_.multicast, options_.interface_addr, udpAddr_)) < 0)
+        return false;
+    if (!options_.tob_multicast.empty() &&
+        (tobUdpFd_ = openUdp(options_.tob_multicast, options_.interface_addr, tobUdpAddr_)) < 0)
+        return false;
+
+    if (options_.tcp_port > 0)
+    {
+        listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int opt = 1;
+        setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(options_.tcp_port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(listenFd_, 128) == -1)
+        {
+            spdlog::error("Market data: cannot listen on port {}: {}", options_.tcp_port, strerror(errno));
+            return false;
+        }
+        ev.events = EPOLLIN;
+        ev.data.fd = listenFd_;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &ev);
+        spdlog::info("Market data: TCP subscribers on port {}", options_.tcp_port);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    nextSnapshot_ = now + std::chrono::milliseconds(options_.snapshot_interval_ms);
+    nextTob_ = now + std::chrono::milliseconds(options_.tob_interval_ms);
+    running_.store(true);
+    thread_ = std::thread(&MarketDataPublisher::run, this);
+    return true;
+}
+
+void MarketDataPublisher::stop()
+{
+    if (!running_.exchange(false))
+        return;
+    notifier_.wake();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+bool MarketDataPublisher::hasPending() const
+{
+    for (const auto &channel : channels_)
+    {
+        if (!channel->empty())
+            return true;
+    }
+    return false;
+}
+
+template <typename Side>
+bool MarketDataPublisher::applyLevel(Side &side, const MarketDataEvent &event, MdMessage &msg)
+{
+    auto it = side.find(event.ticks);
+    if (event.quantity == 0)
+    {
+        if (it == side.end())
+            return false;
+        side.erase(it);
+        msg.type = static_cast<uint8_t>(MdMessageType::LEVEL_DELETE);
+        return true;
+    }
+    if (it == side.end())
+    {
+        side.emplace(event.ticks, Level{event.quantity, event.count});
+        msg.type = static_cast<uint8_t>(MdMessageType::LEVEL_ADD);
+        return true;
+    }
+    if (it->second.quantity == event.quantity && it->second.count == event.count)
+        return false;
+    it->second = Level{event.quantity, event.count};
+    msg.type = static_cast<uint8_t>(MdMessageType::LEVEL_CHANGE);
+    return true;
+}
+
+void MarketDataPublisher::apply(const MarketDataEvent &event)
+{
+    auto it = books_.find(event.symbol_id);
+    if (it == books_.end())
+        return;
+    BookMirror &book = it->second;
+
+    MdMessage msg{};
+    msg.side = static_cast<uint8_t>(event.side);
+    msg.symbol_id = event.symbol_id;
+    msg.price = book.spec.toPrice(event.ticks);
+    msg.quantity = event.quantity;
+    msg.order_count = event.count;
+    if (event.type == MarketDataEventType::TRADE)
+    {
+        msg.type = static_cast<uint8_t>(MdMessageType::TRADE);
+    }
+    else if (!(event.side == OrderSide::BUY ? applyLevel(book.bids, event, msg) : applyLevel(book.asks, event, msg)))
+    {
+        return; // 聚合结果没有变化
+    }
+    addIncremental(msg);
+}
+
+void MarketDataPublisher::addIncremental(const MdMessage &msg)
+{
+    if (incCount_ == MD_MAX_MESSAGES)
+        flushIncremental();
+    std::memcpy(incPacket_ + sizeof(MdPacketHeader) + incCount_ * sizeof(MdMessage), &msg, sizeof(msg));
+    ++incCount_;
+    ++nextSeq_;
+}
+
+void MarketDataPublisher::flushIncremental()
+{
+    if (incCount_ == 0)
+        return;
+    MdPacketHeader header{};
+    header.channel = static_cast<uint8_t>(MdChannel::INCREMENTAL);
+    header.count = incCount_;
+    header.seq = nextSeq_ - incCount_;
+    std::memcpy(incPacket_, &header, sizeof(header));
+    broadcast(MdChannel::INCREMENTAL, incPacket_, sizeof(MdPacketHeader) + incCount_ * sizeof(MdMessage));
+    incCount_ = 0;
+    published_.store(nextSeq_ - 1, std::memory_order_relaxed);
+}
+
+void MarketDataPublisher::writeSnapshot(const Emit &emit)
+{
+    size_t levels = 0;
+    for (const auto &entry : books_)
+        levels += entry.second.bids.size() + entry.second.asks.size();
+
+    PacketBuilder packets(MdChannel::SNAPSHOT, nextSeq_ - 1, emit);
+    MdMessage msg{};
+    msg.type = static_cast<uint8_t>(MdMessageType::SNAPSHOT_BEGIN);
+    msg.quantity = static_cast<int64_t>(levels);
+    packets.add(msg);
+
+    msg.type = static_cast<uint8_t>(MdMessageType::SNAPSHOT_LEVEL);
+    for (uint32_t symbolId : symbolOrder_)
+    {
+        const BookMirror &book = books_.at(symbolId);
+        msg.symbol_id = symbolId;
+        auto addSide = [&](const auto &side, OrderSide s)
+        {
+            msg.side = static_cast<uint8_t>(s);
+            for (const auto &level : side)
+            {
+                msg.price = book.spec.toPrice(level.first);
+                msg.quantity = level.second.quantity;
+                msg.order_count = level.second.count;
+                packets.add(msg);
+            }
+        };
+        addSide(book.bids, OrderSide::BUY);
+        addSide(book.asks, OrderSide::SELL);
+    }
+}
+
+void MarketDataPublisher::writeTopOfBook(const Emit &emit, bool changedOnly)
+{
+    PacketBuilder packets(MdChannel::TOP_OF_BOOK, nextSeq_ - 1, emit);
+    for (uint32_t symbolId : symbolOrder_)
+    {
+        BookMirror &book = books_.at(symbolId);
+        MdMessage bid{}, ask{};
+        bid.type = ask.type = static_cast<uint8_t>(MdMessageType::TOP_OF_BOOK);
+        bid.symbol_id = ask.symbol_id = symbolId;
+        bid.side = static_cast<uint8_t>(OrderSide::BUY);
+        ask.side = static_cast<uint8_t>(OrderSide::SELL);
+        if (!book.bids.empty())
+        {
+            bid.price = book.spec.toPrice(book.bids.begin()->first);
+            bid.quantity = book.bids.begin()->second.quantity;
+            bid.order_count = book.bids.begin()->second.count;
+        }
+        if (!book.asks.empty())
+        {
+            ask.price = book.spec.toPrice(book.asks.begin()->first);
+            ask.quantity = book.asks.begin()->second.quantity;
+            ask.order_count = book.asks.begin()->second.count;
+        }
+
+        if (changedOnly)
+        {
+            // 两次发布之间的所有中间状态合并为一条
+            if (std::memcmp(&bid, &book.sentBid, sizeof(bid)) == 0 &&
+                std::memcmp(&ask, &book.sentAsk, sizeof(ask)) == 0)
+                continue;
+            book.sentBid = bid;
+            book.sentAsk = ask;
+        }
+        packets.add(bid);
+        packets.add(ask);
+    }
+}
+
+void MarketDataPublisher::broadcast(MdChannel channel, const uint8_t *data, size_t len)
+{
+    bool tob = channel == MdChannel::TOP_OF_BOOK;
+    int udpFd = tob ? tobUdpFd_ : udpFd_;
+    if (udpFd >= 0)
+    {
+        const sockaddr_in &addr = tob ? tobUdpAddr_ : udpAddr_;
+        if (sendto(udpFd, data, len, 0, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0)
+            droppedPackets_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    MdSubscription wanted = tob ? MdSubscription::TOP_OF_BOOK : MdSubscription::INCREMENTAL;
+    for (auto &entry : subscribers_)
+    {
+        Subscriber &sub = *entry.second;
+        if (sub.subscribed && sub.mode == wanted)
+            sendTo(entry.first, sub, data, len);
+    }
+}
+
+void MarketDataPublisher::sendTo(int fd, Subscriber &sub, const uint8_t *data, size_t len)
+{
+    if (!sub.out.append(data, len))
+    {
+        spdlog::warn("Market data: subscriber fd={} is too slow ({} bytes pending), disconnecting",
+                     fd, sub.out.size());
+        sub.subscribed = false;
+        closing_.push_back(fd);
+        return;
+    }
+    if (!sub.dirty)
+    {
+        sub.dirty = true;
+        dirty_.push_back(fd);
+    }
+}
+
+void MarketDataPublisher::acceptSubscribers()
+{
+    int fd;
+    while ((fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1)
+    {
+        int opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        subscribers_[fd] = std::make_unique<Subscriber>(options_.output_buffer_size);
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+        subscriberCount_.store(subscribers_.size(), std::memory_order_relaxed);
+    }
+}
+
+void MarketDataPublisher::readSubscriber(int fd, Subscriber &sub)
+{
+    uint8_t buf[64];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        closing_.push_back(fd);
+        return;
+    }
+    if (n < static_cast<ssize_t>(sizeof(MdSubscribeRequest)) || sub.subscribed)
+        return; // 订阅请求只处理一次，之后收到的字节忽略
+
+    MdSubscribeRequest request;
+    std::memcpy(&request, buf, sizeof(request));
+    auto mode = static_cast<MdSubscription>(request.mode);
+    if (mode != MdSubscription::INCREMENTAL && mode != MdSubscription::TOP_OF_BOOK)
+    {
+        closing_.push_back(fd);
+        return;
+    }
+    // 先把已拼好的增量发给老订阅者，新订阅者的初始状态与其后的增量序号衔接
+    flushIncremental();
+    sub.mode = mode;
+    sub.subscribed = true;
+    Emit toSubscriber = [this, fd, &sub](const uint8_t *data, size_t len)
+    { sendTo(fd, sub, data, len); };
+    if (mode == MdSubscription::INCREMENTAL)
+        writeSnapshot(toSubscriber);
+    else
+        writeTopOfBook(toSubscriber, false);
+}
+
+void MarketDataPublisher::flushSubscriber(int fd, Subscriber &sub)
+{
+    if (sub.out.flush(fd) == OutputBuffer::FlushResult::ERROR)
+    {
+        closing_.push_back(fd);
+        return;
+    }
+    bool want = !sub.out.empty();
+    if (want == sub.writeInterest)
+        return;
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLRDHUP | (want ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    ev.data.fd = fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
+    sub.writeInterest = want;
+}
+
+void MarketDataPublisher::closeSubscriber(int fd)
+{
+    auto it = subscribers_.find(fd);
+    if (it == subscribers_.end())
+        return;
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    subscribers_.erase(it);
+    subscriberCount_.store(subscribers_.size(), std::memory_order_relaxed);
+}
+
+void MarketDataPublisher::flushDirty()
+{
+    for (int fd : dirty_)
+    {
+        auto it = subscribers_.find(fd);
+        if (it == subscribers_.end())
+            continue;
+        it->second->dirty = false;
+        flushSubscriber(fd, *it->second);
+    }
+    dirty_.clear();
+    for (int fd : closing_)
+        closeSubscriber(fd);
+    closing_.clear();
+}
+
+void MarketDataPublisher::onTimers()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now >= nextSnapshot_)
+    {
+        nextSnapshot_ = now + std::chrono::milliseconds(options_.snapshot_interval_ms);
+        flushIncremental();
+        Emit toAll = [this](const uint8_t *data, size_t len)
+        { broadcast(MdChannel::SNAPSHOT, data, len); };
+        writeSnapshot(toAll);
+    }
+    if (now >= nextTob_)
+    {
+        nextTob_ = now + std::chrono::milliseconds(options_.tob_interval_ms);
+        Emit toAll = [this](const uint8_t *data, size_t len)
+        { broadcast(MdChannel::TOP_OF_BOOK, data, len); };
+        writeTopOfBook(toAll, true);
+    }
+}
+
+void MarketDataPublisher::waitForWork()
+{
+    notifier_.waitWith([this]
+                       { return hasPending() || !running_.load(); },
+                       [this]
+                       {
+        auto deadline = std::min(nextSnapshot_, nextTob_);
+        auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        struct epoll_event events[64];
+        int n = epoll_wait(epollFd_, events, 64, static_cast<int>(std::max<int64_t>(timeout, 0)));
+        for (int i = 0; i < n; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == notifier_.fd())
+            {
+                notifier_.consume();
+                continue;
+            }
+            if (fd == listenFd_)
+            {
+                acceptSubscribers();
+                continue;
+            }
+            auto it = subscribers_.find(fd);
+            if (it == subscribers_.end())
+                continue;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                readSubscriber(fd, *it->second);
+            if (events[i].events & EPOLLOUT)
+                flushSubscriber(fd, *it->second);
+        } });
+}
+
+void MarketDataPublisher::run()
+{
+    spdlog::info("Market data publisher started");
+    while (running_.load(std::memory_order_relaxed))
+    {
+        size_t n = 0;
+        for (auto &channel : channels_)
+        {
+            n += channel->drain([this](const MarketDataEvent &event)
+                                { apply(event); },
+                                DRAIN_LIMIT);
+        }
+        // 每轮唤醒发出一次不满的包：批量到来时自然合并，空闲时不额外等待
+        flushIncremental();
+        onTimers();
+        flushDirty();
+        if (n > 0)
+            continue;
+
+        waitForWork();
+        flushDirty();
+    }
+    spdlog::info("Market data publisher stopped");
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <netinet/in.h>
+#include "EngineConfig.h"
+#include "MarketData.h"
+#include "network/OutputBuffer.h"
+#include "protocol/MarketDataMessages.h"
+#include "utils/WaitNotifier.h"
+
+struct MarketDataOptions
+{
+    int tcp_port = 0;                  // TCP 订阅端口，0 关闭
+    std::string multicast;             // 增量与快照的 UDP 目的地 ADDR:PORT（组播或单播），空串关闭
+    std::string tob_multicast;         // 合并最优价的 UDP 目的地，空串关闭
+    std::string interface_addr;        // 组播出口地址，空串由内核选择
+    uint32_t snapshot_interval_ms = 1000;
+    uint32_t tob_interval_ms = 100;
+    uint32_t output_buffer_size = 1u << 20; // 每个 TCP 订阅者的发送缓冲区
+};
+
+// 行情发布阶段：独立线程消费各撮合分片的订单簿变化事件，维护每个品种的 L2 镜像，
+// 编号后按包发出增量，并定期发出全量快照与合并后的最优价。
+// 撮合线程每次价位变化只入队一次、每批唤醒一次，订阅者数量和订阅方式都不影响撮合。
+//
+// TCP 订阅者的发送缓冲区写满即断开：行情不能为慢消费者停下，订阅者重连后从快照恢复。
+class MarketDataPublisher
+{
+public:
+    MarketDataPublisher(const std::vector<SymbolConfig> &symbols, size_t channelCount,
+                        uint32_t queueCapacity, const MarketDataOptions &options);
+    ~MarketDataPublisher();
+
+    // 创建监听与 UDP socket 并启动线程，失败返回 false
+    bool start();
+    void stop();
+
+    MarketDataChannel *channel(size_t index) { return channels_[index].get(); }
+
+    uint64_t lastSeq() const { return published_.load(std::memory_order_relaxed); }
+    uint64_t subscribers() const { return subscriberCount_.load(std::memory_order_relaxed); }
+    uint64_t droppedPackets() const { return droppedPackets_.load(std::memory_order_relaxed); }
+
+private:
+    struct Level
+    {
+        int64_t quantity;
+        uint32_t count;
+    };
+
+    struct BookMirror
+    {
+        InstrumentSpec spec;
+        std::map<Ticks, Level, std::greater<Ticks>> bids; // 最优价在前
+        std::map<Ticks, Level> asks;
+        MdMessage sentBid{}; // 最近一次发出的最优价，用于合并
+        MdMessage sentAsk{};
+    };
+
+    struct Subscriber
+    {
+        explicit Subscriber(size_t capacity) : out(capacity) {}
+        MdSubscription mode = MdSubscription::INCREMENTAL;
+        bool subscribed = false;
+        bool dirty = false;
+        bool writeInterest = false;
+        OutputBuffer out;
+    };
+
+    using Emit = std::function<void(const uint8_t *, size_t)>;
+
+    void run();
+    void apply(const MarketDataEvent &event);
+    template <typename Side>
+    bool applyLevel(Side &side, const MarketDataEvent &event, MdMessage &msg);
+    void addIncremental(const MdMessage &msg);
+    void flushIncremental();
+    void writeSnapshot(const Emit &emit);
+    void writeTopOfBook(const Emit &emit, bool changedOnly);
+    void broadcast(MdChannel channel, const uint8_t *data, size_t len);
+    void sendTo(int fd, Subscriber &sub, const uint8_t *data, size_t len);
+    void acceptSubscribers();
+    void readSubscriber(int fd, Subscriber &sub);
+    void flushSubscriber(int fd, Subscriber &sub);
+    void closeSubscriber(int fd);
+    void flushDirty();
+    void onTimers();
+    void waitForWork();
+    bool hasPending() const;
+
+    MarketDataOptions options_;
+    std::vector<std::unique_ptr<MarketDataChannel>> channels_;
+    WaitNotifier notifier_;
+    std::unordered_map<uint32_t, BookMirror> books_;
+    std::vector<uint32_t> symbolOrder_; // 快照按品种号顺序输出
+
+    int epollFd_ = -1;
+    int listenFd_ = -1;
+    int udpFd_ = -1;
+    int tobUdpFd_ = -1;
+    sockaddr_in udpAddr_{};
+    sockaddr_in tobUdpAddr_{};
+    std::unordered_map<int, std::unique_ptr<Subscriber>> subscribers_;
+    std::vector<int> dirty_;
+    std::vector<int> closing_;
+
+    // 正在拼装的增量包
+    uint8_t incPacket_[MD_MAX_PACKET];
+    uint16_t incCount_ = 0;
+    uint64_t nextSeq_ = 1;
+
+    std::chrono::steady_clock::time_point nextSnapshot_;
+    std::chrono::steady_clock::time_point nextTob_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> subscriberCount_{0};
+    std::atomic<uint64_t> droppedPackets_{0};
+};
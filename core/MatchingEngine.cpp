@@ -1,12 +1,282 @@
 // core/MatchingEngine.cpp
 #include "MatchingEngine.h"
 #include "protocol/MessageCodec.h"
-#include "protocol/MessageType.h"
+#include "protocol/WireMessages.h"
 #include "utils/Logger.h"
+#include "utils/EventLog.h"
+#include "utils/LatencyTrace.h"
 #include <spdlog/spdlog.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
 
-void MatchingEngine::onMessage(Connection *conn, MessageType type, const std::vector<uint8_t> &payload)
+MatchingEngine::MatchingEngine(const EngineConfig &config)
+    : reportLanes_(std::max<uint32_t>(1, config.risk_threads)), threaded_(config.shards > 0),
+      reportPolling_(config.idle != IdleStrategy::BLOCK)
 {
+    connOptions_.recv_buffer_size = config.recv_buffer_size;
+    connOptions_.output_buffer_size = config.output_buffer_size;
+    connOptions_.max_batch = config.max_batch;
+    connOptions_.busy_poll_us = config.busy_poll_us;
+    connOptions_.slow_consumer = config.throttle_slow_consumers ? SlowConsumerPolicy::THROTTLE
+                                                                : SlowConsumerPolicy::DISCONNECT;
+    uint32_t shardCount = threaded_ ? config.shards : 1;
+    for (uint32_t i = 0; i < shardCount; ++i)
+    {
+        shards_.push_back(std::make_unique<MatchingShard>(i, config.order_pool_size, config.queue_capacity,
+                                                          config.max_batch, config.io_threads, config.risk_threads));
+    }
+    for (uint32_t i = 0; i < config.io_threads; ++i)
+    {
+        io_.push_back(std::make_unique<IoContext>());
+        io_.back()->shardInBatch.assign(shardCount, 0);
+        io_.back()->riskInBatch.assign(config.risk_threads, 0);
+        io_.back()->riskSent.assign(config.risk_threads, 0);
+        io_.back()->staged.assign(shardCount * reportLanes_, ReportBatch(config.output_buffer_size));
+        io_.back()->lastInBatch.assign(shardCount * reportLanes_, -1);
+    }
+    for (const auto &symbol : config.symbols)
+    {
+        MatchingShard *shard = shards_[symbol.symbol_id % shardCount].get();
+        shard->addSymbol(symbol.symbol_id, symbol.spec);
+        symbolShards_[symbol.symbol_id] = shard;
+    }
+
+    // 行情发布线程先于日志恢复启动：恢复出的订单簿同样经由增量进入行情镜像
+    if (config.md_port > 0 || !config.md_multicast.empty() || !config.md_tob_multicast.empty())
+    {
+        MarketDataOptions options;
+        options.tcp_port = config.md_port;
+        options.multicast = config.md_multicast;
+        options.tob_multicast = config.md_tob_multicast;
+        options.interface_addr = config.md_interface;
+        options.snapshot_interval_ms = config.md_snapshot_interval_ms;
+        options.tob_interval_ms = config.md_tob_interval_ms;
+        options.output_buffer_size = config.output_buffer_size;
+        marketData_ = std::make_unique<MarketDataPublisher>(config.symbols, shards_.size(),
+                                                            config.queue_capacity, options);
+        if (!marketData_->start())
+        {
+            spdlog::critical("Cannot start market data publisher");
+            exit(1);
+        }
+        for (size_t i = 0; i < shards_.size(); ++i)
+            shards_[i]->setMarketData(marketData_->channel(i));
+    }
+
+    if (!config.journal_dir.empty())
+    {
+        for (auto &shard : shards_)
+        {
+            JournalOptions options;
+            options.dir = config.journal_dir;
+            options.shard = shard->index();
+            options.shard_count = shardCount;
+            options.segment_size = config.journal_segment_size;
+            options.sync = config.journal_sync;
+            if (!shard->openJournal(options, config.snapshot_interval_sec))
+            {
+                spdlog::critical("Cannot recover from journal / snapshot in {} for shard {}",
+                                 config.journal_dir, shard->index());
+                exit(1);
+            }
+            shard->forEachRestingOrder([this](const OrderNode &node, const InstrumentSpec &)
+                                       {
+                if (node.owner != 0)
+                    firstConnSeq_ = std::max(firstConnSeq_, connectionSeq(node.owner) + 1); });
+        }
+    }
+
+    if (threaded_)
+    {
+        if (config.egress_thread)
+        {
+            std::vector<MatchingShard *> shards;
+            for (auto &shard : shards_)
+                shards.push_back(shard.get());
+            egress_ = std::make_unique<ReportEgress>(std::move(shards), config.queue_capacity, connOptions_,
+                                                     reportLanes_);
+            egress_->start();
+        }
+        else
+        {
+            for (auto &io : io_)
+                io->reportFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        }
+        // 风控线程先于撮合线程启动，撮合线程停止之后才停止（见析构函数）
+        if (config.risk_threads > 0)
+            startRisk(config);
+        for (size_t i = 0; i < shards_.size(); ++i)
+        {
+            ThreadOptions threadOptions{config.idle, config.idle_spin_us, -1, config.rt_priority};
+            if (!config.shard_cpus.empty())
+                threadOptions.cpu = config.shard_cpus[i];
+            shards_[i]->start([this](uint32_t ioThread)
+                              { notifyReports(ioThread); },
+                              threadOptions);
+        }
+    }
+    if (config.stats_interval_sec > 0)
+    {
+        statsRunning_.store(true);
+        statsThread_ = std::thread(&MatchingEngine::runStats, this, config.stats_interval_sec);
+    }
+    spdlog::info("Engine: {} symbols on {} shard(s), {} I/O thread(s), {} risk thread(s), {} mode",
+                 config.symbols.size(), shardCount, io_.size(), risk_.size(),
+                 egress_ ? "pipelined" : (threaded_ ? "threaded" : "inline"));
+}
+
+void MatchingEngine::startRisk(const EngineConfig &config)
+{
+    prices_ = std::make_unique<ReferencePrices>(config.symbols);
+    std::vector<MatchingShard *> shards;
+    for (auto &shard : shards_)
+        shards.push_back(shard.get());
+    for (uint32_t i = 0; i < config.risk_threads; ++i)
+    {
+        risk_.push_back(std::make_unique<RiskShard>(i, config.risk, shards, symbolShards_, *prices_,
+                                                    config.queue_capacity, config.max_batch, config.io_threads));
+    }
+
+    std::vector<RiskShard *> workers;
+    for (auto &worker : risk_)
+        workers.push_back(worker.get());
+    for (auto &shard : shards_)
+    {
+        riskFeeds_.push_back(std::make_unique<RiskFeed>(shard->index(), workers, *prices_));
+        shard->setRiskFeed(riskFeeds_.back().get());
+        // 从快照 / 日志恢复出的挂单计入所属用户的未结额度
+        shard->forEachRestingOrder([this](const OrderNode &node, const InstrumentSpec &spec)
+                                   {
+            auto lane = riskLane(node.user_id, static_cast<uint32_t>(risk_.size()));
+            risk_[lane]->restore(node.user_id, spec.toPrice(node.ticks) * node.remaining_quantity); });
+    }
+
+    for (uint32_t i = 0; i < config.risk_threads; ++i)
+    {
+        ThreadOptions threadOptions{config.idle, config.idle_spin_us, -1, config.rt_priority};
+        if (!config.risk_cpus.empty())
+            threadOptions.cpu = config.risk_cpus[i];
+        risk_[i]->start(threadOptions);
+    }
+}
+
+MatchingEngine::~MatchingEngine()
+{
+    if (statsRunning_.exchange(false) && statsThread_.joinable())
+    {
+        statsThread_.join();
+    }
+    for (auto &shard : shards_)
+    {
+        shard->stop();
+    }
+    for (auto &worker : risk_)
+    {
+        worker->stop();
+    }
+    if (egress_)
+    {
+        egress_->stop();
+    }
+    if (marketData_)
+    {
+        marketData_->stop();
+    }
+    for (auto &io : io_)
+    {
+        if (io->reportFd != -1)
+            close(io->reportFd);
+    }
+}
+
+void MatchingEngine::logStats() const
+{
+    spdlog::info("Ingress: decoded={}", ingress_.load(std::memory_order_relaxed));
+    for (const auto &shard : shards_)
+    {
+        auto pool = shard->poolStats();
+        spdlog::info("Shard {}: processed={} in_depth={} out_depth={} pool capacity={} in_use={} high_water={} alloc_failures={}",
+                     shard->index(), shard->processed(), shard->inboundDepth(), shard->outboundDepth(),
+                     pool.capacity, pool.in_use, pool.high_water, pool.alloc_failures);
+    }
+    for (const auto &worker : risk_)
+    {
+        spdlog::info("Risk {}: checked={} rejected={} in_depth={}",
+                     worker->index(), worker->checked(), worker->rejected(), worker->inboundDepth());
+    }
+    if (egress_)
+    {
+        spdlog::info("Egress: sent={} dropped={} control_depth={}",
+                     egress_->sent(), egress_->dropped(), egress_->controlDepth());
+    }
+    if (marketData_)
+    {
+        spdlog::info("Market data: seq={} subscribers={} dropped_packets={}",
+                     marketData_->lastSeq(), marketData_->subscribers(), marketData_->droppedPackets());
+    }
+}
+
+void MatchingEngine::runStats(uint32_t intervalSec)
+{
+    using namespace std::chrono;
+    uint64_t lastIngress = 0;
+    uint64_t lastEgress = 0;
+    std::vector<uint64_t> lastProcessed(shards_.size(), 0);
+    std::vector<uint64_t> lastChecked(risk_.size(), 0);
+    auto next = steady_clock::now() + seconds(intervalSec);
+
+    while (statsRunning_.load())
+    {
+        std::this_thread::sleep_for(milliseconds(100));
+        if (steady_clock::now() < next)
+            continue;
+        next += seconds(intervalSec);
+
+        uint64_t ingress = ingress_.load(std::memory_order_relaxed);
+        spdlog::info("Pipeline: ingress {}/s", (ingress - lastIngress) / intervalSec);
+        lastIngress = ingress;
+        for (size_t i = 0; i < risk_.size(); ++i)
+        {
+            uint64_t checked = risk_[i]->checked();
+            spdlog::info("Pipeline: risk {} check {}/s in_depth={} rejected={}",
+                         i, (checked - lastChecked[i]) / intervalSec, risk_[i]->inboundDepth(), risk_[i]->rejected());
+            lastChecked[i] = checked;
+        }
+        for (size_t i = 0; i < shards_.size(); ++i)
+        {
+            uint64_t processed = shards_[i]->processed();
+            spdlog::info("Pipeline: shard {} match {}/s in_depth={} out_depth={}",
+                         i, (processed - lastProcessed[i]) / intervalSec,
+                         shards_[i]->inboundDepth(), shards_[i]->outboundDepth());
+            lastProcessed[i] = processed;
+        }
+        if (egress_)
+        {
+            uint64_t sent = egress_->sent();
+            spdlog::info("Pipeline: egress {}/s control_depth={} dropped={}",
+                         (sent - lastEgress) / intervalSec, egress_->controlDepth(), egress_->dropped());
+            lastEgress = sent;
+        }
+    }
+}
+
+void MatchingEngine::onConnectionOpened(uint64_t connId)
+{
+    if (egress_)
+        egress_->connectionOpened(connId);
+}
+
+void MatchingEngine::onConnectionClosed(uint64_t connId)
+{
+    if (egress_)
+        egress_->connectionClosed(connId);
+}
+
+void MatchingEngine::onMessage(Connection *conn, MessageType type, PayloadView payload)
+{
+    ingress_.fetch_add(1, std::memory_order_relaxed);
     switch (type)
     {
     case MessageType::NEW_ORDER:
@@ -15,71 +285,427 @@ void MatchingEngine::onMessage(Connection *conn, MessageType type, const std::ve
     case MessageType::CANCEL_ORDER:
         handleCancelOrder(conn, payload);
         break;
+    case MessageType::REPLACE_ORDER:
+        handleReplaceOrder(conn, payload);
+        break;
+    case MessageType::NEW_ORDER_BATCH:
+        handleNewOrderBatch(conn, payload);
+        break;
+    case MessageType::MASS_CANCEL:
+        handleMassCancel(conn, payload);
+        break;
     case MessageType::HEARTBEAT:
         spdlog::debug("Heartbeat from fd={}", conn->fd());
         break;
     default:
-        spdlog::warn("Unknown message type: {}", static_cast<int>(type));
+        EventLog::write(EventType::MESSAGE_INVALID, static_cast<uint8_t>(RejectReason::UNKNOWN_MESSAGE_TYPE), 0,
+                        conn->id(), 0.0, 0, static_cast<int32_t>(type), nullptr);
     }
 }
 
-void MatchingEngine::handleNewOrder(Connection *conn, const std::vector<uint8_t> &payload)
+void MatchingEngine::handleNewOrder(Connection *conn, PayloadView payload)
 {
-    auto order = Order::deserialize(payload);
+    LATENCY_TRACE_STAMP(deserializeStart);
+    auto order = Order::deserialize(payload.data, payload.size);
+    LATENCY_TRACE_RECORD(DESERIALIZE, deserializeStart);
     if (!order)
     {
-        spdlog::error("Invalid new order from fd={}", conn->fd());
+        EventLog::write(EventType::MESSAGE_INVALID, static_cast<uint8_t>(RejectReason::MALFORMED), 0,
+                        conn->id(), 0.0, 0, static_cast<int32_t>(payload.size), nullptr);
+        return;
+    }
+
+    EventLog::write(EventType::ORDER_RECEIVED, static_cast<uint8_t>(order->side), order->symbol_id, conn->id(),
+                    order->price, order->quantity, static_cast<int32_t>(order->type), order->order_id.data);
+
+    EngineCommand cmd{};
+    cmd.type = CommandType::NEW_ORDER;
+    cmd.symbol_id = order->symbol_id;
+    cmd.order = *order;
+    LATENCY_TRACE_ONLY(cmd.trace_ingress = LatencyTrace::ingress());
+    dispatch(conn, cmd);
+}
+
+void MatchingEngine::handleCancelOrder(Connection *conn, PayloadView payload)
+{
+    // 旧格式只有 order_id，视为品种 0
+    const auto *msg = reinterpret_cast<const wire::CancelOrder *>(payload.data);
+    if (payload.size < offsetof(wire::CancelOrder, symbol_id))
+    {
+        EventLog::write(EventType::MESSAGE_INVALID, static_cast<uint8_t>(RejectReason::MALFORMED), 0,
+                        conn->id(), 0.0, 0, static_cast<int32_t>(payload.size), nullptr);
+        return;
+    }
+
+    EngineCommand cmd{};
+    cmd.type = CommandType::CANCEL_ORDER;
+    cmd.cancel_id = OrderId::fromBytes(msg->order_id);
+    if (payload.size >= sizeof(wire::CancelOrder))
+    {
+        cmd.symbol_id = msg->symbol_id;
+    }
+    EventLog::write(EventType::CANCEL_RECEIVED, 0, cmd.symbol_id, conn->id(), 0.0, 0, 0, cmd.cancel_id.data);
+    LATENCY_TRACE_ONLY(cmd.trace_ingress = LatencyTrace::ingress());
+    dispatch(conn, cmd);
+}
+
+void MatchingEngine::handleReplaceOrder(Connection *conn, PayloadView payload)
+{
+    // quantity 为改后的剩余数量；旧格式不带 user_id
+    const auto *msg = reinterpret_cast<const wire::ReplaceOrder *>(payload.data);
+    if (payload.size != sizeof(wire::ReplaceOrder) && payload.size != offsetof(wire::ReplaceOrder, user_id))
+    {
+        EventLog::write(EventType::MESSAGE_INVALID, static_cast<uint8_t>(RejectReason::MALFORMED), 0,
+                        conn->id(), 0.0, 0, static_cast<int32_t>(payload.size), nullptr);
         return;
     }
 
-    auto callback = [this, conn](const ExecutionReport &rpt)
+    EngineCommand cmd{};
+    cmd.type = CommandType::REPLACE_ORDER;
+    cmd.cancel_id = OrderId::fromBytes(msg->order_id);
+    cmd.symbol_id = msg->symbol_id;
+    cmd.order.price = msg->price;
+    cmd.order.quantity = msg->quantity;
+    if (payload.size == sizeof(wire::ReplaceOrder))
     {
-        this->sendExecutionReport(conn, rpt);
-    };
+        cmd.order.user_id = UserId::fromBytes(msg->user_id);
+    }
+    EventLog::write(EventType::REPLACE_RECEIVED, 0, cmd.symbol_id, conn->id(), cmd.order.price, cmd.order.quantity,
+                    0, cmd.cancel_id.data);
+    LATENCY_TRACE_ONLY(cmd.trace_ingress = LatencyTrace::ingress());
+    dispatch(conn, cmd);
+}
+
+void MatchingEngine::handleNewOrderBatch(Connection *conn, PayloadView payload)
+{
+    // count + count 笔订单。先整帧解码校验，任何一笔非法则整批丢弃，不会出现半批已执行的情况
+    const auto *batch = reinterpret_cast<const wire::NewOrderBatch *>(payload.data);
+    if (payload.size < sizeof(wire::NewOrderBatch) || batch->count == 0 ||
+        payload.size != wire::NewOrderBatch::sizeFor(batch->count))
+    {
+        EventLog::write(EventType::MESSAGE_INVALID, static_cast<uint8_t>(RejectReason::MALFORMED), 0,
+                        conn->id(), 0.0, 0, static_cast<int32_t>(payload.size), nullptr);
+        return;
+    }
+
+    IoContext &io = *io_[connectionReactor(conn->id())];
+    io.batchCommands.clear();
+    std::fill(io.lastInBatch.begin(), io.lastInBatch.end(), -1);
+    LATENCY_TRACE_STAMP(deserializeStart);
+    const wire::NewOrder *orders = batch->orders();
+    for (uint16_t i = 0; i < batch->count; ++i)
+    {
+        auto order = Order::deserialize(reinterpret_cast<const uint8_t *>(orders + i), sizeof(wire::NewOrder));
+        if (!order)
+        {
+            EventLog::write(EventType::MESSAGE_INVALID, static_cast<uint8_t>(RejectReason::MALFORMED), 0,
+                            conn->id(), 0.0, 0, static_cast<int32_t>(payload.size), nullptr);
+            return;
+        }
+        EngineCommand cmd{};
+        cmd.type = CommandType::NEW_ORDER;
+        cmd.flags = COMMAND_BATCHED;
+        cmd.symbol_id = order->symbol_id;
+        cmd.order = *order;
+        io.lastInBatch[shardFor(cmd.symbol_id)->index() * reportLanes_ + laneFor(conn, cmd)] = i;
+        io.batchCommands.push_back(cmd);
+    }
+    LATENCY_TRACE_RECORD(DESERIALIZE, deserializeStart);
+    // 每个涉及的分片在其最后一条指令之后发出一帧批量回报；启用风控时按经由的风控线程各发一帧
+    for (int32_t last : io.lastInBatch)
+    {
+        if (last >= 0)
+            io.batchCommands[last].flags |= COMMAND_BATCH_END;
+    }
+
+    for (EngineCommand &cmd : io.batchCommands)
+    {
+        const Order &order = cmd.order;
+        EventLog::write(EventType::ORDER_RECEIVED, static_cast<uint8_t>(order.side), order.symbol_id, conn->id(),
+                        order.price, order.quantity, static_cast<int32_t>(order.type), order.order_id.data);
+        LATENCY_TRACE_ONLY(cmd.trace_ingress = LatencyTrace::ingress());
+        dispatch(conn, cmd);
+    }
+}
+
+void MatchingEngine::handleMassCancel(Connection *conn, PayloadView payload)
+{
+    // SESSION 范围撤销本连接的挂单，忽略 user_id
+    const auto *msg = payload.as<wire::MassCancel>();
+    if (!msg || msg->scope > static_cast<uint8_t>(MassCancelScope::USER) || msg->side > MassCancelFilter::BOTH_SIDES)
+    {
+        EventLog::write(EventType::MESSAGE_INVALID, static_cast<uint8_t>(RejectReason::MALFORMED), 0,
+                        conn->id(), 0.0, 0, static_cast<int32_t>(payload.size), nullptr);
+        return;
+    }
+
+    EngineCommand cmd{};
+    cmd.type = CommandType::MASS_CANCEL;
+    cmd.flags = COMMAND_BATCHED | COMMAND_BATCH_END;
+    cmd.mass_scope = msg->scope;
+    cmd.mass_side = msg->side;
+    cmd.order.user_id = UserId::fromBytes(msg->user_id);
+    OrderId user = OrderId::fromString(cmd.order.user_id.view()); // 事件记录的 id 字段为 32 字节
+    EventLog::write(EventType::MASS_CANCEL_RECEIVED, cmd.mass_scope, 0, conn->id(), 0.0, 0, cmd.mass_side,
+                    user.data);
+    LATENCY_TRACE_ONLY(cmd.trace_ingress = LatencyTrace::ingress());
+    // 订单可能分布在任意品种上：每个分片各执行一次，各回一帧批量回报（没有撤到订单时为空帧）。
+    // 启用风控时只投给一个风控线程，由它转发给每个分片
+    if (!risk_.empty())
+    {
+        dispatch(conn, cmd);
+        return;
+    }
+    for (auto &shard : shards_)
+        dispatchTo(conn, shard.get(), cmd);
+}
+
+MatchingShard *MatchingEngine::shardFor(uint32_t symbolId) const
+{
+    // 未知品种也交给分片处理（分片负责拒绝），保证回报只从回报通道发出
+    auto it = symbolShards_.find(symbolId);
+    return it != symbolShards_.end() ? it->second : shards_[symbolId % shards_.size()].get();
+}
+
+uint32_t MatchingEngine::laneFor(Connection *conn, const EngineCommand &cmd) const
+{
+    if (risk_.empty())
+        return 0;
+    auto lanes = static_cast<uint32_t>(risk_.size());
+    // 新单、带 user_id 的改单与按用户的批量撤单按 user_id 分给风控线程；撤单与旧格式的改单
+    // 不带 user_id，沿用本连接上一条指令的风控线程
+    if (cmd.type == CommandType::NEW_ORDER ||
+        (cmd.type == CommandType::REPLACE_ORDER && !cmd.order.user_id.empty()) ||
+        (cmd.type == CommandType::MASS_CANCEL && cmd.mass_scope == static_cast<uint8_t>(MassCancelScope::USER)))
+        return riskLane(cmd.order.user_id, lanes);
+    return conn->route();
+}
+
+void MatchingEngine::dispatch(Connection *conn, const EngineCommand &cmd)
+{
+    if (risk_.empty())
+    {
+        dispatchTo(conn, shardFor(cmd.symbol_id), cmd);
+        return;
+    }
+    uint32_t lane = laneFor(conn, cmd);
+    uint32_t ioThread = connectionReactor(conn->id());
+    if (lane != conn->route() && conn->routeMark() != 0)
+        fenceRisk(ioThread, conn->route(), conn->routeMark());
+    dispatchToRisk(conn, lane, cmd);
+    conn->setRoute(lane, io_[ioThread]->riskSent[lane]);
+}
+
+void MatchingEngine::fenceRisk(uint32_t ioThread, uint32_t lane, uint64_t mark)
+{
+    // 一个会话只交易一个用户时不会走到这里。先等风控线程转发完该会话的最后一条指令，
+    // 再等各分片执行完此时该风控线程已转发的全部指令
+    RiskShard &worker = *risk_[lane];
+    while (worker.taken(ioThread) < mark)
+    {
+        worker.publish();
+        yieldToReports(ioThread);
+    }
+    for (auto &shard : shards_)
+    {
+        uint64_t forwarded = worker.forwarded(shard->index());
+        while (shard->executed(lane) < forwarded)
+        {
+            shard->publish();
+            yieldToReports(ioThread);
+        }
+    }
+}
 
-    spdlog::info(
-        "Received order: user={} order_id={} side={} price={} qty={}",
-        order->user_id,
-        order->order_id,
-        (order->side == OrderSide::BUY ? "BUY" : "SELL"),
-        order->price,
-        order->quantity);
+void MatchingEngine::yieldToReports(uint32_t ioThread)
+{
+    if (egress_)
+    {
+        egress_->notify();
+        std::this_thread::yield();
+    }
+    else
+    {
+        drainReports(ioThread);
+    }
+}
 
-    orderBook_.matchOrder(*order, callback);
+void MatchingEngine::dispatchToRisk(Connection *conn, uint32_t lane, const EngineCommand &cmd)
+{
+    uint32_t ioThread = connectionReactor(conn->id());
+    IoContext &io = *io_[ioThread];
+    RiskShard *worker = risk_[lane].get();
+    if (!io.riskInBatch[lane])
+    {
+        io.riskInBatch[lane] = 1;
+        io.batchRisk.push_back(worker);
+    }
+
+    EngineCommand routed = cmd;
+    routed.conn_id = conn->id();
+    LATENCY_TRACE_ONLY(routed.trace_enqueue = LatencyTrace::now());
+    // 与 dispatchTo 相同：队列满时先唤醒风控线程并让回报流出去
+    while (!worker->enqueue(ioThread, routed))
+    {
+        worker->publish();
+        yieldToReports(ioThread);
+    }
+    ++io.riskSent[lane];
 }
 
-void MatchingEngine::handleCancelOrder(Connection *conn, const std::vector<uint8_t> &payload)
+void MatchingEngine::dispatchTo(Connection *conn, MatchingShard *shard, const EngineCommand &cmd)
 {
-    if (payload.size() < 32)
+    // 本轮结束时 onBatchEnd 统一处理：线程模式唤醒分片，内联模式组提交日志
+    uint32_t ioThread = connectionReactor(conn->id());
+    IoContext &io = *io_[ioThread];
+    if (!io.shardInBatch[shard->index()])
     {
-        spdlog::error("Cancel order: payload too short");
+        io.shardInBatch[shard->index()] = 1;
+        io.batchShards.push_back(shard);
+    }
+
+    EngineCommand routed = cmd;
+    routed.conn_id = conn->id();
+    if (!threaded_)
+    {
+        // 回报只是追加到发送缓冲区，TcpServer 在 onBatchEnd 之后才写 socket
+        if (routed.flags & COMMAND_BATCHED)
+        {
+            ReportBatch &staged = io.staged[shard->index() * reportLanes_];
+            auto callback = [this, conn, &staged](const ExecutionReport &rpt)
+            {
+                this->stageReport(conn, staged, rpt);
+            };
+            shard->process(routed, callback);
+            if (routed.flags & COMMAND_BATCH_END)
+                sendReportBatch(conn, staged);
+            return;
+        }
+        auto callback = [this, conn](const ExecutionReport &rpt)
+        {
+            this->sendExecutionReport(conn, rpt);
+        };
+        shard->process(routed, callback);
         return;
     }
 
-    std::string order_id(reinterpret_cast<const char *>(payload.data()), 32);
-    order_id.resize(order_id.find('\0'));
+    LATENCY_TRACE_ONLY(routed.trace_enqueue = LatencyTrace::now());
+    // 输入队列满：先唤醒分片并让回报流出去，避免与阻塞在输出队列上的分片互相等待
+    while (!shard->enqueue(ioThread, routed))
+    {
+        shard->publish();
+        yieldToReports(ioThread);
+    }
+}
 
-    auto callback = [this, conn](const ExecutionReport &rpt)
+void MatchingEngine::onBatchEnd(uint32_t ioThread)
+{
+    IoContext &io = *io_[ioThread];
+    for (MatchingShard *shard : io.batchShards)
+    {
+        if (threaded_)
+            shard->publish();
+        else if (!shard->commit())
+        {
+            // 内联模式下本批已执行，回报还在发送缓冲区里：在发出之前终止，重启后按日志恢复到上次提交
+            spdlog::critical("Shard {}: journal commit failed, exiting before the batch's reports are sent",
+                             shard->index());
+            exit(1);
+        }
+        io.shardInBatch[shard->index()] = 0;
+    }
+    io.batchShards.clear();
+    for (RiskShard *worker : io.batchRisk)
     {
-        this->sendExecutionReport(conn, rpt);
-    };
+        worker->publish();
+        io.riskInBatch[worker->index()] = 0;
+    }
+    io.batchRisk.clear();
+}
 
-    orderBook_.cancelOrder(order_id, callback);
+void MatchingEngine::notifyReports(uint32_t ioThread)
+{
+    if (egress_)
+    {
+        egress_->notify();
+        return;
+    }
+    // 合并唤醒：I/O 线程处理之前只写一次 eventfd
+    IoContext &io = *io_[ioThread];
+    if (!io.reportsPending.exchange(true, std::memory_order_acq_rel) && !reportPolling_)
+    {
+        uint64_t one = 1;
+        ssize_t n = write(io.reportFd, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+void MatchingEngine::drainReports(uint32_t ioThread)
+{
+    IoContext &io = *io_[ioThread];
+    if (!reportPolling_)
+    {
+        uint64_t value;
+        ssize_t n = read(io.reportFd, &value, sizeof(value));
+        (void)n;
+    }
+    io.reportsPending.exchange(false, std::memory_order_acq_rel);
+
+    for (auto &shard : shards_)
+    {
+        // 同一批量指令的回报以 BATCH_END 标记结束；不同风控线程转来的指令交错执行，按来源分开暂存
+        ReportBatch *staged = &io.staged[shard->index() * reportLanes_];
+        shard->drainReports(ioThread, [this, &io, staged](const OutboundReport &item)
+                            {
+            Connection *conn = io.lookup ? io.lookup(item.conn_id) : nullptr;
+            LATENCY_TRACE_ONLY(LatencyTrace::setIngress(item.trace_ingress));
+            if (item.flags & REPORT_BATCH_END)
+                sendReportBatch(conn, staged[item.lane]);
+            else if (item.flags & REPORT_BATCHED)
+                stageReport(conn, staged[item.lane], item.report);
+            else if (conn)
+                sendExecutionReport(conn, item.report); });
+    }
+}
+
+bool MatchingEngine::pollReports(uint32_t ioThread)
+{
+    if (!io_[ioThread]->reportsPending.load(std::memory_order_acquire))
+        return false;
+    drainReports(ioThread);
+    return true;
 }
 
 void MatchingEngine::sendExecutionReport(Connection *conn, const ExecutionReport &report)
 {
-    // 序列化 ExecutionReport（简化：只发 order_id + type + leaves_qty）
-    std::vector<uint8_t> payload;
-    payload.resize(32 + 1 + 4); // order_id(32) + type(1) + leaves(4)
+    // 帧在栈上编码后直接追加到连接的发送缓冲区，不分配内存
+    LATENCY_TRACE_STAMP(reportStart);
+    uint8_t frame[MessageCodec::HEADER_SIZE + ExecutionReport::WIRE_SIZE];
+    MessageCodec::encodeHeader(frame, MessageType::EXECUTION_REPORT, ExecutionReport::WIRE_SIZE);
+    report.serializeTo(frame + MessageCodec::HEADER_SIZE);
+    EventLog::write(EventType::REPORT_SENT, static_cast<uint8_t>(report.exec_type), 0, conn->id(),
+                    report.price, report.last_shares, report.leaves_qty, report.order_id.data);
+    if (!conn->sendFrame(frame, sizeof(frame)))
+        spdlog::error("Output buffer full on fd={}, dropping connection", conn->fd());
+    LATENCY_TRACE_RECORD(REPORT, reportStart);
+    LATENCY_TRACE_RECORD(INGRESS_TO_REPORT, LatencyTrace::ingress());
+}
 
-    std::string oid = report.order_id;
-    oid.resize(32, '\0');
-    std::memcpy(payload.data(), oid.data(), 32);
-    payload[32] = static_cast<uint8_t>(report.exec_type);
-    std::memcpy(payload.data() + 33, &report.leaves_qty, 4);
+void MatchingEngine::stageReport(Connection *conn, ReportBatch &batch, const ExecutionReport &report)
+{
+    if (!conn)
+        return;
+    if (batch.full())
+        sendReportBatch(conn, batch);
+    batch.add(report);
+    EventLog::write(EventType::REPORT_SENT, static_cast<uint8_t>(report.exec_type), 0, conn->id(),
+                    report.price, report.last_shares, report.leaves_qty, report.order_id.data);
+}
 
-    auto frame = MessageCodec::encode(MessageType::EXECUTION_REPORT, payload);
-    send(conn->fd(), frame.data(), frame.size(), 0);
-    spdlog::info("Sent {} bytes (frame)", frame.size());
+void MatchingEngine::sendReportBatch(Connection *conn, ReportBatch &batch)
+{
+    if (conn && !conn->sendFrame(batch.frame(), batch.frameSize()))
+        spdlog::error("Output buffer full on fd={}, dropping connection", conn->fd());
+    batch.clear();
+    LATENCY_TRACE_RECORD(INGRESS_TO_REPORT, LatencyTrace::ingress());
 }
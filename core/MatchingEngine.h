@@ -1,18 +1,116 @@
 #pragma once
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <unordered_map>
 #include <functional>
 #include "OrderBook.h"
+#include "EngineConfig.h"
+#include "EngineCommand.h"
+#include "MatchingShard.h"
+#include "ReportEgress.h"
+#include "RiskShard.h"
+#include "MarketDataPublisher.h"
 #include "network/Connection.h"
-#include "protocol/MessageType.h"
+#include "protocol/WireMessages.h"
+#include "protocol/ReportBatch.h"
 class MatchingEngine {
 public:
-    void onMessage(Connection* conn, MessageType type, const std::vector<uint8_t>& payload);
+    // 按连接 ID 查找连接（连接已关闭时返回 nullptr）
+    using ConnectionLookup = std::function<Connection *(uint64_t)>;
+
+    explicit MatchingEngine(const EngineConfig &config = EngineConfig{});
+    ~MatchingEngine();
+
+    void onMessage(Connection *conn, MessageType type, PayloadView payload);
+    void logStats() const;
+    const ConnectionOptions &connectionOptions() const { return connOptions_; }
+
+    // 多反应器：ioThreads() 个 I/O 线程各自调用 onMessage，连接 ID 中带有所属线程下标。
+    // 以下按 I/O 线程区分的接口都只能由该 I/O 线程调用
+    uint32_t ioThreads() const { return static_cast<uint32_t>(io_.size()); }
+    // 恢复出的挂单仍记着上一进程的下单连接（会话），连接 ID 重启后会复用：
+    // 各 I/O 线程的连接序号从这里开始，新会话按会话批量撤单不会撤到旧会话的挂单
+    uint64_t firstConnectionSeq() const { return firstConnSeq_; }
+
+    // 线程模式：分片产生回报后通过 reportFd(ioThread) 唤醒连接所在的 I/O 线程，
+    // 该线程调用 drainReports(ioThread) 把回报发回对应连接
+    void setConnectionLookup(uint32_t ioThread, ConnectionLookup lookup) { io_[ioThread]->lookup = std::move(lookup); }
+    int reportFd(uint32_t ioThread) const { return io_[ioThread]->reportFd; }
+    void drainReports(uint32_t ioThread);
+    // 空转模式（idle != block）：分片不写 eventfd，I/O 线程每轮调用 pollReports 检查并取回报，
+    // 有回报时返回 true
+    bool pollsReports() const { return reportPolling_; }
+    bool pollReports(uint32_t ioThread);
+    // I/O 线程每轮事件循环末尾、写出回报之前调用：唤醒本轮收到指令的撮合分片，
+    // 内联模式下组提交预写日志（每个分片至多一次）
+    void onBatchEnd(uint32_t ioThread);
+
+    // 流水线模式：回报由出口线程直接写 socket，需要知道连接的建立与断开，
+    // 断开连接的 fd 也交由出口线程关闭
+    bool hasEgressThread() const { return egress_ != nullptr; }
+    void onConnectionOpened(uint64_t connId);
+    void onConnectionClosed(uint64_t connId);
 
 private:
-    void handleNewOrder(Connection* conn, const std::vector<uint8_t>& payload);
-    void handleCancelOrder(Connection* conn, const std::vector<uint8_t>& payload);
-    void sendExecutionReport(Connection* conn, const ExecutionReport& report);
+    // 每个 I/O 线程的批次与回报唤醒状态：除 reportsPending 由撮合线程置位外只有该 I/O 线程访问
+    struct IoContext
+    {
+        std::vector<MatchingShard *> batchShards; // 本轮已入队但尚未唤醒的分片
+        std::vector<uint8_t> shardInBatch;        // 按分片下标标记是否已在 batchShards 中
+        std::vector<RiskShard *> batchRisk;       // 本轮已入队但尚未唤醒的风控线程
+        std::vector<uint8_t> riskInBatch;         // 按风控线程下标标记是否已在 batchRisk 中
+        std::vector<uint64_t> riskSent;           // 按风控线程下标：已投递的指令数
+        std::vector<ReportBatch> staged;          // 按 分片 × 回报来源：批量指令的回报暂存，批末整帧发出
+        std::vector<EngineCommand> batchCommands; // 批量下单：解码出的指令
+        std::vector<int32_t> lastInBatch;         // 批量下单：按 分片 × 回报来源 记录最后一条指令的位置
+        ConnectionLookup lookup;
+        int reportFd = -1;
+        std::atomic<bool> reportsPending{false};
+    };
+
+    void handleNewOrder(Connection *conn, PayloadView payload);
+    void handleCancelOrder(Connection *conn, PayloadView payload);
+    void handleReplaceOrder(Connection *conn, PayloadView payload);
+    void handleNewOrderBatch(Connection *conn, PayloadView payload);
+    void handleMassCancel(Connection *conn, PayloadView payload);
+    MatchingShard *shardFor(uint32_t symbolId) const;
+    // 启用风控时指令经由的风控线程（回报来源下标），未启用时为 0
+    uint32_t laneFor(Connection *conn, const EngineCommand &cmd) const;
+    void dispatch(Connection *conn, const EngineCommand &cmd);
+    void dispatchTo(Connection *conn, MatchingShard *shard, const EngineCommand &cmd);
+    void dispatchToRisk(Connection *conn, uint32_t lane, const EngineCommand &cmd);
+    // 会话换用另一个风控线程之前，等它经由原风控线程的指令全部在分片上执行完，
+    // 保证同一连接的指令按发送顺序执行
+    void fenceRisk(uint32_t ioThread, uint32_t lane, uint64_t mark);
+    // 等待下游时调用：让回报流出去，避免与阻塞在输出队列上的分片互相等待
+    void yieldToReports(uint32_t ioThread);
+    void startRisk(const EngineConfig &config);
+    void notifyReports(uint32_t ioThread);
+    void sendExecutionReport(Connection *conn, const ExecutionReport &report);
+    // 批量回报：conn 为空（连接已关闭）时只丢弃
+    void stageReport(Connection *conn, ReportBatch &batch, const ExecutionReport &report);
+    void sendReportBatch(Connection *conn, ReportBatch &batch);
+    void runStats(uint32_t intervalSec);
+
+    std::vector<std::unique_ptr<MatchingShard>> shards_;
+    std::unordered_map<uint32_t, MatchingShard *> symbolShards_; // symbol_id -> 所属分片
+    std::vector<std::unique_ptr<RiskShard>> risk_;               // 事前风控线程，未启用时为空
+    std::vector<std::unique_ptr<RiskFeed>> riskFeeds_;           // 按分片下标
+    std::unique_ptr<ReferencePrices> prices_;
+    // 每个分片的回报按来源分开暂存批量帧：未启用风控时只有 1 个来源，否则每个风控线程一个
+    uint32_t reportLanes_ = 1;
+    bool threaded_ = false;
+    bool reportPolling_ = false;
+    std::vector<std::unique_ptr<IoContext>> io_; // 按 I/O 线程下标
+    ConnectionOptions connOptions_;
+    uint64_t firstConnSeq_ = 1;
 
-    OrderBook orderBook_;
+    std::unique_ptr<ReportEgress> egress_;
+    std::unique_ptr<MarketDataPublisher> marketData_;
 
-};
\ No newline at end of file
+    // 流水线计数器：I/O 阶段解码的消息数（撮合与出口阶段的计数在各自对象中）
+    std::atomic<uint64_t> ingress_{0};
+    std::thread statsThread_;
+    std::atomic<bool> statsRunning_{false};
+};
@@ -0,0 +1,407 @@
+#include "MatchingShard.h"
+#include "utils/Logger.h"
+#include "utils/EventLog.h"
+#include "utils/LatencyTrace.h"
+#include "network/ConnectionId.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+constexpr size_t SNAPSHOT_BUFFER_SIZE = 1u << 20;
+}
+
+MatchingShard::MatchingShard(uint32_t index, uint32_t poolCapacity, uint32_t queueCapacity, uint32_t maxBatch,
+                             uint32_t ioThreads, uint32_t riskThreads)
+    : index_(index), maxBatch_(maxBatch), store_(poolCapacity), riskLanes_(riskThreads > 0)
+{
+    for (uint32_t i = 0; i < (riskThreads > 0 ? riskThreads : ioThreads); ++i)
+        inbound_.push_back(std::make_unique<SpscQueue<EngineCommand>>(queueCapacity));
+    executed_ = std::make_unique<std::atomic<uint64_t>[]>(inbound_.size());
+    for (uint32_t i = 0; i < ioThreads; ++i)
+        outbound_.push_back(std::make_unique<SpscQueue<OutboundReport>>(queueCapacity));
+    batch_.reserve(maxBatch_ != 0 ? maxBatch_ : 1024);
+    batchLanes_.reserve(batch_.capacity());
+}
+
+MatchingShard::~MatchingShard()
+{
+    stop();
+}
+
+void MatchingShard::addSymbol(uint32_t symbolId, const InstrumentSpec &spec)
+{
+    books_[symbolId] = std::make_unique<OrderBook>(spec, store_);
+}
+
+void MatchingShard::setMarketData(MarketDataChannel *channel)
+{
+    marketData_ = channel;
+    for (auto &entry : books_)
+        entry.second->setMarketData(channel, entry.first);
+}
+
+void MatchingShard::setRiskFeed(RiskFeed *feed)
+{
+    risk_ = feed;
+    for (auto &entry : books_)
+        entry.second->setRiskFeed(feed, entry.first);
+}
+
+void MatchingShard::releaseRisk(const EngineCommand &cmd) const
+{
+    if (!risk_)
+        return;
+    if (cmd.type == CommandType::NEW_ORDER)
+        risk_->push({cmd.order.user_id, -1, -cmd.order.price * cmd.order.quantity});
+    else if (cmd.type == CommandType::REPLACE_ORDER && (cmd.flags & COMMAND_RISK_BUDGET) && !cmd.order.user_id.empty())
+        risk_->push({cmd.order.user_id, 0, -cmd.order.price * cmd.order.quantity});
+}
+
+OrderBook *MatchingShard::bookFor(const EngineCommand &cmd) const
+{
+    auto it = books_.find(cmd.symbol_id);
+    if (it != books_.end())
+        return it->second.get();
+    const OrderId &id = cmd.type == CommandType::NEW_ORDER ? cmd.order.order_id : cmd.cancel_id;
+    EventType event = cmd.type == CommandType::NEW_ORDER       ? EventType::ORDER_REJECTED
+                      : cmd.type == CommandType::REPLACE_ORDER ? EventType::REPLACE_REJECTED
+                                                               : EventType::CANCEL_REJECTED;
+    EventLog::write(event, static_cast<uint8_t>(RejectReason::UNKNOWN_SYMBOL), cmd.symbol_id, cmd.conn_id,
+                    cmd.order.price, cmd.order.quantity, 0, id.data);
+    return nullptr;
+}
+
+void MatchingShard::logMassCanceled(const EngineCommand &cmd, uint32_t canceled) const
+{
+    OrderId user = OrderId::fromString(cmd.order.user_id.view()); // 事件记录的 id 字段为 32 字节
+    EventLog::write(EventType::MASS_CANCELED, cmd.mass_scope, 0, cmd.conn_id, 0.0, static_cast<int32_t>(canceled),
+                    cmd.mass_side, user.data);
+}
+
+bool MatchingShard::openJournal(const JournalOptions &options, uint32_t snapshotIntervalSec)
+{
+    auto snapshotSeq = Snapshot::loadLatest(options.dir, index_, options.shard_count, books_);
+    if (!snapshotSeq)
+        return false;
+    snapshotSeq_ = *snapshotSeq;
+
+    journal_ = std::make_unique<Journal>(options);
+    // 重放产生的回报无人接收，直接丢弃
+    auto discard = [](const ExecutionReport &) {};
+    if (!journal_->open(snapshotSeq_, [this, &discard](uint64_t, const EngineCommand &cmd)
+                        { execute(cmd, discard); }))
+        return false;
+    if (marketData_)
+        marketData_->flush();
+
+    if (snapshotIntervalSec > 0)
+    {
+        snapshotInterval_ = std::chrono::seconds(snapshotIntervalSec);
+        nextSnapshot_ = std::chrono::steady_clock::now() + snapshotInterval_;
+        snapshotBuffer_.resize(SNAPSHOT_BUFFER_SIZE);
+    }
+    return true;
+}
+
+void MatchingShard::maybeSnapshot()
+{
+    if (snapshotPid_ > 0)
+        reapSnapshot(false);
+    if (snapshotInterval_.count() == 0 || snapshotPid_ > 0)
+        return;
+    auto now = std::chrono::steady_clock::now();
+    if (now < nextSnapshot_)
+        return;
+    nextSnapshot_ = now + snapshotInterval_;
+    uint64_t seq = journal_->lastSeq();
+    if (seq == snapshotSeq_)
+        return; // 上次快照之后没有新指令
+
+    // 路径在 fork 前生成：子进程只能调用异步信号安全的函数，不能分配内存
+    const JournalOptions &options = journal_->options();
+    std::string finalPath = Snapshot::path(options.dir, index_, seq);
+    std::string tmpPath = finalPath + ".tmp";
+
+    // fork 时内核只复制页表，父进程之后修改的页写时复制，子进程看到的是本批结束时的订单簿
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        bool ok = Snapshot::write(tmpPath.c_str(), finalPath.c_str(), options.dir.c_str(), index_,
+                                  options.shard_count, seq, books_, snapshotBuffer_.data(),
+                                  snapshotBuffer_.size());
+        _exit(ok ? 0 : 1);
+    }
+    if (pid < 0)
+    {
+        spdlog::error("Shard {}: fork for snapshot failed: {}", index_, strerror(errno));
+        return;
+    }
+    snapshotPid_ = pid;
+    pendingSeq_ = seq;
+}
+
+void MatchingShard::reapSnapshot(bool block)
+{
+    int status = 0;
+    pid_t pid = waitpid(snapshotPid_, &status, block ? 0 : WNOHANG);
+    if (pid == 0)
+        return; // 仍在写
+    snapshotPid_ = 0;
+    if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        spdlog::error("Shard {}: snapshot at seq {} failed", index_, pendingSeq_);
+        return;
+    }
+
+    snapshotSeq_ = pendingSeq_;
+    const JournalOptions &options = journal_->options();
+    Snapshot::removeOlder(options.dir, index_, snapshotSeq_);
+    size_t released = journal_->releaseThrough(snapshotSeq_);
+    spdlog::info("Shard {}: snapshot at seq {} written, {} journal segment(s) released",
+                 index_, snapshotSeq_, released);
+}
+
+bool MatchingShard::appendToJournal(const EngineCommand &cmd)
+{
+    if (!journal_ || journal_->append(cmd) != 0)
+        return true;
+    // 日志失效后每条指令都会被拒绝，失效时已记录过一次
+    if (!journal_->failed())
+        spdlog::error("Shard {}: journal append failed, command rejected", index_);
+    return false;
+}
+
+bool MatchingShard::commit()
+{
+    if (journal_)
+    {
+        if (!journal_->commit())
+            return false;
+        maybeSnapshot();
+    }
+    if (marketData_)
+        marketData_->flush();
+    return true;
+}
+
+void MatchingShard::start(std::function<void(uint32_t)> onReports, const ThreadOptions &threadOptions)
+{
+    onReports_ = std::move(onReports);
+    threadOptions_ = threadOptions;
+    running_.store(true);
+    thread_ = std::thread(&MatchingShard::run, this);
+}
+
+void MatchingShard::stop()
+{
+    if (running_.exchange(false))
+    {
+        inboundNotifier_.wake();
+        if (thread_.joinable())
+            thread_.join();
+    }
+    if (snapshotPid_ > 0)
+        reapSnapshot(true);
+}
+
+bool MatchingShard::submit(uint32_t producer, const EngineCommand &cmd)
+{
+    if (!inbound_[producer]->push(cmd))
+        return false;
+    inboundNotifier_.notify();
+    return true;
+}
+
+void MatchingShard::run()
+{
+    spdlog::info("Matching shard {} started with {} symbols", index_, books_.size());
+    LATENCY_TRACE_ONLY(LatencyTrace::setThreadName("shard " + std::to_string(index_)));
+    applyThreadOptions("shard " + std::to_string(index_), threadOptions_);
+    IdleSpinner spinner(threadOptions_);
+
+    uint64_t connId = 0;
+    uint8_t reportFlags = 0;
+    uint8_t lane = 0;
+    std::vector<uint8_t> produced(outbound_.size(), 0); // 本批向哪些 I/O 线程产生了回报
+    std::vector<uint64_t> executed(inbound_.size(), 0);
+    // 回报按连接所属 I/O 线程写入对应输出队列，队列满时先唤醒该线程再让出 CPU
+    auto push = [this, &produced](const OutboundReport &item)
+    {
+        uint32_t ioThread = connectionReactor(item.conn_id);
+        while (!outbound_[ioThread]->push(item))
+        {
+            onReports_(ioThread);
+            std::this_thread::yield();
+        }
+        produced[ioThread] = 1;
+    };
+    // 回调只构造一次，连接与批量标志随当前指令切换
+    auto toOutbound = [&push, &connId, &reportFlags, &lane](const ExecutionReport &report)
+    {
+        OutboundReport item{connId, report, reportFlags, lane};
+        LATENCY_TRACE_ONLY(item.trace_ingress = LatencyTrace::ingress());
+        push(item);
+    };
+    // 批量消息在本分片的最后一条指令之后：通知 I/O 线程把暂存的批量回报作为一帧发出
+    auto endBatch = [&push, &lane](const EngineCommand &cmd)
+    {
+        if (!(cmd.flags & COMMAND_BATCH_END))
+            return;
+        OutboundReport marker{cmd.conn_id, ExecutionReport{}, REPORT_BATCH_END, lane};
+        LATENCY_TRACE_ONLY(marker.trace_ingress = cmd.trace_ingress);
+        push(marker);
+    };
+
+    while (running_.load(std::memory_order_relaxed))
+    {
+        // 每批至多 maxBatch_ 条，批末通知一次，回报不会因输入持续到达而一直积压。
+        // 多个 I/O 线程的输入队列逐条轮流取，任何一个连接多的线程都不会饿死其他线程
+        batch_.clear();
+        batchLanes_.clear();
+        bool more = true;
+        while (more && (maxBatch_ == 0 || batch_.size() < maxBatch_))
+        {
+            more = false;
+            for (size_t q = 0; q < inbound_.size(); ++q)
+            {
+                SpscQueue<EngineCommand> &queue = *inbound_[q];
+                const EngineCommand *cmd = queue.front();
+                if (!cmd)
+                    continue;
+                LATENCY_TRACE_RECORD(QUEUE, cmd->trace_enqueue);
+                batch_.push_back(*cmd);
+                // 经不同风控线程到达的批量指令会交错，回报按来源队列分别暂存
+                batchLanes_.push_back(riskLanes_ ? static_cast<uint8_t>(q) : 0);
+                queue.pop();
+                more = true;
+                if (maxBatch_ != 0 && batch_.size() >= maxBatch_)
+                    break;
+            }
+        }
+        uint64_t n = batch_.size();
+
+        // 组提交：整批先落日志并 fdatasync 一次，再撮合，回报只在落盘之后产生
+        if (journal_ && n > 0)
+        {
+            const bool failed = journal_->failed();
+            for (size_t i = 0; i < batch_.size(); ++i)
+            {
+                EngineCommand &cmd = batch_[i];
+                if (cmd.type == CommandType::RISK_REJECTED)
+                    continue;
+                connId = cmd.conn_id;
+                reportFlags = (cmd.flags & COMMAND_BATCHED) ? REPORT_BATCHED : 0;
+                lane = batchLanes_[i];
+                LATENCY_TRACE_ONLY(LatencyTrace::setIngress(cmd.trace_ingress));
+                if (!journalAppend(cmd, toOutbound))
+                    cmd.type = CommandType::NONE; // 已拒绝，不再执行
+            }
+            if (!journal_->commit())
+            {
+                // 本批没有落盘：整批拒绝、不执行。日志随之失效，之后的指令在 append 时逐条拒绝
+                if (!failed)
+                    spdlog::critical("Shard {}: journal commit failed, batch rejected; no further commands accepted",
+                                     index_);
+                for (size_t i = 0; i < batch_.size(); ++i)
+                {
+                    EngineCommand &cmd = batch_[i];
+                    if (cmd.type == CommandType::NONE || cmd.type == CommandType::RISK_REJECTED)
+                        continue;
+                    connId = cmd.conn_id;
+                    reportFlags = (cmd.flags & COMMAND_BATCHED) ? REPORT_BATCHED : 0;
+                    lane = batchLanes_[i];
+                    rejectUnjournaled(cmd, toOutbound);
+                    cmd.type = CommandType::NONE;
+                }
+            }
+        }
+        for (size_t i = 0; i < batch_.size(); ++i)
+        {
+            const EngineCommand &cmd = batch_[i];
+            lane = batchLanes_[i];
+            if (cmd.type != CommandType::NONE)
+            {
+                connId = cmd.conn_id;
+                reportFlags = (cmd.flags & COMMAND_BATCHED) ? REPORT_BATCHED : 0;
+                LATENCY_TRACE_ONLY(LatencyTrace::setIngress(cmd.trace_ingress));
+                LATENCY_TRACE_STAMP(matchStart);
+                execute(cmd, toOutbound);
+                LATENCY_TRACE_RECORD(MATCH, matchStart);
+            }
+            endBatch(cmd);
+            ++executed[lane];
+        }
+
+        if (n > 0)
+        {
+            if (journal_)
+                maybeSnapshot();
+            if (marketData_)
+                marketData_->flush();
+            if (risk_)
+                risk_->flush();
+            if (riskLanes_)
+            {
+                for (size_t q = 0; q < executed.size(); ++q)
+                    executed_[q].store(executed[q], std::memory_order_release);
+            }
+            processed_.fetch_add(n, std::memory_order_relaxed);
+            publishStats();
+            for (uint32_t i = 0; i < produced.size(); ++i)
+            {
+                if (produced[i])
+                {
+                    produced[i] = 0;
+                    onReports_(i);
+                }
+            }
+            spinner.busy();
+            continue;
+        }
+
+        // 空转策略下不登记休眠，生产者的 notify 也就不会写 eventfd，两侧都没有系统调用
+        if (spinner.blocks())
+            inboundNotifier_.wait([this]
+                                  { return inboundDepth() > 0 || !running_.load(); });
+        else
+            spinner.idle();
+    }
+    spdlog::info("Matching shard {} stopped", index_);
+}
+
+size_t MatchingShard::inboundDepth() const
+{
+    size_t depth = 0;
+    for (const auto &queue : inbound_)
+        depth += queue->size();
+    return depth;
+}
+
+size_t MatchingShard::outboundDepth() const
+{
+    size_t depth = 0;
+    for (const auto &queue : outbound_)
+        depth += queue->size();
+    return depth;
+}
+
+void MatchingShard::publishStats()
+{
+    auto stats = store_.pool.stats();
+    poolInUse_.store(stats.in_use, std::memory_order_relaxed);
+    poolHighWater_.store(stats.high_water, std::memory_order_relaxed);
+    poolAllocFailures_.store(stats.alloc_failures, std::memory_order_relaxed);
+}
+
+OrderPoolStats MatchingShard::poolStats() const
+{
+    if (!running_.load())
+        return store_.pool.stats();
+    return {store_.pool.stats().capacity,
+            poolInUse_.load(std::memory_order_relaxed),
+            poolHighWater_.load(std::memory_order_relaxed),
+            poolAllocFailures_.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,230 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "OrderBook.h"
+#include "EngineCommand.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "MarketData.h"
+#include "RiskShard.h"
+#include <sys/types.h>
+#include "utils/SpscQueue.h"
+#include "utils/WaitNotifier.h"
+#include "utils/ThreadTuning.h"
+
+// 撮合分片：独占一组品种的订单簿和一份订单存储。
+// 内联模式下由 I/O 线程直接调用 execute()；线程模式下分片拥有自己的撮合线程，
+// 与每个 I/O 线程之间各有一对 SPSC 队列交换指令和回报，订单簿本身不加任何锁。
+// 启用风控时指令改由风控线程投递，输入队列按风控线程各一条，输出队列仍按 I/O 线程。
+class MatchingShard
+{
+public:
+    // maxBatch: 撮合线程每批最多处理的指令数，批末统一通知回报，0 表示不限
+    // ioThreads: I/O 线程数，每个 I/O 线程一条输出队列；未启用风控时也各有一条输入队列
+    // riskThreads: 风控线程数，非 0 时输入队列改为每个风控线程一条
+    MatchingShard(uint32_t index, uint32_t poolCapacity, uint32_t queueCapacity, uint32_t maxBatch = 0,
+                  uint32_t ioThreads = 1, uint32_t riskThreads = 0);
+    ~MatchingShard();
+
+    void addSymbol(uint32_t symbolId, const InstrumentSpec &spec);
+
+    // 启用预写日志：先加载日志目录中最新的快照，再重放快照之后的日志重建订单簿，
+    // 之后每条指令执行前追加到日志。snapshotIntervalSec 非 0 时按此间隔在批次边界
+    // fork 子进程写快照，撮合不停顿。必须在 start() 之前调用，失败返回 false
+    bool openJournal(const JournalOptions &options, uint32_t snapshotIntervalSec = 0);
+
+    // 启用行情：分片内全部订单簿的变化写入 channel，每批结束唤醒一次发布线程。
+    // 在 openJournal 之前调用，恢复过程中的变化也会发布
+    void setMarketData(MarketDataChannel *channel);
+
+    // 启用风控回馈（见 RiskShard）。在 openJournal 之后、start 之前调用，重放不产生回馈
+    void setRiskFeed(RiskFeed *feed);
+    // 遍历全部挂单：fn(const OrderNode &, const InstrumentSpec &)。启动时撮合线程尚未运行时调用
+    template <typename Fn>
+    void forEachRestingOrder(Fn &&fn) const
+    {
+        for (const auto &entry : books_)
+        {
+            const OrderBook &book = *entry.second;
+            book.forEachRestingOrder([&fn, &book](const OrderNode &node)
+                                     { fn(node, book.spec()); });
+        }
+    }
+
+    // 在调用线程上执行一条指令（不写日志，重放也走这里）。sink 接收回报，见 OrderBook
+    template <typename Sink>
+    void execute(const EngineCommand &cmd, Sink &&sink);
+    // 内联模式：写日志后执行。回报须等 commit() 之后才能发出
+    template <typename Sink>
+    void process(const EngineCommand &cmd, Sink &&sink);
+    // 内联模式：组提交本批已写入的日志，到期时顺带发起快照，并唤醒行情发布线程。
+    // 落盘失败返回 false：本批已执行、回报尚未发出，调用方不能再发出这些回报
+    bool commit();
+
+    // 线程模式：onReports(ioThread) 在有发往该 I/O 线程的新回报入队后被调用（撮合线程上）。
+    // threadOptions 决定撮合线程的绑核、调度策略，以及空闲时阻塞还是空转
+    void start(std::function<void(uint32_t)> onReports, const ThreadOptions &threadOptions = ThreadOptions{});
+    void stop();
+
+    // 生产者（I/O 线程，启用风控时为风控线程）producer 调用：投递指令并唤醒撮合线程，队列满时返回 false
+    bool submit(uint32_t producer, const EngineCommand &cmd);
+    // 批量投递：enqueue 只入队，一批结束后调用一次 publish 唤醒撮合线程
+    bool enqueue(uint32_t producer, const EngineCommand &cmd) { return inbound_[producer]->push(cmd); }
+    void publish() { inboundNotifier_.notify(); }
+
+    // 消费线程调用：取出发往 ioThread 的待发送回报（按连接 ID 路由），limit 为 0 时取空队列
+    template <typename Fn>
+    size_t drainReports(uint32_t ioThread, Fn &&fn, size_t limit = 0)
+    {
+        SpscQueue<OutboundReport> &queue = *outbound_[ioThread];
+        size_t n = 0;
+        while (limit == 0 || n < limit)
+        {
+            const OutboundReport *item = queue.front();
+            if (!item)
+                break;
+            fn(*item);
+            queue.pop();
+            ++n;
+        }
+        return n;
+    }
+
+    bool hasReports(uint32_t ioThread) const { return !outbound_[ioThread]->empty(); }
+    size_t inboundDepth() const;
+    size_t outboundDepth() const;
+
+    uint32_t index() const { return index_; }
+    uint64_t processed() const { return processed_.load(std::memory_order_relaxed); }
+    // 启用风控时：已执行完的、来自风控线程 producer 的指令数（批末发布）
+    uint64_t executed(uint32_t producer) const { return executed_[producer].load(std::memory_order_acquire); }
+    // 线程模式下由撮合线程定期发布，其他线程读取
+    OrderPoolStats poolStats() const;
+
+private:
+    void run();
+    // 落日志失败时回报 REJECTED 并返回 false：无法落日志的指令不能执行，否则重启后状态不一致
+    template <typename Sink>
+    bool journalAppend(const EngineCommand &cmd, Sink &sink);
+    template <typename Sink>
+    void rejectUnjournaled(const EngineCommand &cmd, Sink &sink);
+    bool appendToJournal(const EngineCommand &cmd);
+    // 风控已计入、却没有进入订单簿的新单（未知品种、落日志失败）：释放其未结额度。
+    // 带 user_id 的改单执行完（无论成败）释放风控为它预留的额度，实际变化由订单簿回馈
+    void releaseRisk(const EngineCommand &cmd) const;
+    // 指令所属的订单簿；品种未知时记录拒绝事件并返回 nullptr
+    OrderBook *bookFor(const EngineCommand &cmd) const;
+    void logMassCanceled(const EngineCommand &cmd, uint32_t canceled) const;
+    void publishStats();
+    void maybeSnapshot();
+    void reapSnapshot(bool block);
+
+    uint32_t index_;
+    uint32_t maxBatch_;
+    OrderStore store_;
+    BookMap books_;
+    std::unique_ptr<Journal> journal_;
+    MarketDataChannel *marketData_ = nullptr;
+    RiskFeed *risk_ = nullptr;
+    bool riskLanes_ = false; // 输入队列按风控线程划分：回报带上来源队列下标
+
+    // 快照：子进程写入期间 snapshotPid_ 非 0，由撮合线程在批末非阻塞回收
+    std::chrono::seconds snapshotInterval_{0};
+    std::chrono::steady_clock::time_point nextSnapshot_;
+    std::vector<uint8_t> snapshotBuffer_; // 子进程的写缓冲，fork 前分配好
+    pid_t snapshotPid_ = 0;
+    uint64_t snapshotSeq_ = 0;    // 最近一次成功（或正在写）的快照序号
+    uint64_t pendingSeq_ = 0;
+    std::vector<EngineCommand> batch_; // 撮合线程：本批取出的指令，先整批落日志再执行
+    std::vector<uint8_t> batchLanes_;  // 与 batch_ 对应：指令来自哪条输入队列
+
+    std::vector<std::unique_ptr<SpscQueue<EngineCommand>>> inbound_;   // 按生产者下标
+    std::vector<std::unique_ptr<SpscQueue<OutboundReport>>> outbound_; // 按连接所属 I/O 线程下标
+    WaitNotifier inboundNotifier_;
+    std::function<void(uint32_t)> onReports_;
+    ThreadOptions threadOptions_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint64_t> processed_{0};
+    std::unique_ptr<std::atomic<uint64_t>[]> executed_; // 按输入队列下标
+    std::atomic<uint32_t> poolInUse_{0};
+    std::atomic<uint32_t> poolHighWater_{0};
+    std::atomic<uint64_t> poolAllocFailures_{0};
+};
+
+template <typename Sink>
+void MatchingShard::execute(const EngineCommand &cmd, Sink &&sink)
+{
+    if (cmd.type == CommandType::RISK_REJECTED)
+    {
+        // 拒绝事件已由风控线程记录，订单簿不受影响
+        sink(ExecutionReport{cmd.cancel_id, cmd.order.price, 0, 0, ExecType::REJECTED});
+        return;
+    }
+    if (cmd.type == CommandType::MASS_CANCEL)
+    {
+        MassCancelFilter filter{static_cast<MassCancelScope>(cmd.mass_scope), cmd.mass_side, cmd.order.user_id,
+                                cmd.conn_id};
+        uint32_t canceled = 0;
+        for (auto &entry : books_)
+            canceled += entry.second->massCancel(filter, sink);
+        logMassCanceled(cmd, canceled);
+        return;
+    }
+
+    OrderBook *book = bookFor(cmd);
+    if (!book)
+    {
+        releaseRisk(cmd);
+        sink(ExecutionReport{cmd.type == CommandType::NEW_ORDER ? cmd.order.order_id : cmd.cancel_id, 0.0, 0, 0,
+                             ExecType::REJECTED});
+        return;
+    }
+
+    if (cmd.type == CommandType::NEW_ORDER)
+    {
+        book->matchOrder(cmd.order, sink, cmd.conn_id);
+    }
+    else if (cmd.type == CommandType::REPLACE_ORDER)
+    {
+        ReplaceCheck check{cmd.order.user_id, (cmd.flags & COMMAND_RISK_BUDGET) != 0, cmd.risk_budget};
+        book->replaceOrder(cmd.cancel_id, cmd.order.price, cmd.order.quantity, sink, check);
+        releaseRisk(cmd);
+    }
+    else
+    {
+        book->cancelOrder(cmd.cancel_id, sink);
+    }
+}
+
+template <typename Sink>
+bool MatchingShard::journalAppend(const EngineCommand &cmd, Sink &sink)
+{
+    if (appendToJournal(cmd))
+        return true;
+    rejectUnjournaled(cmd, sink);
+    return false;
+}
+
+template <typename Sink>
+void MatchingShard::rejectUnjournaled(const EngineCommand &cmd, Sink &sink)
+{
+    releaseRisk(cmd);
+    sink(ExecutionReport{cmd.type == CommandType::NEW_ORDER ? cmd.order.order_id : cmd.cancel_id, 0.0, 0, 0,
+                         ExecType::REJECTED});
+}
+
+template <typename Sink>
+void MatchingShard::process(const EngineCommand &cmd, Sink &&sink)
+{
+    LATENCY_TRACE_STAMP(matchStart);
+    if (journalAppend(cmd, sink))
+        execute(cmd, sink);
+    LATENCY_TRACE_RECORD(MATCH, matchStart);
+}
@@ -1,81 +1,73 @@
 #include "Order.h"
-#include "utils/Logger.h"
+#include <cstring>
 
 std::vector<uint8_t> Order::serialize() const
 {
-    std::vector<uint8_t> buf(73, 0);
-    size_t offset = 0;
-
-    size_t uid_len = std::min(user_id.size(), static_cast<size_t>(15));
-    memcpy(buf.data(), user_id.data(), uid_len);
-    offset += 16;
-
-    size_t orderid_len = std::min(order_id.size(), static_cast<size_t>(31));
-    memcpy(buf.data()+offset, order_id.data(), orderid_len);
-    offset += 32;
-
-    buf[offset++] = static_cast<uint8_t>(side);
-
-    std::memcpy(buf.data() + offset, &price, sizeof(double));
-    offset += sizeof(double);
-
-    std::memcpy(buf.data() + offset, &quantity, sizeof(int32_t));
-    offset += sizeof(int32_t);
-
-    std::memcpy(buf.data() + offset, &remaining_quantity, sizeof(int32_t));
-    offset += sizeof(int32_t);
-
-    std::memcpy(buf.data() + offset, &timestamp, sizeof(uint64_t));
-
+    std::vector<uint8_t> buf(WIRE_SIZE, 0);
+    serializeTo(buf.data());
     return buf;
 }
 
-std::optional<Order> Order::deserialize(const std::vector<uint8_t> &data)
+void Order::serializeTo(uint8_t *out) const
+{
+    // 按线上结构原地写入，偏移由生成代码保证
+    auto *msg = reinterpret_cast<wire::NewOrder *>(out);
+    std::memcpy(msg->user_id, user_id.data, sizeof(msg->user_id));
+    std::memcpy(msg->order_id, order_id.data, sizeof(msg->order_id));
+    msg->side = static_cast<uint8_t>(side);
+    msg->price = price;
+    msg->quantity = quantity;
+    msg->remaining_quantity = remaining_quantity;
+    msg->timestamp = timestamp;
+    msg->symbol_id = symbol_id;
+    msg->order_type = static_cast<uint8_t>(type);
+}
+
+std::optional<Order> Order::deserialize(const uint8_t *data, size_t size)
 {
-    if (data.size() != 73)
+    if (size != WIRE_SIZE)
+    {
+        if (size != V1_WIRE_SIZE && size != LEGACY_WIRE_SIZE)
+        {
+            return std::nullopt;
+        }
+        // 旧格式是当前格式的前缀，补零后缺的字段恰好是默认值（symbol_id 为 0、order_type 为 LIMIT）
+        wire::NewOrder padded{};
+        std::memcpy(&padded, data, size);
+        return deserialize(reinterpret_cast<const uint8_t *>(&padded), WIRE_SIZE);
+    }
+
+    // 直接在接收缓冲区上按线上结构读取
+    const auto &msg = *reinterpret_cast<const wire::NewOrder *>(data);
+    if (msg.side > static_cast<uint8_t>(OrderSide::BUY) || msg.order_type > static_cast<uint8_t>(OrderType::FOK))
     {
-        spdlog::error("Invalid order binary size: {}", data.size());
         return std::nullopt;
     }
 
     Order order;
-    size_t offset = 0;
-
-    std::string uid(reinterpret_cast<const char *>(data.data() + offset), 16);
-    uid.resize(uid.find('\0')); // 截断到第一个 \0
-    order.user_id = std::move(uid);
-    offset += 16;
-
-    std::string oid(reinterpret_cast<const char *>(data.data() + offset), 32);
-    oid.resize(oid.find('\0'));
-    order.order_id = std::move(oid);
-    offset += 32;
-
-    uint8_t side_val = data[offset++];
-    if (side_val > 1)
+    order.user_id = UserId::fromBytes(msg.user_id); // 定长拷贝，不分配堆内存
+    order.order_id = OrderId::fromBytes(msg.order_id);
+    order.side = static_cast<OrderSide>(msg.side);
+    order.price = msg.price;
+    order.quantity = msg.quantity;
+    order.remaining_quantity = msg.remaining_quantity;
+    order.timestamp = msg.timestamp;
+    order.symbol_id = msg.symbol_id;
+    order.type = static_cast<OrderType>(msg.order_type);
+
+    // 简单校验；市价单不看价格，统一记 0
+    if (order.type == OrderType::MARKET)
+    {
+        order.price = 0.0;
+    }
+    else if (order.price <= 0)
     {
-        spdlog::error("Invalid order side: {}", side_val);
         return std::nullopt;
     }
-    order.side = static_cast<OrderSide>(side_val);
-
-    std::memcpy(&order.price, data.data() + offset, sizeof(double));
-    offset += sizeof(double);
-
-    std::memcpy(&order.quantity, data.data() + offset, sizeof(int32_t));
-    offset += sizeof(int32_t);
-
-    std::memcpy(&order.remaining_quantity, data.data() + offset, sizeof(int32_t));
-    offset += sizeof(int32_t);
-
-    std::memcpy(&order.timestamp, data.data() + offset, sizeof(uint64_t));
-
-    // 简单校验
-    if (order.price <= 0 || order.quantity <= 0)
+    if (order.quantity <= 0)
     {
-        spdlog::error("Invalid order: price={}, qty={}", order.price, order.quantity);
         return std::nullopt;
     }
 
     return order;
-}
\ No newline at end of file
+}
@@ -3,24 +3,34 @@
 #include <cstdint>
 #include <vector>
 #include <optional>
-
-enum class OrderSide : uint8_t
-{
-    BUY = 1,
-    SELL = 0
-};
+#include "FixedString.h"
+#include "protocol/WireMessages.h"
 
 struct Order
 {
-    std::string user_id;        // 16
-    std::string order_id;       // 32
+    UserId user_id;             // 16
+    OrderId order_id;           // 32
     OrderSide side;             // 1
     double price;               // 8
     int32_t quantity;           // 4
     int32_t remaining_quantity; // 4
     uint64_t timestamp;         // 8
+    uint32_t symbol_id;         // 4
+    OrderType type = OrderType::LIMIT; // 1
+
+    // 线上格式为 wire::NewOrder（OrderSide / OrderType 也在 schema 中定义）
+    static constexpr size_t WIRE_SIZE = sizeof(wire::NewOrder);
+    static constexpr size_t V1_WIRE_SIZE = offsetof(wire::NewOrder, order_type);   // 不带 order_type 的格式，视为限价单
+    static constexpr size_t LEGACY_WIRE_SIZE = offsetof(wire::NewOrder, symbol_id); // 不带 symbol_id 的旧格式，视为品种 0
 
     std::vector<uint8_t> serialize() const;
+    // 写入调用方提供的 WIRE_SIZE 字节缓冲区，不分配内存
+    void serializeTo(uint8_t *out) const;
 
-    static std::optional<Order> deserialize(const std::vector<uint8_t> &data);
-};
\ No newline at end of file
+    // 直接从接收缓冲区解析，不分配内存
+    static std::optional<Order> deserialize(const uint8_t *data, size_t size);
+    static std::optional<Order> deserialize(const std::vector<uint8_t> &data)
+    {
+        return deserialize(data.data(), data.size());
+    }
+};
@@ -1,146 +1,360 @@
 #include "OrderBook.h"
+#include "MarketData.h"
+#include "RiskShard.h"
 #include "utils/Logger.h"
-OrderBook::OrderBook() = default;
-template <typename BookType, typename TradePredicate>
-void OrderBook::matchAgainstBook(Order &order, BookType &book, TradePredicate canTrade, MatchCallback &callback)
-{
-    auto it = book.begin();
-    while (order.remaining_quantity > 0 &&
-           it != book.end() &&
-           canTrade(order.price, it->first))
-    {
+#include "utils/EventLog.h"
 
-        auto &list = it->second;
-        auto &front_order = list.front();
+OrderBook::OrderBook(const InstrumentSpec &spec, uint32_t poolCapacity)
+    : spec_(spec),
+      ownedStore_(std::make_unique<OrderStore>(poolCapacity)),
+      pool_(ownedStore_->pool),
+      orderIndex(ownedStore_->index),
+      owners_(ownedStore_->owners),
+      ownerBook_(owners_.addBook()),
+      ladder_(spec.num_levels)
+{
+}
 
-        int32_t trade_quantity = std::min(order.remaining_quantity, front_order.remaining_quantity);
-        // 执行成交
+OrderBook::OrderBook(const InstrumentSpec &spec, OrderStore &store)
+    : spec_(spec),
+      pool_(store.pool),
+      orderIndex(store.index),
+      owners_(store.owners),
+      ownerBook_(owners_.addBook()),
+      ladder_(spec.num_levels)
+{
+}
 
-        double trade_price = it->first;
-        lastTradedPrice = trade_price;
+Ticks OrderBook::limitTicks(const Order &order) const
+{
+    // 市价单没有价格限制：限价取阶梯上离对手方最远的一档，可以一路扫到底
+    if (order.type == OrderType::MARKET)
+        return order.side == OrderSide::BUY ? static_cast<Ticks>(ladder_.numLevels()) - 1 : 0;
+    return spec_.toTicks(order.price);
+}
 
-        order.remaining_quantity -= trade_quantity;
-        front_order.remaining_quantity -= trade_quantity;
-        generateReport(order, trade_quantity,
-                       front_order.remaining_quantity == 0 ? ExecType::FILL : ExecType::PARTIAL_FILL,
-                       callback);
-        // 如果单被完全吃掉
-        if (front_order.remaining_quantity == 0)
-        {
-            orderIndex.erase(front_order.order_id);
-            list.pop_front(); // 移除第一个元素
-            if (list.empty())
-            {
-                it = book.erase(it); // erase 返回下一个迭代器
-            }
-        }
-        else
-        {
-            break;
-        }
-    }
-    if (order.quantity - order.remaining_quantity > 0)
+bool OrderBook::admitNew(const Order &order, Ticks ticks) const
+{
+    RejectReason reason = RejectReason::NONE;
+    if (ticks == PriceLadder::NONE)
+        reason = RejectReason::OFF_GRID_PRICE;
+    else if (orderIndex.find(order.order_id) != NULL_ORDER)
+        reason = RejectReason::DUPLICATE_ORDER_ID;
+    else
+        return true;
+    // 订单簿不知道连接和品种编号，二者记 0，按 order_id 与 REPORT_SENT 关联
+    EventLog::write(EventType::ORDER_REJECTED, static_cast<uint8_t>(reason), 0, 0, order.price, order.quantity, 0,
+                    order.order_id.data);
+    return false;
+}
+
+OrderBook::Fill OrderBook::fillFront(Order &order, Ticks best)
+{
+    auto &level = ladder_.level(best);
+    OrderRef front = level.head;
+    auto &front_order = pool_[front];
+
+    // 执行成交
+    int32_t trade_quantity = std::min(order.remaining_quantity, front_order.remaining_quantity);
+    lastTradedTicks = best;
+    order.remaining_quantity -= trade_quantity;
+    front_order.remaining_quantity -= trade_quantity;
+    level.quantity -= trade_quantity;
+    publishTrade(order.side, best, trade_quantity);
+    if (risk_)
     {
-        int32_t filled = order.quantity - order.remaining_quantity;
-        generateReport(order, filled,
-                       order.remaining_quantity == 0 ? ExecType::FILL : ExecType::PARTIAL_FILL,
-                       callback);
+        double price = spec_.toPrice(best);
+        if (lastPrice_)
+            lastPrice_->store(price, std::memory_order_relaxed);
+        adjustRisk(front_order.user_id, front_order.remaining_quantity > 0 ? 0 : -1, -price * trade_quantity);
     }
+    if (front_order.remaining_quantity > 0)
+        return {trade_quantity, false, false};
+
+    // 队首被完全吃掉
+    orderIndex.erase(front_order.order_id);
+    owners_.erase(ownerBook_, front);
+    unlink(level, front);
+    pool_.release(front);
+    if (!level.empty())
+        return {trade_quantity, true, false};
+    ladder_.markEmpty(best); // 位图中查找下一个最优档位
+    publishLevel(order.side == OrderSide::BUY ? OrderSide::SELL : OrderSide::BUY, best, level);
+    return {trade_quantity, true, true};
 }
 
-bool OrderBook::matchOrder(Order order, MatchCallback callback)
+bool OrderBook::canFill(OrderSide side, Ticks limit, int32_t quantity) const
 {
-    double price = order.price;
-    std::string order_id = order.order_id;
-    if (order.side == OrderSide::BUY)
+    int64_t available = 0;
+    if (side == OrderSide::BUY)
     {
-        matchAgainstBook(order, sellBook, [](double buyPx, double sellPx)
-                         { return buyPx >= sellPx; }, callback);
-        if (order.remaining_quantity > 0)
+        for (Ticks t = ladder_.bestAsk(); t != PriceLadder::NONE && t <= limit; t = ladder_.nextOccupiedAbove(t))
         {
-            buyBook[price].push_back(std::move(order));
-            orderIndex[order_id] = {
-                price,
-                std::prev(buyBook[price].end()),
-                OrderSide::BUY};
-            generateReport(
-                *orderIndex[order_id].iter,
-                0,
-                (order.quantity == order.remaining_quantity) ? ExecType::NEW : ExecType::PARTIAL_FILL,
-                callback); // 未成交的单
+            available += ladder_.level(t).quantity;
+            if (available >= quantity)
+                return true;
         }
     }
     else
     {
-        matchAgainstBook(order, buyBook, [](double sellPx, double buyPx)
-                         { return buyPx >= sellPx; }, callback);
-        if (order.remaining_quantity > 0)
+        for (Ticks t = ladder_.bestBid(); t != PriceLadder::NONE && t >= limit; t = ladder_.nextOccupiedBelow(t))
         {
-            sellBook[price].push_back(std::move(order));
-            orderIndex[order_id] = {
-                price,
-                std::prev(sellBook[price].end()),
-                OrderSide::SELL};
-            generateReport(
-                *orderIndex[order_id].iter,
-                0,
-                (order.quantity == order.remaining_quantity) ? ExecType::NEW : ExecType::PARTIAL_FILL,
-                callback); // 未成交的单
+            available += ladder_.level(t).quantity;
+            if (available >= quantity)
+                return true;
         }
     }
-    return true;
+    return false;
 }
 
-bool OrderBook::cancelOrder(const std::string &order_id, MatchCallback callback)
+size_t OrderBook::depth(OrderSide side, DepthLevel *out, size_t maxLevels) const
 {
-    auto it = orderIndex.find(order_id);
-    if (it == orderIndex.end())
+    size_t n = 0;
+    Ticks t = side == OrderSide::BUY ? ladder_.bestBid() : ladder_.bestAsk();
+    while (n < maxLevels && t != PriceLadder::NONE)
     {
-        spdlog::warn("Cancel failed: order not found: {}", order_id);
+        const PriceLevel &level = ladder_.level(t);
+        out[n++] = {spec_.toPrice(t), level.quantity, level.count};
+        t = side == OrderSide::BUY ? ladder_.nextOccupiedBelow(t) : ladder_.nextOccupiedAbove(t);
+    }
+    return n;
+}
+
+void OrderBook::logExpired(const Order &order) const
+{
+    EventLog::write(EventType::ORDER_EXPIRED, static_cast<uint8_t>(order.type), 0, 0, order.price,
+                    order.quantity, order.remaining_quantity, order.order_id.data);
+}
+
+bool OrderBook::restoreOrder(const Order &order, Ticks ticks, uint64_t owner)
+{
+    if (ticks < 0 || ticks >= static_cast<Ticks>(ladder_.numLevels()) || orderIndex.find(order.order_id) != NULL_ORDER)
         return false;
+    return insertResting(order, ticks, owner) != NULL_ORDER;
+}
+
+OrderRef OrderBook::insertResting(const Order &order, Ticks ticks, uint64_t owner)
+{
+    OrderRef ref = pool_.allocate();
+    if (ref == NULL_ORDER)
+    {
+        spdlog::error("Order pool exhausted (capacity={}), order {} rejected",
+                      pool_.stats().capacity, order.order_id.view());
+        EventLog::write(EventType::ORDER_REJECTED, static_cast<uint8_t>(RejectReason::POOL_EXHAUSTED), 0, 0,
+                        order.price, order.quantity, 0, order.order_id.data);
+        return NULL_ORDER;
     }
 
-    const auto &handle = it->second;
+    auto &node = pool_[ref];
+    node.ticks = ticks;
+    node.quantity = order.quantity;
+    node.remaining_quantity = order.remaining_quantity;
+    node.timestamp = order.timestamp;
+    node.side = order.side;
+    node.user_id = order.user_id;
+    node.order_id = order.order_id;
+    node.owner = owner;
 
-    // 从订单簿中删除
-    if (handle.side == OrderSide::BUY)
+    auto &level = ladder_.level(ticks);
+    bool wasEmpty = level.empty();
+    linkBack(level, ref);
+    if (wasEmpty)
     {
-        buyBook[handle.price].erase(handle.iter);
-        // 清理空档位
-        if (buyBook[handle.price].empty())
-        {
-            buyBook.erase(handle.price);
-        }
+        ladder_.markOccupied(ticks, order.side);
+    }
+    publishLevel(order.side, ticks, level);
+
+    orderIndex.insert(ref);
+    owners_.insert(ownerBook_, ref);
+    return ref;
+}
+
+OrderId OrderBook::eraseResting(OrderRef ref)
+{
+    Ticks ticks = pool_[ref].ticks;
+    OrderSide side = pool_[ref].side;
+    OrderId order_id = pool_[ref].order_id;
+    adjustRisk(pool_[ref].user_id, -1, -spec_.toPrice(ticks) * pool_[ref].remaining_quantity);
+
+    // 从订单簿中删除（先删索引，索引比较键时需要读取记录中的 order_id）
+    orderIndex.erase(order_id);
+    owners_.erase(ownerBook_, ref);
+    auto &level = ladder_.level(ticks);
+    unlink(level, ref);
+    pool_.release(ref);
+    // 清理空档位
+    if (level.empty())
+    {
+        ladder_.markEmpty(ticks);
+    }
+    publishLevel(side, ticks, level);
+    EventLog::write(EventType::ORDER_CANCELED, 0, 0, 0, 0.0, 0, 0, order_id.data);
+    return order_id;
+}
+
+void OrderBook::linkBack(PriceLevel &level, OrderRef ref)
+{
+    auto &node = pool_[ref];
+    node.prev = level.tail;
+    node.next = NULL_ORDER;
+    if (level.tail != NULL_ORDER)
+        pool_[level.tail].next = ref;
+    else
+        level.head = ref;
+    level.tail = ref;
+    level.quantity += node.remaining_quantity;
+    ++level.count;
+}
+
+void OrderBook::unlink(PriceLevel &level, OrderRef ref)
+{
+    auto &node = pool_[ref];
+    if (node.prev != NULL_ORDER)
+        pool_[node.prev].next = node.next;
+    else
+        level.head = node.next;
+    if (node.next != NULL_ORDER)
+        pool_[node.next].prev = node.prev;
+    else
+        level.tail = node.prev;
+    level.quantity -= node.remaining_quantity;
+    --level.count;
+}
+
+OrderRef OrderBook::findForCancel(const OrderId &order_id) const
+{
+    OrderRef ref = orderIndex.find(order_id);
+    if (ref == NULL_ORDER)
+    {
+        EventLog::write(EventType::CANCEL_REJECTED, static_cast<uint8_t>(RejectReason::ORDER_NOT_FOUND), 0, 0,
+                        0.0, 0, 0, order_id.data);
+    }
+    return ref;
+}
+
+bool OrderBook::admitReplace(const OrderId &order_id, OrderRef ref, Ticks ticks, double price, int32_t quantity,
+                             const ReplaceCheck &check, int32_t &leaves) const
+{
+    RejectReason reason = RejectReason::NONE;
+    leaves = 0;
+    if (ref == NULL_ORDER)
+    {
+        reason = RejectReason::ORDER_NOT_FOUND;
     }
     else
     {
-        sellBook[handle.price].erase(handle.iter);
-        if (sellBook[handle.price].empty())
-        {
-            sellBook.erase(handle.price);
-        }
+        const auto &node = pool_[ref];
+        leaves = node.remaining_quantity;
+        // 名义金额的增加量，与 amendResting 回馈给风控的变化量相同
+        double growth = check.limited && ticks != PriceLadder::NONE
+                            ? spec_.toPrice(ticks) * quantity - spec_.toPrice(node.ticks) * leaves
+                            : 0.0;
+        if (ticks == PriceLadder::NONE)
+            reason = RejectReason::OFF_GRID_PRICE;
+        else if (quantity <= 0)
+            reason = RejectReason::INVALID_QUANTITY;
+        else if (!check.user.empty() && node.user_id != check.user)
+            reason = RejectReason::USER_MISMATCH;
+        else if (growth > 0 && check.user.empty())
+            reason = RejectReason::RISK_NO_USER;
+        else if (growth > 0 && growth > check.budget)
+            reason = RejectReason::RISK_NOTIONAL;
+        else
+            return true;
     }
-    //撤单通知
-    ExecutionReport report;
-    report.order_id = order_id;
-    report.exec_type = ExecType::CANCELED;
-    report.leaves_qty = 0;
-    callback(report);
-    spdlog::info("Order canceled: {}", order_id);
-    return true;
-}
-
-void OrderBook::generateReport(
-    const Order &order,
-    int32_t last_shares,
-    ExecType type,
-    MatchCallback &callback)
-{
-    ExecutionReport report;
-    report.order_id = order.order_id;
-    report.price = lastTradedPrice;
-    report.last_shares = last_shares;
-    report.leaves_qty = (type == ExecType::CANCELED) ? 0 : order.remaining_quantity;
-    report.exec_type = type;
-    callback(report);
-}
\ No newline at end of file
+    EventLog::write(EventType::REPLACE_REJECTED, static_cast<uint8_t>(reason), 0, 0, price, quantity, 0,
+                    order_id.data);
+    return false;
+}
+
+bool OrderBook::amendResting(OrderRef ref, Ticks ticks, double price, int32_t quantity, Order &aggressor,
+                             uint64_t &owner)
+{
+    auto &node = pool_[ref];
+    const OrderSide side = node.side;
+    const int32_t previous = node.remaining_quantity;
+    EventLog::write(EventType::ORDER_REPLACED, 0, 0, 0, price, quantity, previous, node.order_id.data);
+
+    auto &oldLevel = ladder_.level(node.ticks);
+    if (ticks == node.ticks && quantity <= previous)
+    {
+        // 同价减量：只改剩余数量与价位聚合，队列位置与档位结构都不动
+        adjustRisk(node.user_id, 0, -spec_.toPrice(ticks) * (previous - quantity));
+        node.remaining_quantity = quantity;
+        oldLevel.quantity -= previous - quantity;
+        publishLevel(side, ticks, oldLevel);
+        return false;
+    }
+
+    Ticks opposite = bestOpposite(side);
+    bool crosses = opposite != PriceLadder::NONE && (side == OrderSide::BUY ? ticks >= opposite : ticks <= opposite);
+    Ticks oldTicks = node.ticks;
+    // 交叉时之后按主动单结算，新数量中没有挂出的部分在撮合结束时释放
+    adjustRisk(node.user_id, 0, spec_.toPrice(ticks) * quantity - spec_.toPrice(oldTicks) * previous);
+    unlink(oldLevel, ref);
+    if (oldLevel.empty())
+        ladder_.markEmpty(oldTicks);
+    publishLevel(side, oldTicks, oldLevel);
+
+    if (crosses)
+    {
+        aggressor = Order{};
+        aggressor.user_id = node.user_id;
+        aggressor.order_id = node.order_id;
+        aggressor.side = side;
+        aggressor.price = price;
+        aggressor.quantity = quantity;
+        aggressor.remaining_quantity = quantity;
+        aggressor.timestamp = node.timestamp;
+        aggressor.symbol_id = symbolId_;
+        owner = node.owner;
+        orderIndex.erase(node.order_id);
+        owners_.erase(ownerBook_, ref);
+        pool_.release(ref);
+        return true;
+    }
+
+    // 不交叉：订单记录与索引原样保留，只把节点挪到新价位（或同价位）队尾
+    node.ticks = ticks;
+    node.remaining_quantity = quantity;
+    auto &newLevel = ladder_.level(ticks);
+    bool wasEmpty = newLevel.empty();
+    linkBack(newLevel, ref);
+    if (wasEmpty)
+        ladder_.markOccupied(ticks, side);
+    publishLevel(side, ticks, newLevel);
+    return false;
+}
+
+void OrderBook::publishLevel(OrderSide side, Ticks ticks, const PriceLevel &level)
+{
+    if (marketData_)
+        marketData_->push({MarketDataEventType::LEVEL, side, symbolId_, ticks, level.quantity, level.count});
+}
+
+void OrderBook::publishTrade(OrderSide aggressor, Ticks ticks, int32_t quantity)
+{
+    if (marketData_)
+        marketData_->push({MarketDataEventType::TRADE, aggressor, symbolId_, ticks, quantity, 0});
+}
+
+void OrderBook::setRiskFeed(RiskFeed *feed, uint32_t symbolId)
+{
+    risk_ = feed;
+    symbolId_ = symbolId;
+    lastPrice_ = feed ? feed->lastPrice(symbolId) : nullptr;
+    // 从快照 / 日志恢复出的最近成交价作为价格带的初始参考价
+    if (lastPrice_ && lastTradedTicks != PriceLadder::NONE)
+        lastPrice_->store(getLastTradedPrice(), std::memory_order_relaxed);
+}
+
+void OrderBook::adjustRisk(const UserId &user, int32_t orders, double notional)
+{
+    if (risk_)
+        risk_->push({user, orders, notional});
+}
+
+void OrderBook::settleAggressor(const Order &order, int32_t resting)
+{
+    adjustRisk(order.user_id, resting > 0 ? 0 : -1, -order.price * (order.quantity - resting));
+}
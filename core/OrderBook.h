@@ -1,41 +1,375 @@
 #pragma once
-#include <map>
-#include <list>
-#include <unordered_map>
-#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include "Order.h"
 #include "ExecutionReport.h"
+#include "Instrument.h"
+#include "OrderPool.h"
+#include "OrderIndex.h"
+#include "OwnerIndex.h"
+#include "PriceLadder.h"
+
+class MarketDataChannel;
+class RiskFeed;
+
+// 一个价位的聚合深度
+struct DepthLevel
+{
+    double price;
+    int64_t quantity;
+    uint32_t count;
+};
+
+struct MassCancelFilter
+{
+    static constexpr uint8_t BOTH_SIDES = 2;
+
+    MassCancelScope scope;
+    uint8_t side;     // OrderSide 的取值，或 BOTH_SIDES
+    UserId user_id;   // USER 范围
+    uint64_t session; // SESSION 范围：连接 ID
+};
+
+// 改单附带的检查：user 非空时须为订单所属用户；limited 时（事前风控）名义金额的增加量
+// 不得超过 budget，旧格式改单（user 为空）不能增加名义金额。减少名义金额的改单不受额度限制
+struct ReplaceCheck
+{
+    UserId user;
+    bool limited = false;
+    double budget = 0.0;
+};
+
+// 订单记录池、订单索引与挂单归属索引。同一撮合分片内的所有订单簿共享一份，
+// 因此 order_id 在分片内唯一
+struct OrderStore
+{
+    explicit OrderStore(uint32_t capacity) : pool(capacity), index(pool, capacity), owners(pool, capacity) {}
+
+    OrderPool pool;
+    OrderIndex index;
+    OwnerIndex owners;
+};
+
+// 撮合接口按回报接收者（Sink）的类型模板化：Sink 是任何可以按 void(const ExecutionReport &)
+// 调用的对象，以引用传入，回报在编译期内联到调用方，没有 std::function 的类型擦除、
+// 间接调用和按值拷贝（捕获超过两个指针时每次拷贝都要分配）。
+// 模板部分只负责产生回报，订单簿状态的修改都在 OrderBook.cpp 的非模板函数里
 class OrderBook
 {
 public:
-    using MatchCallback = std::function<void(const ExecutionReport &)>;
-    OrderBook();
+    static constexpr uint32_t DEFAULT_POOL_CAPACITY = 1u << 20;
+
+    // 独占一份订单存储
+    explicit OrderBook(const InstrumentSpec &spec = InstrumentSpec{},
+                       uint32_t poolCapacity = DEFAULT_POOL_CAPACITY);
+    // 使用外部（分片共享的）订单存储
+    OrderBook(const InstrumentSpec &spec, OrderStore &store);
     ~OrderBook() = default;
 
-    bool matchOrder(Order order, MatchCallback callback);
-    bool cancelOrder(const std::string &order_id, MatchCallback callback);
+    // owner: 下单会话（连接 ID），挂单时记入会话索引，供按会话批量撤单
+    template <typename Sink>
+    bool matchOrder(Order order, Sink &&sink, uint64_t owner = 0);
+    template <typename Sink>
+    bool cancelOrder(const OrderId &order_id, Sink &&sink);
+    // 批量撤单：沿用户 / 会话挂单链表撤销符合条件的订单，每笔回报一条 CANCELED，返回撤销笔数。
+    // 代价与被撤订单数成正比，与订单簿总挂单数无关
+    template <typename Sink>
+    uint32_t massCancel(const MassCancelFilter &filter, Sink &&sink);
+    // 改单：把挂单改为 price / quantity（新的剩余数量），回报一条 REPLACED（或 REJECTED）。
+    // 同价减量原地修改、保留时间优先；其余情况把订单移到新价位队尾，
+    // 新价格与对手方交叉时先按主动单撮合，剩余部分再挂出。执行前先做 check 中的检查
+    template <typename Sink>
+    bool replaceOrder(const OrderId &order_id, double price, int32_t quantity, Sink &&sink,
+                      const ReplaceCheck &check = ReplaceCheck{});
     double getLastTradedPrice()
     {
-        return lastTradedPrice;
+        return lastTradedTicks == PriceLadder::NONE ? 0.0 : spec_.toPrice(lastTradedTicks);
+    }
+    const InstrumentSpec &spec() const { return spec_; }
+
+    // 深度查询：side 一侧从最优价向外至多 maxLevels 个价位的聚合，返回写入 out 的个数。
+    // 只读价位上增量维护的聚合，不遍历订单，代价与档位数成正比
+    size_t depth(OrderSide side, DepthLevel *out, size_t maxLevels) const;
+    OrderPoolStats poolStats() const { return pool_.stats(); }
+
+    // 快照：按买方（最优价向外）、卖方（最优价向外）、档位内 FIFO 的顺序遍历全部挂单。
+    // 不分配内存，可在 fork 出的子进程中调用
+    template <typename Fn>
+    void forEachRestingOrder(Fn &&fn) const
+    {
+        for (Ticks t = ladder_.bestBid(); t != PriceLadder::NONE; t = ladder_.nextOccupiedBelow(t))
+            forEachInLevel(t, fn);
+        for (Ticks t = ladder_.bestAsk(); t != PriceLadder::NONE; t = ladder_.nextOccupiedAbove(t))
+            forEachInLevel(t, fn);
+    }
+    Ticks lastTradeTicks() const { return lastTradedTicks; }
+
+    // 订单簿变化（价位聚合与成交）写入 channel，由行情发布线程消费；nullptr 关闭
+    void setMarketData(MarketDataChannel *channel, uint32_t symbolId)
+    {
+        marketData_ = channel;
+        symbolId_ = symbolId;
     }
 
+    // 事前风控：挂单成交、撤销、改单与主动单撮合结束引起的用户未结订单变化写入 feed，
+    // 成交价写入该品种的参考价；nullptr 关闭。日志重放之后再设置，重放不产生回馈
+    void setRiskFeed(RiskFeed *feed, uint32_t symbolId);
+
+    // 从快照恢复：按 forEachRestingOrder 的顺序逐条追加即可还原档位内的 FIFO 次序
+    bool restoreOrder(const Order &order, Ticks ticks, uint64_t owner = 0);
+    void restoreLastTraded(Ticks ticks) { lastTradedTicks = ticks; }
+
 private:
-    template <typename BookType, typename TradePredicate>
-    void matchAgainstBook(Order &order, BookType &book, TradePredicate canTrade, MatchCallback &callback);
-    void generateReport(
-        const Order &order,
-        int32_t last_shares,
-        ExecType type,
-        MatchCallback &callback);
-    double lastTradedPrice = 0.0;
-    std::map<double, std::list<Order>, std::greater<double>> buyBook;
-    std::map<double, std::list<Order>, std::less<double>> sellBook;
-
-    struct OrderHandle
-    {
-        double price;
-        std::list<Order>::iterator iter;
-        OrderSide side;
+    template <typename Fn>
+    void forEachInLevel(Ticks ticks, Fn &fn) const
+    {
+        for (OrderRef ref = ladder_.level(ticks).head; ref != NULL_ORDER; ref = pool_[ref].next)
+            fn(pool_[ref]);
+    }
+
+    // 主动单与 best 价位队首的一次成交
+    struct Fill
+    {
+        int32_t quantity;
+        bool restingDone;  // 队首挂单已全部成交并移除
+        bool levelEmptied; // 该价位随之清空
     };
-    std::unordered_map<std::string, OrderHandle> orderIndex;
-};
\ No newline at end of file
+
+    // matchOrder 的主体；订单有剩余挂出时 resting 为挂出的数量
+    template <typename Sink>
+    bool placeOrder(Order &order, Sink &sink, uint64_t owner, int32_t &resting);
+    template <typename Sink>
+    void matchAgainstBook(Order &order, Ticks limit, Sink &sink);
+    template <typename Sink>
+    bool restOrder(const Order &order, Ticks ticks, uint64_t owner, Sink &sink, ExecType ackType = ExecType::NEW);
+    // 撤销挂单并回报 CANCELED
+    template <typename Sink>
+    void removeOrder(OrderRef ref, Sink &sink);
+    // IOC / FOK / 市价单未成交的部分：撤销并回报 CANCELED
+    template <typename Sink>
+    void expireOrder(const Order &order, Sink &sink);
+    template <typename Sink>
+    void generateReport(const Order &order, int32_t last_shares, ExecType type, Sink &sink)
+    {
+        sink(ExecutionReport{order.order_id, getLastTradedPrice(), last_shares,
+                             type == ExecType::CANCELED ? 0 : order.remaining_quantity, type});
+    }
+    template <typename Sink>
+    static void rejectOrder(const Order &order, Sink &sink)
+    {
+        sink(ExecutionReport{order.order_id, order.price, 0, 0, ExecType::REJECTED});
+    }
+
+    // 以下为非模板部分：修改订单簿状态、记录事件日志
+    // 新单的限价档位（市价单取阶梯上离对手方最远的一档）
+    Ticks limitTicks(const Order &order) const;
+    // 价格不在网格上或订单号重复时记录事件并返回 false
+    bool admitNew(const Order &order, Ticks ticks) const;
+    Ticks bestOpposite(OrderSide side) const
+    {
+        return side == OrderSide::BUY ? ladder_.bestAsk() : ladder_.bestBid();
+    }
+    Fill fillFront(Order &order, Ticks best);
+    // 分配记录并挂到价位队尾、加入索引；订单池耗尽时记录事件并返回 NULL_ORDER
+    OrderRef insertResting(const Order &order, Ticks ticks, uint64_t owner);
+    // 从索引、价位队列中摘除挂单并回收记录，返回其订单号
+    OrderId eraseResting(OrderRef ref);
+    // 对手方在 limit 以内（含）的可成交量是否达到 quantity：逐档累加聚合数量，不触及单个订单
+    bool canFill(OrderSide side, Ticks limit, int32_t quantity) const;
+    void logExpired(const Order &order) const;
+    // 撤单：找不到订单时记录事件并返回 NULL_ORDER
+    OrderRef findForCancel(const OrderId &order_id) const;
+    // 改单检查：不通过时记录事件，leaves 为原订单仍挂着的数量（订单不存在时为 0）
+    bool admitReplace(const OrderId &order_id, OrderRef ref, Ticks ticks, double price, int32_t quantity,
+                      const ReplaceCheck &check, int32_t &leaves) const;
+    // 执行改单：同价减量原地修改，不交叉时移到新价位队尾，均返回 false；与对手方交叉时
+    // 摘除原挂单、在 aggressor / owner 中给出重新撮合所需的订单与会话并返回 true
+    bool amendResting(OrderRef ref, Ticks ticks, double price, int32_t quantity, Order &aggressor, uint64_t &owner);
+    void linkBack(PriceLevel &level, OrderRef ref);
+    void unlink(PriceLevel &level, OrderRef ref);
+    void publishLevel(OrderSide side, Ticks ticks, const PriceLevel &level);
+    void publishTrade(OrderSide aggressor, Ticks ticks, int32_t quantity);
+    // 风控回馈（未设置 feed 时不做任何事）。风控放行新单时已按 quantity × price 计入一笔未结订单，
+    // 主动单撮合结束后释放其中没有挂出的部分，挂出的部分随之后的成交 / 撤单释放
+    void adjustRisk(const UserId &user, int32_t orders, double notional);
+    void settleAggressor(const Order &order, int32_t resting);
+
+    InstrumentSpec spec_;
+    Ticks lastTradedTicks = PriceLadder::NONE;
+    std::unique_ptr<OrderStore> ownedStore_;
+    OrderPool &pool_;
+    OrderIndex &orderIndex;
+    OwnerIndex &owners_;
+    uint32_t ownerBook_; // 本订单簿在 owners_ 中的编号
+    PriceLadder ladder_;
+    MarketDataChannel *marketData_ = nullptr;
+    uint32_t symbolId_ = 0;
+    RiskFeed *risk_ = nullptr;
+    std::atomic<double> *lastPrice_ = nullptr; // 风控参考价
+};
+
+template <typename Sink>
+bool OrderBook::matchOrder(Order order, Sink &&sink, uint64_t owner)
+{
+    int32_t resting = 0;
+    bool accepted = placeOrder(order, sink, owner, resting);
+    if (risk_)
+        settleAggressor(order, resting);
+    return accepted;
+}
+
+template <typename Sink>
+bool OrderBook::placeOrder(Order &order, Sink &sink, uint64_t owner, int32_t &resting)
+{
+    Ticks ticks = limitTicks(order);
+    if (!admitNew(order, ticks))
+    {
+        rejectOrder(order, sink);
+        return false;
+    }
+    // FOK 先按价位聚合判断能否全部成交，不能则整单撤销，订单簿不发生任何变化
+    if (order.type == OrderType::FOK && !canFill(order.side, ticks, order.remaining_quantity))
+    {
+        expireOrder(order, sink);
+        return true;
+    }
+
+    matchAgainstBook(order, ticks, sink);
+    if (order.remaining_quantity > 0)
+    {
+        if (order.type != OrderType::LIMIT)
+        {
+            expireOrder(order, sink);
+            return true;
+        }
+        if (!restOrder(order, ticks, owner, sink))
+            return false;
+        resting = order.remaining_quantity;
+    }
+    return true;
+}
+
+template <typename Sink>
+void OrderBook::matchAgainstBook(Order &order, Ticks limit, Sink &sink)
+{
+    const bool buy = order.side == OrderSide::BUY;
+    Ticks best = bestOpposite(order.side);
+    Ticks touched = PriceLadder::NONE; // 已成交但仍有挂单的价位，离开时发布一次聚合
+    while (order.remaining_quantity > 0 && best != PriceLadder::NONE && (buy ? limit >= best : limit <= best))
+    {
+        Fill fill = fillFront(order, best);
+        generateReport(order, fill.quantity, fill.restingDone ? ExecType::FILL : ExecType::PARTIAL_FILL, sink);
+        if (!fill.restingDone)
+        {
+            touched = best;
+            break;
+        }
+        if (fill.levelEmptied)
+        {
+            touched = PriceLadder::NONE;
+            best = bestOpposite(order.side);
+        }
+        else
+        {
+            touched = best;
+        }
+    }
+    if (touched != PriceLadder::NONE)
+    {
+        publishLevel(buy ? OrderSide::SELL : OrderSide::BUY, touched, ladder_.level(touched));
+    }
+    int32_t filled = order.quantity - order.remaining_quantity;
+    if (filled > 0)
+    {
+        generateReport(order, filled, order.remaining_quantity == 0 ? ExecType::FILL : ExecType::PARTIAL_FILL, sink);
+    }
+}
+
+template <typename Sink>
+bool OrderBook::restOrder(const Order &order, Ticks ticks, uint64_t owner, Sink &sink, ExecType ackType)
+{
+    if (insertResting(order, ticks, owner) == NULL_ORDER)
+    {
+        rejectOrder(order, sink);
+        return false;
+    }
+    generateReport(order, 0, order.quantity == order.remaining_quantity ? ackType : ExecType::PARTIAL_FILL,
+                   sink); // 未成交的单
+    return true;
+}
+
+template <typename Sink>
+void OrderBook::expireOrder(const Order &order, Sink &sink)
+{
+    sink(ExecutionReport{order.order_id, 0.0, 0, 0, ExecType::CANCELED});
+    logExpired(order);
+}
+
+template <typename Sink>
+bool OrderBook::cancelOrder(const OrderId &order_id, Sink &&sink)
+{
+    OrderRef ref = findForCancel(order_id);
+    if (ref == NULL_ORDER)
+        return false;
+    removeOrder(ref, sink);
+    return true;
+}
+
+template <typename Sink>
+void OrderBook::removeOrder(OrderRef ref, Sink &sink)
+{
+    sink(ExecutionReport{eraseResting(ref), 0.0, 0, 0, ExecType::CANCELED});
+}
+
+template <typename Sink>
+uint32_t OrderBook::massCancel(const MassCancelFilter &filter, Sink &&sink)
+{
+    uint32_t canceled = 0;
+    auto cancelMatching = [this, &filter, &sink, &canceled](OrderRef ref)
+    {
+        if (filter.side != MassCancelFilter::BOTH_SIDES && static_cast<uint8_t>(pool_[ref].side) != filter.side)
+            return;
+        removeOrder(ref, sink);
+        ++canceled;
+    };
+    if (filter.scope == MassCancelScope::USER)
+        owners_.forEachOfUser(ownerBook_, filter.user_id, cancelMatching);
+    else
+        owners_.forEachOfSession(ownerBook_, filter.session, cancelMatching);
+    return canceled;
+}
+
+template <typename Sink>
+bool OrderBook::replaceOrder(const OrderId &order_id, double price, int32_t quantity, Sink &&sink,
+                             const ReplaceCheck &check)
+{
+    OrderRef ref = orderIndex.find(order_id);
+    Ticks ticks = spec_.toTicks(price);
+    int32_t leaves = 0;
+    if (!admitReplace(order_id, ref, ticks, price, quantity, check, leaves))
+    {
+        sink(ExecutionReport{order_id, price, 0, leaves, ExecType::REJECTED});
+        return false;
+    }
+
+    Order order;
+    uint64_t owner = 0;
+    if (amendResting(ref, ticks, price, quantity, order, owner))
+    {
+        // 与对手方交叉：按新价格重新作为主动单撮合，订单号沿用，剩余部分挂出时回报 REPLACED
+        matchAgainstBook(order, ticks, sink);
+        int32_t resting = 0;
+        bool rested = true;
+        if (order.remaining_quantity > 0)
+        {
+            rested = restOrder(order, ticks, owner, sink, ExecType::REPLACED);
+            resting = rested ? order.remaining_quantity : 0;
+        }
+        if (risk_)
+            settleAggressor(order, resting);
+        return rested;
+    }
+    sink(ExecutionReport{order_id, price, 0, quantity, ExecType::REPLACED});
+    return true;
+}
@@ -0,0 +1,118 @@
+#include "OrderIndex.h"
+#include <cstring>
+#include <utility>
+
+namespace
+{
+uint64_t nextPowerOfTwo(uint64_t v)
+{
+    uint64_t p = 1;
+    while (p < v)
+        p <<= 1;
+    return p;
+}
+} // namespace
+
+OrderIndex::OrderIndex(const OrderPool &pool, uint32_t maxOrders)
+    : pool_(pool)
+{
+    uint64_t capacity = nextPowerOfTwo(static_cast<uint64_t>(maxOrders) * 2);
+    if (capacity < 16)
+        capacity = 16;
+    slots_.assign(capacity, Slot{NULL_ORDER, 0, 0});
+    mask_ = capacity - 1;
+}
+
+uint64_t OrderIndex::hash(const OrderId &id)
+{
+    uint64_t h = 0x243F6A8885A308D3ULL;
+    for (size_t i = 0; i < sizeof(id.data); i += 8)
+    {
+        uint64_t w;
+        std::memcpy(&w, id.data + i, 8);
+        h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 32;
+    }
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+OrderRef OrderIndex::find(const OrderId &id) const
+{
+    uint64_t h = hash(id);
+    uint16_t tag = static_cast<uint16_t>(h >> 48);
+    uint64_t pos = h & mask_;
+    for (uint16_t dist = 1;; ++dist, pos = (pos + 1) & mask_)
+    {
+        const Slot &slot = slots_[pos];
+        // Robin Hood 不变式：遇到空槽或比当前探测距离更"富"的槽即可停止
+        if (slot.dist < dist)
+            return NULL_ORDER;
+        if (slot.tag == tag && pool_[slot.ref].order_id == id)
+            return slot.ref;
+    }
+}
+
+bool OrderIndex::insert(OrderRef ref)
+{
+    const OrderId &id = pool_[ref].order_id;
+    uint64_t h = hash(id);
+    Slot incoming{ref, 1, static_cast<uint16_t>(h >> 48)};
+    uint64_t pos = h & mask_;
+    bool checking = true; // 换位之前需要检查重复键
+
+    while (true)
+    {
+        Slot &slot = slots_[pos];
+        if (slot.dist == 0)
+        {
+            slot = incoming;
+            ++size_;
+            return true;
+        }
+        if (checking && slot.dist == incoming.dist && slot.tag == incoming.tag &&
+            pool_[slot.ref].order_id == id)
+        {
+            return false;
+        }
+        if (slot.dist < incoming.dist)
+        {
+            // 劫富济贫：占用探测距离更短的槽，继续为被换出的元素找位置。
+            // 按 Robin Hood 不变式，重复键不可能出现在这之后
+            checking = false;
+            std::swap(slot, incoming);
+        }
+        ++incoming.dist;
+        pos = (pos + 1) & mask_;
+    }
+}
+
+bool OrderIndex::erase(const OrderId &id)
+{
+    uint64_t h = hash(id);
+    uint16_t tag = static_cast<uint16_t>(h >> 48);
+    uint64_t pos = h & mask_;
+    for (uint16_t dist = 1;; ++dist, pos = (pos + 1) & mask_)
+    {
+        Slot &slot = slots_[pos];
+        if (slot.dist < dist)
+            return false;
+        if (slot.tag == tag && pool_[slot.ref].order_id == id)
+            break;
+    }
+
+    // 回移删除：把后续探测链整体前移一格，无需墓碑
+    uint64_t next = (pos + 1) & mask_;
+    while (slots_[next].dist > 1)
+    {
+        slots_[pos] = slots_[next];
+        --slots_[pos].dist;
+        pos = next;
+        next = (next + 1) & mask_;
+    }
+    slots_[pos] = Slot{NULL_ORDER, 0, 0};
+    --size_;
+    return true;
+}
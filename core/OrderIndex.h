@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "FixedString.h"
+#include "OrderPool.h"
+
+// order_id -> OrderRef 的开放寻址哈希表（Robin Hood 探测 + 删除时回移）。
+// 槽位只保存订单记录下标、探测距离和哈希标签（8 字节），键本身存放在
+// 订单池的记录中，标签命中后才去比较完整的 order_id。
+// 容量在构造时按订单池大小一次性分配（装载因子 <= 1/2），之后不再分配内存。
+class OrderIndex
+{
+public:
+    OrderIndex(const OrderPool &pool, uint32_t maxOrders);
+
+    // 未找到返回 NULL_ORDER
+    OrderRef find(const OrderId &id) const;
+    // 键已存在时返回 false
+    bool insert(OrderRef ref);
+    // 键不存在时返回 false
+    bool erase(const OrderId &id);
+
+    uint32_t size() const { return size_; }
+
+    static uint64_t hash(const OrderId &id);
+
+private:
+    struct Slot
+    {
+        OrderRef ref;
+        uint16_t dist; // 探测距离 + 1，0 表示空槽
+        uint16_t tag;  // 哈希高 16 位
+    };
+
+    const OrderPool &pool_;
+    std::vector<Slot> slots_;
+    uint64_t mask_;
+    uint32_t size_ = 0;
+};
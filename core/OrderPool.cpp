@@ -0,0 +1,37 @@
+#include "OrderPool.h"
+
+OrderPool::OrderPool(uint32_t capacity) : nodes_(capacity)
+{
+}
+
+OrderRef OrderPool::allocate()
+{
+    OrderRef ref;
+    if (freeHead_ != NULL_ORDER)
+    {
+        ref = freeHead_;
+        freeHead_ = nodes_[ref].next;
+    }
+    else if (nextFresh_ < nodes_.size())
+    {
+        ref = nextFresh_++;
+    }
+    else
+    {
+        ++allocFailures_;
+        return NULL_ORDER;
+    }
+
+    if (++inUse_ > highWater_)
+    {
+        highWater_ = inUse_;
+    }
+    return ref;
+}
+
+void OrderPool::release(OrderRef ref)
+{
+    nodes_[ref].next = freeHead_;
+    freeHead_ = ref;
+    --inUse_;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Order.h"
+#include "FixedString.h"
+#include "Instrument.h"
+
+// 池内订单引用（下标），比指针更紧凑
+using OrderRef = uint32_t;
+constexpr OrderRef NULL_ORDER = UINT32_MAX;
+
+// 挂单记录：定长、按缓存行对齐，侵入式地链接到所在价位的 FIFO 中。
+// 撮合时频繁访问的字段放在第一个缓存行。
+struct alignas(64) OrderNode
+{
+    OrderRef prev;              // 同价位前一个订单
+    OrderRef next;              // 同价位后一个订单（空闲时作为空闲链表指针）
+    Ticks ticks;                // 价位
+    int32_t quantity;
+    int32_t remaining_quantity;
+    uint64_t timestamp;
+    OrderSide side;
+    UserId user_id;
+    OrderId order_id;
+    // 以下只在批量撤单和订单增删时访问，放在第二个缓存行
+    uint64_t owner;             // 下单连接（会话）ID，快照旧格式恢复的订单为 0
+    OrderRef userPrev;          // 同一用户的挂单链表
+    OrderRef userNext;
+    OrderRef sessionPrev;       // 同一会话的挂单链表
+    OrderRef sessionNext;
+};
+static_assert(sizeof(OrderNode) == 128, "OrderNode should stay within two cache lines");
+
+struct OrderPoolStats
+{
+    uint32_t capacity;
+    uint32_t in_use;
+    uint32_t high_water;
+    uint64_t alloc_failures;
+};
+
+// 预分配的订单记录池：所有记录在构造时一次性分配，成交/撤单后回收复用，
+// 稳态撮合不产生堆分配
+class OrderPool
+{
+public:
+    explicit OrderPool(uint32_t capacity);
+
+    // 池耗尽时返回 NULL_ORDER
+    OrderRef allocate();
+    void release(OrderRef ref);
+
+    OrderNode &operator[](OrderRef ref) { return nodes_[ref]; }
+    const OrderNode &operator[](OrderRef ref) const { return nodes_[ref]; }
+
+    OrderPoolStats stats() const
+    {
+        return {static_cast<uint32_t>(nodes_.size()), inUse_, highWater_, allocFailures_};
+    }
+
+private:
+    std::vector<OrderNode> nodes_;
+    OrderRef freeHead_ = NULL_ORDER; // 回收记录组成的 LIFO 空闲链表（复用最近释放的热记录）
+    uint32_t nextFresh_ = 0;         // 从未使用过的记录起点
+    uint32_t inUse_ = 0;
+    uint32_t highWater_ = 0;
+    uint64_t allocFailures_ = 0;
+};
@@ -0,0 +1,70 @@
+#include "OwnerIndex.h"
+#include <cstring>
+
+uint64_t OwnerIndex::UserField::hash(const UserId &id)
+{
+    uint64_t lo, hi;
+    std::memcpy(&lo, id.data, 8);
+    std::memcpy(&hi, id.data + 8, 8);
+    uint64_t h = (lo ^ 0x243F6A8885A308D3ULL) * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 32) ^ hi) * 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 29);
+}
+
+void OwnerIndex::insert(uint32_t book, OrderRef ref)
+{
+    OrderNode &node = pool_[ref];
+    // 新订单放在链表头：插入 O(1)，批量撤单不关心先后
+    node.userPrev = NULL_ORDER;
+    node.userNext = NULL_ORDER;
+    if (OrderRef *userHead = users_.find(book, node.user_id))
+    {
+        node.userNext = *userHead;
+        pool_[*userHead].userPrev = ref;
+        *userHead = ref;
+    }
+    else
+    {
+        users_.insert(book, ref);
+    }
+
+    node.sessionPrev = NULL_ORDER;
+    node.sessionNext = NULL_ORDER;
+    if (node.owner == 0)
+        return;
+    if (OrderRef *sessionHead = sessions_.find(book, node.owner))
+    {
+        node.sessionNext = *sessionHead;
+        pool_[*sessionHead].sessionPrev = ref;
+        *sessionHead = ref;
+    }
+    else
+    {
+        sessions_.insert(book, ref);
+    }
+}
+
+void OwnerIndex::erase(uint32_t book, OrderRef ref)
+{
+    // 删除链表头时表里的键取自该记录，须在改写记录之前更新或删除条目
+    OrderNode &node = pool_[ref];
+    if (node.userNext != NULL_ORDER)
+        pool_[node.userNext].userPrev = node.userPrev;
+    if (node.userPrev != NULL_ORDER)
+        pool_[node.userPrev].userNext = node.userNext;
+    else if (node.userNext != NULL_ORDER)
+        *users_.find(book, node.user_id) = node.userNext;
+    else
+        users_.erase(book, node.user_id);
+
+    if (node.owner == 0)
+        return;
+    if (node.sessionNext != NULL_ORDER)
+        pool_[node.sessionNext].sessionPrev = node.sessionPrev;
+    if (node.sessionPrev != NULL_ORDER)
+        pool_[node.sessionPrev].sessionNext = node.sessionNext;
+    else if (node.sessionNext != NULL_ORDER)
+        *sessions_.find(book, node.owner) = node.sessionNext;
+    else
+        sessions_.erase(book, node.owner);
+}
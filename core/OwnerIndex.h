@@ -0,0 +1,166 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "FixedString.h"
+#include "OrderPool.h"
+
+// (订单簿, 键) -> 链表头的开放寻址哈希表（Robin Hood 探测 + 删除时回移，与 OrderIndex 相同）。
+// 键本身不存放，取自链表头订单记录中的字段（Field::of）；链表清空即删除条目。
+// 每个非空链表至少有一笔挂单，条目数不超过订单池容量：容量在构造时按订单池大小一次性分配
+// （装载因子 <= 1/2），之后不再分配内存
+template <typename Field>
+class OwnerHeads
+{
+public:
+    using Key = typename Field::Key;
+
+    OwnerHeads(const OrderPool &pool, uint32_t maxOrders) : pool_(pool)
+    {
+        uint64_t capacity = 16;
+        while (capacity < static_cast<uint64_t>(maxOrders) * 2)
+            capacity <<= 1;
+        slots_.assign(capacity, Slot{NULL_ORDER, 0, 0, 0});
+        mask_ = capacity - 1;
+    }
+
+    // 返回链表头所在槽位，未找到返回 nullptr；插入、删除其他条目后失效
+    OrderRef *find(uint32_t book, const Key &key)
+    {
+        Slot *slot = lookup(book, key);
+        return slot != nullptr ? &slot->ref : nullptr;
+    }
+
+    // ref 成为新链表的头，调用方保证该键尚不存在
+    void insert(uint32_t book, OrderRef ref)
+    {
+        uint64_t h = hash(book, Field::of(pool_[ref]));
+        Slot incoming{ref, book, 1, static_cast<uint16_t>(h >> 48)};
+        for (uint64_t pos = h & mask_;; ++incoming.dist, pos = (pos + 1) & mask_)
+        {
+            Slot &slot = slots_[pos];
+            if (slot.dist == 0)
+            {
+                slot = incoming;
+                return;
+            }
+            if (slot.dist < incoming.dist)
+                std::swap(slot, incoming);
+        }
+    }
+
+    // 删除条目：把后续探测链整体前移一格，无需墓碑。调用时链表头记录须仍带着该键
+    void erase(uint32_t book, const Key &key)
+    {
+        Slot *slot = lookup(book, key);
+        if (slot == nullptr)
+            return;
+        uint64_t pos = static_cast<uint64_t>(slot - slots_.data());
+        uint64_t next = (pos + 1) & mask_;
+        while (slots_[next].dist > 1)
+        {
+            slots_[pos] = slots_[next];
+            --slots_[pos].dist;
+            pos = next;
+            next = (next + 1) & mask_;
+        }
+        slots_[pos] = Slot{NULL_ORDER, 0, 0, 0};
+    }
+
+private:
+    struct Slot
+    {
+        OrderRef ref;  // 链表头
+        uint32_t book; // 所属订单簿
+        uint16_t dist; // 探测距离 + 1，0 表示空槽
+        uint16_t tag;  // 哈希高 16 位
+    };
+
+    static uint64_t hash(uint32_t book, const Key &key)
+    {
+        uint64_t h = (Field::hash(key) ^ book) * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 32);
+    }
+
+    Slot *lookup(uint32_t book, const Key &key)
+    {
+        uint64_t h = hash(book, key);
+        uint16_t tag = static_cast<uint16_t>(h >> 48);
+        uint64_t pos = h & mask_;
+        for (uint16_t dist = 1;; ++dist, pos = (pos + 1) & mask_)
+        {
+            Slot &slot = slots_[pos];
+            // Robin Hood 不变式：遇到空槽或比当前探测距离更"富"的槽即可停止
+            if (slot.dist < dist)
+                return nullptr;
+            if (slot.tag == tag && slot.book == book && Field::of(pool_[slot.ref]) == key)
+                return &slot;
+        }
+    }
+
+    const OrderPool &pool_;
+    std::vector<Slot> slots_;
+    uint64_t mask_;
+};
+
+// 按用户、按会话分组的挂单索引，供批量撤单使用，同一分片的订单簿共用（随 OrderStore）。
+// 订单记录通过 OrderNode 中的两组链接侵入式地挂在所属用户、所属会话的双向链表上，
+// 表里只存链表头，按 (订单簿, 用户 / 会话) 区分；批量撤单只遍历目标订单，不扫描订单索引。
+// 链表清空即删除条目，增删都不分配内存
+class OwnerIndex
+{
+public:
+    OwnerIndex(OrderPool &pool, uint32_t maxOrders) : pool_(pool), users_(pool, maxOrders), sessions_(pool, maxOrders) {}
+
+    // 为新订单簿分配编号，作为它在表中的键
+    uint32_t addBook() { return books_++; }
+
+    // 记录中的 user_id / owner 须已填好；owner 为 0 的订单不加入会话链表
+    void insert(uint32_t book, OrderRef ref);
+    void erase(uint32_t book, OrderRef ref);
+
+    // 逐个访问用户 / 会话的挂单，fn 可以删除当前订单（先取后继再回调）
+    template <typename Fn>
+    void forEachOfUser(uint32_t book, const UserId &user, Fn &&fn)
+    {
+        const OrderRef *head = users_.find(book, user);
+        for (OrderRef ref = head != nullptr ? *head : NULL_ORDER; ref != NULL_ORDER;)
+        {
+            OrderRef next = pool_[ref].userNext;
+            fn(ref);
+            ref = next;
+        }
+    }
+
+    template <typename Fn>
+    void forEachOfSession(uint32_t book, uint64_t session, Fn &&fn)
+    {
+        const OrderRef *head = sessions_.find(book, session);
+        for (OrderRef ref = head != nullptr ? *head : NULL_ORDER; ref != NULL_ORDER;)
+        {
+            OrderRef next = pool_[ref].sessionNext;
+            fn(ref);
+            ref = next;
+        }
+    }
+
+private:
+    struct UserField
+    {
+        using Key = UserId;
+        static const UserId &of(const OrderNode &node) { return node.user_id; }
+        static uint64_t hash(const UserId &id);
+    };
+
+    struct SessionField
+    {
+        using Key = uint64_t;
+        static uint64_t of(const OrderNode &node) { return node.owner; }
+        static uint64_t hash(uint64_t session) { return session * 0xBF58476D1CE4E5B9ULL; }
+    };
+
+    OrderPool &pool_;
+    OwnerHeads<UserField> users_;       // 用户 -> 链表头
+    OwnerHeads<SessionField> sessions_; // 会话 -> 链表头
+    uint32_t books_ = 0;
+};
@@ -0,0 +1,113 @@
+#include "PriceLadder.h"
+
+LevelBitmap::LevelBitmap(size_t numBits)
+    : bits_((numBits + 63) / 64, 0),
+      summary_((bits_.size() + 63) / 64, 0)
+{
+}
+
+void LevelBitmap::set(Ticks pos)
+{
+    size_t word = static_cast<size_t>(pos) >> 6;
+    bits_[word] |= 1ULL << (pos & 63);
+    summary_[word >> 6] |= 1ULL << (word & 63);
+}
+
+void LevelBitmap::clear(Ticks pos)
+{
+    size_t word = static_cast<size_t>(pos) >> 6;
+    bits_[word] &= ~(1ULL << (pos & 63));
+    if (bits_[word] == 0)
+    {
+        summary_[word >> 6] &= ~(1ULL << (word & 63));
+    }
+}
+
+Ticks LevelBitmap::nextAbove(Ticks pos) const
+{
+    size_t start = static_cast<size_t>(pos + 1);
+    size_t word = start >> 6;
+    if (word >= bits_.size())
+        return -1;
+
+    // 1. 当前字内
+    uint64_t w = (start & 63) ? bits_[word] & (~0ULL << (start & 63)) : bits_[word];
+    if (w)
+        return static_cast<Ticks>((word << 6) + __builtin_ctzll(w));
+
+    // 2. 借助 summary 跳到下一个非空字
+    size_t next = word + 1;
+    size_t s = next >> 6;
+    if (s >= summary_.size())
+        return -1;
+    uint64_t sw = (next & 63) ? summary_[s] & (~0ULL << (next & 63)) : summary_[s];
+    while (!sw)
+    {
+        if (++s >= summary_.size())
+            return -1;
+        sw = summary_[s];
+    }
+    size_t found = (s << 6) + __builtin_ctzll(sw);
+    return static_cast<Ticks>((found << 6) + __builtin_ctzll(bits_[found]));
+}
+
+Ticks LevelBitmap::prevBelow(Ticks pos) const
+{
+    if (pos <= 0)
+        return -1;
+    size_t start = static_cast<size_t>(pos - 1);
+    size_t word = start >> 6;
+
+    uint64_t mask = ((start & 63) == 63) ? ~0ULL : ((1ULL << ((start & 63) + 1)) - 1);
+    uint64_t w = bits_[word] & mask;
+    if (w)
+        return static_cast<Ticks>((word << 6) + 63 - __builtin_clzll(w));
+
+    if (word == 0)
+        return -1;
+    size_t prev = word - 1;
+    size_t s = prev >> 6;
+    uint64_t smask = ((prev & 63) == 63) ? ~0ULL : ((1ULL << ((prev & 63) + 1)) - 1);
+    uint64_t sw = summary_[s] & smask;
+    while (!sw)
+    {
+        if (s == 0)
+            return -1;
+        sw = summary_[--s];
+    }
+    size_t found = (s << 6) + 63 - __builtin_clzll(sw);
+    return static_cast<Ticks>((found << 6) + 63 - __builtin_clzll(bits_[found]));
+}
+
+PriceLadder::PriceLadder(uint32_t numLevels)
+    : levels_(numLevels), occupied_(numLevels)
+{
+}
+
+void PriceLadder::markOccupied(Ticks ticks, OrderSide side)
+{
+    occupied_.set(ticks);
+    if (side == OrderSide::BUY)
+    {
+        if (bestBid_ == NONE || ticks > bestBid_)
+            bestBid_ = ticks;
+    }
+    else
+    {
+        if (bestAsk_ == NONE || ticks < bestAsk_)
+            bestAsk_ = ticks;
+    }
+}
+
+void PriceLadder::markEmpty(Ticks ticks)
+{
+    occupied_.clear(ticks);
+    if (ticks == bestBid_)
+    {
+        bestBid_ = occupied_.prevBelow(ticks);
+    }
+    else if (ticks == bestAsk_)
+    {
+        bestAsk_ = occupied_.nextAbove(ticks);
+    }
+}
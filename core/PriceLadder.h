@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Order.h"
+#include "Instrument.h"
+#include "OrderPool.h"
+
+// 同价位 FIFO：订单记录通过 OrderNode::prev/next 侵入式链接
+struct PriceLevel
+{
+    OrderRef head = NULL_ORDER;
+    OrderRef tail = NULL_ORDER;
+    int64_t quantity = 0; // 价位上全部挂单的剩余数量之和
+    uint32_t count = 0;   // 价位上的挂单数
+
+    bool empty() const { return head == NULL_ORDER; }
+};
+
+// 两级占用位图：bits_ 每位对应一个档位，summary_ 每位对应 bits_ 中一个非空字
+class LevelBitmap
+{
+public:
+    explicit LevelBitmap(size_t numBits);
+
+    void set(Ticks pos);
+    void clear(Ticks pos);
+    // 严格大于 pos 的第一个置位，没有返回 -1
+    Ticks nextAbove(Ticks pos) const;
+    // 严格小于 pos 的第一个置位，没有返回 -1
+    Ticks prevBelow(Ticks pos) const;
+
+private:
+    std::vector<uint64_t> bits_;
+    std::vector<uint64_t> summary_;
+};
+
+// 连续数组价格阶梯。撮合后订单簿不交叉（所有买价 < 所有卖价），
+// 因此买卖两侧共用一个阶梯和一个位图：bestBid 以下的非空档位都是买单，
+// bestAsk 以上的非空档位都是卖单。
+class PriceLadder
+{
+public:
+    static constexpr Ticks NONE = -1;
+
+    explicit PriceLadder(uint32_t numLevels);
+
+    PriceLevel &level(Ticks ticks) { return levels_[ticks]; }
+    const PriceLevel &level(Ticks ticks) const { return levels_[ticks]; }
+    Ticks bestBid() const { return bestBid_; }
+    Ticks bestAsk() const { return bestAsk_; }
+    uint32_t numLevels() const { return static_cast<uint32_t>(levels_.size()); }
+
+    // 相邻的非空档位，没有返回 NONE（用于按价位顺序遍历整本订单簿）
+    Ticks nextOccupiedAbove(Ticks ticks) const { return occupied_.nextAbove(ticks); }
+    Ticks nextOccupiedBelow(Ticks ticks) const { return occupied_.prevBelow(ticks); }
+
+    // 档位由空变非空时调用
+    void markOccupied(Ticks ticks, OrderSide side);
+    // 档位由非空变空时调用，必要时向内寻找下一个最优价
+    void markEmpty(Ticks ticks);
+
+private:
+    std::vector<PriceLevel> levels_;
+    LevelBitmap occupied_;
+    Ticks bestBid_ = NONE;
+    Ticks bestAsk_ = NONE;
+};
@@ -0,0 +1,268 @@
+#include "ReportEgress.h"
+#include "protocol/MessageCodec.h"
+#include "utils/Logger.h"
+#include "utils/EventLog.h"
+#include "utils/LatencyTrace.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+ReportEgress::ReportEgress(std::vector<MatchingShard *> shards, uint32_t queueCapacity, const ConnectionOptions &options,
+                           uint32_t lanes)
+    : shards_(std::move(shards)), lanes_(lanes), staged_(shards_.size() * lanes, ReportBatch(options.output_buffer_size)),
+      control_(queueCapacity), options_(options)
+{
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = notifier_.fd();
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, notifier_.fd(), &ev);
+}
+
+ReportEgress::~ReportEgress()
+{
+    stop();
+    close(epollFd_);
+}
+
+void ReportEgress::start()
+{
+    running_.store(true);
+    thread_ = std::thread(&ReportEgress::run, this);
+}
+
+void ReportEgress::stop()
+{
+    if (!running_.exchange(false))
+        return;
+    notifier_.wake();
+    if (thread_.joinable())
+        thread_.join();
+    drainControl(); // 关闭已移交但尚未处理的 fd
+}
+
+void ReportEgress::connectionOpened(uint64_t connId)
+{
+    pushControl({connId, true});
+}
+
+void ReportEgress::connectionClosed(uint64_t connId)
+{
+    pushControl({connId, false});
+}
+
+void ReportEgress::pushControl(const ControlEvent &event)
+{
+    while (!control_.push(event))
+    {
+        notifier_.wake();
+        std::this_thread::yield();
+    }
+    notifier_.notify();
+}
+
+void ReportEgress::drainControl()
+{
+    while (const ControlEvent *event = control_.front())
+    {
+        int fd = static_cast<int>(event->conn_id & 0xffffffffu);
+        if (event->open)
+        {
+            sessions_[fd] = std::make_unique<Session>(event->conn_id, options_.output_buffer_size);
+        }
+        else
+        {
+            auto it = sessions_.find(fd);
+            if (it != sessions_.end() && it->second->conn_id == event->conn_id)
+            {
+                if (it->second->writeInterest)
+                    epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+                sessions_.erase(it);
+            }
+            close(fd);
+        }
+        control_.pop();
+    }
+}
+
+bool ReportEgress::hasPending()
+{
+    if (!control_.empty())
+        return true;
+    for (auto *shard : shards_)
+    {
+        if (shard->hasReports(0))
+            return true;
+    }
+    return false;
+}
+
+ReportEgress::Session *ReportEgress::findSession(uint64_t connId)
+{
+    int fd = static_cast<int>(connId & 0xffffffffu);
+    auto it = sessions_.find(fd);
+    if (it == sessions_.end() || it->second->conn_id != connId)
+    {
+        // open 事件可能晚于回报被看到：先处理控制队列再查一次
+        drainControl();
+        it = sessions_.find(fd);
+        if (it == sessions_.end() || it->second->conn_id != connId)
+            return nullptr;
+    }
+    return it->second.get();
+}
+
+void ReportEgress::deliver(const OutboundReport &item, ReportBatch &staged)
+{
+    // 同一批量指令的回报在输出队列中连续出现，以 BATCH_END 标记结束
+    if (item.flags & REPORT_BATCH_END)
+    {
+        deliverFrame(item.conn_id, staged.frame(), staged.frameSize());
+        staged.clear();
+        LATENCY_TRACE_RECORD(INGRESS_TO_REPORT, item.trace_ingress);
+        return;
+    }
+    if (item.flags & REPORT_BATCHED)
+    {
+        if (staged.full())
+        {
+            deliverFrame(item.conn_id, staged.frame(), staged.frameSize());
+            staged.clear();
+        }
+        staged.add(item.report);
+        EventLog::write(EventType::REPORT_SENT, static_cast<uint8_t>(item.report.exec_type), 0, item.conn_id,
+                        item.report.price, item.report.last_shares, item.report.leaves_qty,
+                        item.report.order_id.data);
+        sent_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    LATENCY_TRACE_STAMP(reportStart);
+    uint8_t frame[MessageCodec::HEADER_SIZE + ExecutionReport::WIRE_SIZE];
+    MessageCodec::encodeHeader(frame, MessageType::EXECUTION_REPORT, ExecutionReport::WIRE_SIZE);
+    item.report.serializeTo(frame + MessageCodec::HEADER_SIZE);
+    if (!deliverFrame(item.conn_id, frame, sizeof(frame)))
+        return;
+
+    EventLog::write(EventType::REPORT_SENT, static_cast<uint8_t>(item.report.exec_type), 0, item.conn_id,
+                    item.report.price, item.report.last_shares, item.report.leaves_qty, item.report.order_id.data);
+    sent_.fetch_add(1, std::memory_order_relaxed);
+    LATENCY_TRACE_RECORD(REPORT, reportStart);
+    LATENCY_TRACE_RECORD(INGRESS_TO_REPORT, item.trace_ingress);
+}
+
+bool ReportEgress::deliverFrame(uint64_t connId, const uint8_t *frame, size_t len)
+{
+    Session *found = findSession(connId);
+    if (!found || found->shutdown)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Session &session = *found;
+    int fd = static_cast<int>(connId & 0xffffffffu);
+    bool overflow = !session.out.append(frame, len);
+    bool overHigh = session.out.size() > session.out.capacity() / 4 * 3;
+    if (overflow || (overHigh && options_.slow_consumer == SlowConsumerPolicy::DISCONNECT))
+    {
+        spdlog::warn("Slow consumer on fd={}: {} bytes pending, disconnecting", fd, session.out.size());
+        session.shutdown = true;
+        shutdown(fd, SHUT_RDWR); // I/O 线程随后收到 EPOLLHUP 并移交 close
+        if (overflow)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    if (!session.dirty)
+    {
+        session.dirty = true;
+        dirty_.push_back(fd);
+    }
+    return true;
+}
+
+void ReportEgress::flushDirty()
+{
+    for (int fd : dirty_)
+    {
+        auto it = sessions_.find(fd);
+        if (it == sessions_.end())
+            continue;
+        it->second->dirty = false;
+        flushSession(fd, *it->second);
+    }
+    dirty_.clear();
+}
+
+void ReportEgress::flushSession(int fd, Session &session)
+{
+    LATENCY_TRACE_STAMP(flushStart);
+    auto result = session.out.flush(fd);
+    LATENCY_TRACE_RECORD(FLUSH, flushStart);
+    if (result == OutputBuffer::FlushResult::ERROR && !session.shutdown)
+    {
+        session.shutdown = true;
+        shutdown(fd, SHUT_RDWR);
+    }
+
+    // 只有积压时才关注 EPOLLOUT
+    bool want = !session.out.empty() && !session.shutdown;
+    if (want == session.writeInterest)
+        return;
+    struct epoll_event ev;
+    ev.events = EPOLLOUT | EPOLLET;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd_, want ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, want ? &ev : nullptr);
+    session.writeInterest = want;
+}
+
+void ReportEgress::waitForWork()
+{
+    notifier_.waitWith([this]
+                       { return hasPending() || !running_.load(); },
+                       [this]
+                       {
+        struct epoll_event events[64];
+        int n = epoll_wait(epollFd_, events, 64, -1);
+        for (int i = 0; i < n; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == notifier_.fd())
+            {
+                notifier_.consume();
+                continue;
+            }
+            auto it = sessions_.find(fd);
+            if (it != sessions_.end())
+                flushSession(fd, *it->second);
+        } });
+}
+
+void ReportEgress::run()
+{
+    spdlog::info("Report egress thread started");
+    LATENCY_TRACE_ONLY(LatencyTrace::setThreadName("egress"));
+    while (running_.load(std::memory_order_relaxed))
+    {
+        drainControl();
+        // 每个分片每轮至多取 max_batch 条，积压时也能定期写出。
+        // 流水线模式只有一个 I/O 线程，回报全部在下标 0 的输出队列
+        size_t n = 0;
+        for (size_t i = 0; i < shards_.size(); ++i)
+        {
+            ReportBatch *staged = &staged_[i * lanes_];
+            n += shards_[i]->drainReports(0, [this, staged](const OutboundReport &item)
+                                          { deliver(item, staged[item.lane]); },
+                                          options_.max_batch);
+        }
+        flushDirty();
+        if (n > 0)
+            continue;
+
+        waitForWork();
+    }
+    spdlog::info("Report egress thread stopped");
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "EngineCommand.h"
+#include "MatchingShard.h"
+#include "network/Connection.h"
+#include "network/OutputBuffer.h"
+#include "protocol/ReportBatch.h"
+#include "utils/SpscQueue.h"
+#include "utils/WaitNotifier.h"
+
+// 流水线模式的回报出口阶段：独立线程消费各撮合分片的输出队列，编码后追加到
+// 每个连接的发送缓冲区，批量 writev 写出；积压的连接注册到出口线程自己的 epoll
+// 等待 EPOLLOUT。慢连接不会拖住撮合线程。
+//
+// 慢消费者：出口线程无法暂停 I/O 线程读取，因此 DISCONNECT 策略在高水位、
+// THROTTLE 策略在缓冲区溢出时 shutdown 连接，由 I/O 线程走正常断开流程。
+//
+// 连接生命周期：I/O 线程在 accept 后投递 open 事件，断开时投递 close 事件并把 fd
+// 交给出口线程关闭。fd 在出口线程关闭之前不会被内核复用，因此按连接 ID 校验后
+// 直接写 fd 是安全的。
+class ReportEgress
+{
+public:
+    // lanes: 每个分片的批量回报暂存区个数（风控线程数，未启用风控时为 1），见 OutboundReport::lane
+    ReportEgress(std::vector<MatchingShard *> shards, uint32_t queueCapacity, const ConnectionOptions &options,
+                 uint32_t lanes = 1);
+    ~ReportEgress();
+
+    void start();
+    void stop();
+
+    // I/O 线程调用
+    void connectionOpened(uint64_t connId);
+    void connectionClosed(uint64_t connId);
+
+    // 撮合线程调用：输出队列中有新回报
+    void notify() { notifier_.notify(); }
+
+    uint64_t sent() const { return sent_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    size_t controlDepth() const { return control_.size(); }
+
+private:
+    struct ControlEvent
+    {
+        uint64_t conn_id;
+        bool open;
+    };
+
+    struct Session
+    {
+        Session(uint64_t id, size_t capacity) : conn_id(id), out(capacity) {}
+        uint64_t conn_id;
+        OutputBuffer out;
+        bool dirty = false;
+        bool writeInterest = false;
+        bool shutdown = false;
+    };
+
+    void run();
+    void pushControl(const ControlEvent &event);
+    void drainControl();
+    // staged: 该回报所在分片的批量回报暂存区
+    void deliver(const OutboundReport &item, ReportBatch &staged);
+    // 把一帧追加到连接的发送缓冲区，处理慢消费者；连接不存在或已关闭时返回 false
+    bool deliverFrame(uint64_t connId, const uint8_t *frame, size_t len);
+    Session *findSession(uint64_t connId);
+    void flushDirty();
+    void flushSession(int fd, Session &session);
+    void waitForWork();
+    bool hasPending();
+
+    std::vector<MatchingShard *> shards_;
+    uint32_t lanes_;
+    std::vector<ReportBatch> staged_; // 按 分片下标 × lanes_ + lane
+    SpscQueue<ControlEvent> control_;
+    WaitNotifier notifier_;
+    ConnectionOptions options_;
+    int epollFd_;
+    std::unordered_map<int, std::unique_ptr<Session>> sessions_; // fd -> 会话，仅出口线程访问
+    std::vector<int> dirty_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
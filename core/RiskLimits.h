@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// 事前风控限额，每个用户各自计算；取 0 的项不检查
+struct RiskLimits
+{
+    int32_t max_order_qty = 0;    // 单笔订单（及改单后）数量上限
+    double price_band = 0.0;      // 价格带：限价偏离该品种最近成交价的比例上限（0.05 即 ±5%），尚无成交时不检查
+    uint32_t max_open_orders = 0; // 未结订单（在途与挂单）笔数上限
+    double max_notional = 0.0;    // 未结订单名义金额（价格 × 数量）上限；市价单按最近成交价估算，尚无成交时拒绝
+
+    bool any() const { return max_order_qty > 0 || price_band > 0 || max_open_orders > 0 || max_notional > 0; }
+};
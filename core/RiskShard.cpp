@@ -0,0 +1,326 @@
+#include "RiskShard.h"
+#include "MatchingShard.h"
+#include "utils/Logger.h"
+#include "utils/LatencyTrace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+uint64_t hashUser(const UserId &id)
+{
+    uint64_t lo, hi;
+    std::memcpy(&lo, id.data, 8);
+    std::memcpy(&hi, id.data + 8, 8);
+    uint64_t h = (lo ^ 0x243F6A8885A308D3ULL) * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 32) ^ hi) * 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 29);
+}
+} // namespace
+
+uint32_t riskLane(const UserId &user, uint32_t lanes)
+{
+    // 取高位：同一风控线程内的用户表再按低位分桶，二者不相关
+    return static_cast<uint32_t>((hashUser(user) >> 32) % lanes);
+}
+
+size_t RiskShard::UserHash::operator()(const UserId &id) const
+{
+    return static_cast<size_t>(hashUser(id));
+}
+
+ReferencePrices::ReferencePrices(const std::vector<SymbolConfig> &symbols)
+    : slots_(std::make_unique<Slot[]>(symbols.size()))
+{
+    for (const auto &symbol : symbols)
+        index_.emplace(symbol.symbol_id, static_cast<uint32_t>(index_.size()));
+}
+
+std::atomic<double> *ReferencePrices::find(uint32_t symbolId) const
+{
+    auto it = index_.find(symbolId);
+    return it != index_.end() ? &slots_[it->second].price : nullptr;
+}
+
+RiskShard::RiskShard(uint32_t index, const RiskLimits &limits, std::vector<MatchingShard *> shards,
+                     const std::unordered_map<uint32_t, MatchingShard *> &symbolShards,
+                     const ReferencePrices &prices, uint32_t queueCapacity, uint32_t maxBatch, uint32_t ioThreads)
+    : index_(index), limits_(limits), maxBatch_(maxBatch), shards_(std::move(shards)),
+      shardInBatch_(shards_.size(), 0), taken_(std::make_unique<std::atomic<uint64_t>[]>(ioThreads)),
+      forwarded_(std::make_unique<std::atomic<uint64_t>[]>(shards_.size()))
+{
+    for (const auto &entry : symbolShards)
+        routes_[entry.first] = Route{entry.second, prices.find(entry.first)};
+    for (uint32_t i = 0; i < ioThreads; ++i)
+        inbound_.push_back(std::make_unique<SpscQueue<EngineCommand>>(queueCapacity));
+    for (size_t i = 0; i < shards_.size(); ++i)
+        feedback_.push_back(std::make_unique<SpscQueue<RiskEvent>>(queueCapacity));
+}
+
+RiskShard::~RiskShard()
+{
+    stop();
+}
+
+void RiskShard::restore(const UserId &user, double notional)
+{
+    UserState &state = users_[user];
+    ++state.open_orders;
+    state.notional += notional;
+}
+
+void RiskShard::start(const ThreadOptions &threadOptions)
+{
+    threadOptions_ = threadOptions;
+    running_.store(true);
+    thread_ = std::thread(&RiskShard::run, this);
+}
+
+void RiskShard::stop()
+{
+    if (running_.exchange(false))
+    {
+        notifier_.wake();
+        if (thread_.joinable())
+            thread_.join();
+    }
+}
+
+size_t RiskShard::inboundDepth() const
+{
+    size_t depth = 0;
+    for (const auto &queue : inbound_)
+        depth += queue->size();
+    return depth;
+}
+
+bool RiskShard::hasWork() const
+{
+    if (inboundDepth() > 0)
+        return true;
+    for (const auto &queue : feedback_)
+    {
+        if (!queue->empty())
+            return true;
+    }
+    return false;
+}
+
+void RiskShard::apply(const RiskEvent &event)
+{
+    auto it = users_.find(event.user_id);
+    if (it == users_.end())
+        return;
+    UserState &state = it->second;
+    state.open_orders = static_cast<uint32_t>(std::max<int64_t>(0, int64_t{state.open_orders} + event.orders));
+    state.notional += event.notional;
+    // 挂单价取自价格阶梯，与下单价的浮点误差会累积：没有未结订单时归零
+    if (state.open_orders == 0 || state.notional < 0)
+        state.notional = 0.0;
+}
+
+size_t RiskShard::applyFeedback()
+{
+    size_t n = 0;
+    for (auto &queue : feedback_)
+    {
+        while (const RiskEvent *event = queue->front())
+        {
+            apply(*event);
+            queue->pop();
+            ++n;
+        }
+    }
+    return n;
+}
+
+RejectReason RiskShard::admit(EngineCommand &cmd, const Route *route)
+{
+    const Order &order = cmd.order;
+    if (limits_.max_order_qty > 0 && order.quantity > limits_.max_order_qty)
+        return RejectReason::RISK_ORDER_SIZE;
+
+    // 市价单没有价格：不检查价格带，名义金额按参考价估算
+    const bool priced = cmd.type == CommandType::REPLACE_ORDER || order.type != OrderType::MARKET;
+    const double reference = route && route->lastPrice ? route->lastPrice->load(std::memory_order_relaxed) : 0.0;
+    if (limits_.price_band > 0 && priced && reference > 0 &&
+        std::fabs(order.price - reference) > limits_.price_band * reference)
+        return RejectReason::RISK_PRICE_BAND;
+    if (cmd.type == CommandType::REPLACE_ORDER)
+    {
+        // 改单不增加笔数。名义金额的实际变化取决于原订单的剩余数量，只有分片知道：
+        // 把余额交给分片检查（见 OrderBook::admitReplace），并先按改后全额预留，
+        // 分片执行完释放预留、回馈实际变化，其间本用户的新单按预留后的余额检查。
+        // 旧格式改单不带 user_id，不预留，分片只允许它减少名义金额
+        if (limits_.max_notional > 0)
+        {
+            cmd.flags |= COMMAND_RISK_BUDGET;
+            cmd.risk_budget = 0.0;
+            if (!order.user_id.empty())
+            {
+                UserState &state = users_[order.user_id];
+                cmd.risk_budget = limits_.max_notional - state.notional;
+                state.notional += order.price * order.quantity;
+            }
+        }
+        return RejectReason::NONE;
+    }
+
+    UserState &state = users_[order.user_id];
+    if (limits_.max_open_orders > 0 && state.open_orders >= limits_.max_open_orders)
+        return RejectReason::RISK_OPEN_ORDERS;
+    if (limits_.max_notional > 0 && !priced && reference <= 0)
+        return RejectReason::RISK_NO_REFERENCE; // 按 0 估算等于不检查
+    if (limits_.max_notional > 0 &&
+        state.notional + (priced ? order.price : reference) * order.quantity > limits_.max_notional)
+        return RejectReason::RISK_NOTIONAL;
+
+    // 计入未结。市价单不会挂单，金额按订单价格 0 计入，与撮合结束时回馈的释放量一致
+    ++state.open_orders;
+    state.notional += order.price * order.quantity;
+    return RejectReason::NONE;
+}
+
+void RiskShard::reject(EngineCommand &cmd, RejectReason reason) const
+{
+    const bool replace = cmd.type == CommandType::REPLACE_ORDER;
+    if (!replace)
+        cmd.cancel_id = cmd.order.order_id;
+    EventLog::write(replace ? EventType::REPLACE_REJECTED : EventType::ORDER_REJECTED, static_cast<uint8_t>(reason),
+                    cmd.symbol_id, cmd.conn_id, cmd.order.price, cmd.order.quantity, 0, cmd.cancel_id.data);
+    cmd.type = CommandType::RISK_REJECTED;
+}
+
+void RiskShard::forward(MatchingShard *shard, const EngineCommand &cmd)
+{
+    shardInBatch_[shard->index()] = 1;
+    while (!shard->enqueue(index_, cmd))
+    {
+        shard->publish();
+        applyFeedback();
+        if (!running_.load(std::memory_order_relaxed))
+            return; // 停止时分片可能已不再取指令
+        std::this_thread::yield();
+    }
+    forwarded_[shard->index()].fetch_add(1, std::memory_order_release);
+}
+
+void RiskShard::run()
+{
+    spdlog::info("Risk shard {} started", index_);
+    LATENCY_TRACE_ONLY(LatencyTrace::setThreadName("risk " + std::to_string(index_)));
+    applyThreadOptions("risk " + std::to_string(index_), threadOptions_);
+    IdleSpinner spinner(threadOptions_);
+
+    while (running_.load(std::memory_order_relaxed))
+    {
+        // 先取回馈：成交与撤单释放的额度在本轮检查中即可用
+        size_t n = applyFeedback();
+
+        // 与撮合分片相同，多个 I/O 线程的输入队列逐条轮流取，每批至多 maxBatch_ 条
+        size_t taken = 0;
+        bool more = true;
+        while (more && (maxBatch_ == 0 || taken < maxBatch_))
+        {
+            more = false;
+            for (size_t q = 0; q < inbound_.size(); ++q)
+            {
+                SpscQueue<EngineCommand> *queue = inbound_[q].get();
+                const EngineCommand *front = queue->front();
+                if (!front)
+                    continue;
+                EngineCommand cmd = *front;
+                queue->pop();
+                more = true;
+                ++taken;
+
+                if (cmd.type == CommandType::MASS_CANCEL)
+                {
+                    // 订单可能分布在任意品种上：每个分片各执行一次
+                    for (MatchingShard *shard : shards_)
+                        forward(shard, cmd);
+                    taken_[q].fetch_add(1, std::memory_order_release);
+                    if (maxBatch_ != 0 && taken >= maxBatch_)
+                        break;
+                    continue;
+                }
+
+                auto it = routes_.find(cmd.symbol_id);
+                const Route *route = it != routes_.end() ? &it->second : nullptr;
+                if (cmd.type == CommandType::NEW_ORDER || cmd.type == CommandType::REPLACE_ORDER)
+                {
+                    RejectReason reason = admit(cmd, route);
+                    if (reason != RejectReason::NONE)
+                    {
+                        reject(cmd, reason);
+                        rejected_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                LATENCY_TRACE_RECORD(RISK, cmd.trace_enqueue);
+                LATENCY_TRACE_ONLY(cmd.trace_enqueue = LatencyTrace::now());
+                forward(route ? route->shard : shards_[cmd.symbol_id % shards_.size()], cmd);
+                // 先转发再计数：屏障读到 taken 时，对应的 forwarded 一定已经可见
+                taken_[q].fetch_add(1, std::memory_order_release);
+                if (maxBatch_ != 0 && taken >= maxBatch_)
+                    break;
+            }
+        }
+
+        if (taken > 0)
+        {
+            for (MatchingShard *shard : shards_)
+            {
+                if (shardInBatch_[shard->index()])
+                {
+                    shardInBatch_[shard->index()] = 0;
+                    shard->publish();
+                }
+            }
+            checked_.fetch_add(taken, std::memory_order_relaxed);
+        }
+        if (n + taken > 0)
+        {
+            spinner.busy();
+            continue;
+        }
+
+        if (spinner.blocks())
+            notifier_.wait([this]
+                           { return hasWork() || !running_.load(); });
+        else
+            spinner.idle();
+    }
+    spdlog::info("Risk shard {} stopped", index_);
+}
+
+RiskFeed::RiskFeed(uint32_t shard, std::vector<RiskShard *> workers, ReferencePrices &prices)
+    : shard_(shard), workers_(std::move(workers)), pending_(workers_.size(), 0), prices_(prices)
+{
+}
+
+void RiskFeed::push(const RiskEvent &event)
+{
+    uint32_t lane = riskLane(event.user_id, static_cast<uint32_t>(workers_.size()));
+    RiskShard *worker = workers_[lane];
+    while (!worker->feedback(shard_).push(event))
+    {
+        if (!worker->running())
+            return;
+        worker->notifier().wake();
+        std::this_thread::yield();
+    }
+    pending_[lane] = 1;
+}
+
+void RiskFeed::flush()
+{
+    for (size_t i = 0; i < workers_.size(); ++i)
+    {
+        if (pending_[i])
+        {
+            pending_[i] = 0;
+            workers_[i]->publish();
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "EngineCommand.h"
+#include "EngineConfig.h"
+#include "RiskLimits.h"
+#include "utils/EventLog.h"
+#include "utils/SpscQueue.h"
+#include "utils/WaitNotifier.h"
+#include "utils/ThreadTuning.h"
+
+class MatchingShard;
+
+// 撮合分片回馈给风控的未结订单变化（增量）：挂单成交、撤单、改单以及主动单撮合结束时产生
+struct RiskEvent
+{
+    UserId user_id;
+    int32_t orders;  // 未结订单笔数
+    double notional; // 未结名义金额
+};
+
+// 用户所属的风控线程。I/O 线程按此投递新单，撮合分片按此回馈变化，二者必须一致
+uint32_t riskLane(const UserId &user, uint32_t lanes);
+
+// 各品种最近成交价：撮合线程成交时写入，风控线程读作价格带的参考价（0 表示尚无成交）。
+// 品种表启动后不再变化；每个价格独占一个缓存行，不同分片的成交互不干扰
+class ReferencePrices
+{
+public:
+    explicit ReferencePrices(const std::vector<SymbolConfig> &symbols);
+
+    // 品种不存在时返回 nullptr
+    std::atomic<double> *find(uint32_t symbolId) const;
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<double> price{0.0};
+    };
+
+    std::unordered_map<uint32_t, uint32_t> index_; // symbol_id -> slots_ 下标
+    std::unique_ptr<Slot[]> slots_;
+};
+
+// 事前风控线程：独占按 riskLane 分给自己的用户的风控状态（未结订单笔数与名义金额），不加锁。
+// I/O 线程把指令投进每个 I/O 线程各一条的输入队列，风控线程检查新单 / 改单后转发给撮合分片
+// （分片为每个风控线程各准备一条输入队列）；撮合分片经 RiskFeed 把成交、撤单等引起的
+// 未结变化写回每个分片各一条的回馈队列，风控线程每轮先取回馈再做检查。
+//
+// 被拒绝的指令同样转发，类型改为 RISK_REJECTED：回报与批量回报帧的结束标记仍只从撮合分片的
+// 输出队列发出，与同一连接其他指令的回报保持先后次序。撤单与批量撤单只转发（批量撤单转发给每个分片）。
+// 改单的名义金额增加量由分片检查（风控线程不知道原订单还剩多少），风控线程只按消息所带的
+// 订单所属用户给出余额并预留。
+// 会话交易多个用户时其指令会经由不同风控线程，由 MatchingEngine 在换线程时加屏障保持次序
+class RiskShard
+{
+public:
+    // shards: 全部撮合分片（按下标）；symbolShards: 品种 -> 所属分片，未知品种与 MatchingEngine
+    // 一样按 symbol_id 取模交给分片拒绝
+    RiskShard(uint32_t index, const RiskLimits &limits, std::vector<MatchingShard *> shards,
+              const std::unordered_map<uint32_t, MatchingShard *> &symbolShards, const ReferencePrices &prices,
+              uint32_t queueCapacity, uint32_t maxBatch, uint32_t ioThreads);
+    ~RiskShard();
+
+    // 启动前调用（单线程）：计入从快照 / 日志恢复出的挂单
+    void restore(const UserId &user, double notional);
+
+    void start(const ThreadOptions &threadOptions = ThreadOptions{});
+    void stop();
+    bool running() const { return running_.load(std::memory_order_relaxed); }
+
+    // I/O 线程 ioThread 调用：只入队，一轮结束后调用一次 publish 唤醒风控线程
+    bool enqueue(uint32_t ioThread, const EngineCommand &cmd) { return inbound_[ioThread]->push(cmd); }
+    void publish() { notifier_.notify(); }
+
+    // 撮合分片 shard 的回馈队列，由该分片的 RiskFeed 写入
+    SpscQueue<RiskEvent> &feedback(uint32_t shard) { return *feedback_[shard]; }
+    WaitNotifier &notifier() { return notifier_; }
+
+    // 会话换用另一个风控线程前的屏障（见 MatchingEngine::fenceRisk）：已从 I/O 线程 ioThread
+    // 的输入队列取出并转发完的指令数，以及转发给分片 shard 的指令总数
+    uint64_t taken(uint32_t ioThread) const { return taken_[ioThread].load(std::memory_order_acquire); }
+    uint64_t forwarded(uint32_t shard) const { return forwarded_[shard].load(std::memory_order_acquire); }
+
+    uint32_t index() const { return index_; }
+    uint64_t checked() const { return checked_.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    size_t inboundDepth() const;
+
+private:
+    struct Route
+    {
+        MatchingShard *shard;
+        const std::atomic<double> *lastPrice;
+    };
+
+    struct UserState
+    {
+        uint32_t open_orders = 0;
+        double notional = 0.0;
+    };
+
+    struct UserHash
+    {
+        size_t operator()(const UserId &id) const;
+    };
+
+    void run();
+    size_t applyFeedback();
+    void apply(const RiskEvent &event);
+    // 新单：通过时计入用户的未结订单；改单：检查数量与价格带，名义金额的余额随指令交给分片检查
+    RejectReason admit(EngineCommand &cmd, const Route *route);
+    void reject(EngineCommand &cmd, RejectReason reason) const;
+    // 投递给分片，输入队列满时先唤醒分片、处理回馈（分片可能正等着回馈队列腾出空间）
+    void forward(MatchingShard *shard, const EngineCommand &cmd);
+    bool hasWork() const;
+
+    uint32_t index_;
+    RiskLimits limits_;
+    uint32_t maxBatch_;
+    std::vector<MatchingShard *> shards_;
+    std::unordered_map<uint32_t, Route> routes_; // symbol_id -> 所属分片与参考价
+    std::unordered_map<UserId, UserState, UserHash> users_;
+
+    std::vector<std::unique_ptr<SpscQueue<EngineCommand>>> inbound_; // 按 I/O 线程下标
+    std::vector<std::unique_ptr<SpscQueue<RiskEvent>>> feedback_;    // 按撮合分片下标
+    std::vector<uint8_t> shardInBatch_;                              // 本轮已投递、尚未唤醒的分片
+    std::unique_ptr<std::atomic<uint64_t>[]> taken_;                 // 按 I/O 线程下标
+    std::unique_ptr<std::atomic<uint64_t>[]> forwarded_;             // 按撮合分片下标
+    WaitNotifier notifier_;
+    ThreadOptions threadOptions_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint64_t> checked_{0};
+    std::atomic<uint64_t> rejected_{0};
+};
+
+// 撮合分片一侧的回馈通道：按用户把 RiskEvent 写入所属风控线程的回馈队列，批末唤醒一次。
+// 只由所属分片的撮合线程调用
+class RiskFeed
+{
+public:
+    RiskFeed(uint32_t shard, std::vector<RiskShard *> workers, ReferencePrices &prices);
+
+    // 回馈队列满时唤醒风控线程并等待：丢弃变化会让未结数量永久失真
+    void push(const RiskEvent &event);
+    void flush();
+    std::atomic<double> *lastPrice(uint32_t symbolId) const { return prices_.find(symbolId); }
+
+private:
+    uint32_t shard_;
+    std::vector<RiskShard *> workers_;
+    std::vector<uint8_t> pending_;
+    ReferencePrices &prices_;
+};
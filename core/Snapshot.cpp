@@ -0,0 +1,366 @@
+#include "Snapshot.h"
+#include "utils/Logger.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cinttypes>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+constexpr char MAGIC[8] = {'M', 'E', 'S', 'N', 'A', 'P', '1', '\0'};
+constexpr uint32_t VERSION = 2;    // 2：订单记录带下单会话；仍可读取 1
+constexpr uint64_t HEADER_SIZE = 64;
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t shard;
+    uint32_t shard_count;
+    uint32_t book_count;
+    uint64_t last_seq;    // 快照包含的最后一条日志序号
+    uint64_t order_count;
+    uint64_t body_size;   // 文件头之后的字节数
+    uint32_t checksum;    // 覆盖 body 的 FNV-1a
+    uint32_t reserved;
+};
+static_assert(sizeof(SnapshotHeader) <= HEADER_SIZE, "snapshot header must fit in HEADER_SIZE");
+
+#pragma pack(push, 1)
+struct BookRecord
+{
+    uint32_t symbol_id;
+    uint32_t num_levels;
+    double tick_size;
+    double base_price;
+    int64_t last_traded_ticks; // 无成交时为 -1
+    uint64_t order_count;
+};
+
+struct OrderRecord
+{
+    int64_t ticks;
+    int32_t quantity;
+    int32_t remaining_quantity;
+    uint64_t timestamp;
+    uint8_t side;
+    uint8_t reserved[7];
+    char user_id[16];
+    char order_id[32];
+    uint64_t owner; // 下单会话（连接 ID），版本 1 没有此字段
+};
+#pragma pack(pop)
+static_assert(sizeof(BookRecord) == 40, "BookRecord layout is part of the file format");
+static_assert(sizeof(OrderRecord) == 88, "OrderRecord layout is part of the file format");
+constexpr size_t V1_ORDER_RECORD_SIZE = offsetof(OrderRecord, owner);
+
+uint32_t fnv1a(uint32_t h, const uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+constexpr uint32_t FNV_OFFSET = 2166136261u;
+
+// 子进程内使用的写缓冲：满了才 write(2)，顺带累计校验和
+class BufferedWriter
+{
+public:
+    BufferedWriter(int fd, uint8_t *buffer, size_t capacity) : fd_(fd), buffer_(buffer), capacity_(capacity) {}
+
+    bool append(const void *data, size_t len)
+    {
+        if (pos_ + len > capacity_ && !flush())
+            return false;
+        std::memcpy(buffer_ + pos_, data, len);
+        checksum_ = fnv1a(checksum_, buffer_ + pos_, len);
+        pos_ += len;
+        size_ += len;
+        return true;
+    }
+
+    bool flush()
+    {
+        size_t done = 0;
+        while (done < pos_)
+        {
+            ssize_t n = ::write(fd_, buffer_ + done, pos_ - done);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        pos_ = 0;
+        return true;
+    }
+
+    uint32_t checksum() const { return checksum_; }
+    uint64_t size() const { return size_; }
+
+private:
+    int fd_;
+    uint8_t *buffer_;
+    size_t capacity_;
+    size_t pos_ = 0;
+    uint64_t size_ = 0;
+    uint32_t checksum_ = FNV_OFFSET;
+};
+
+struct SnapshotFile
+{
+    uint64_t seq;
+    bool temporary;
+    std::string name;
+};
+
+std::vector<SnapshotFile> listSnapshots(const std::string &dir, uint32_t shard)
+{
+    std::vector<SnapshotFile> files;
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return files;
+    while (dirent *entry = readdir(d))
+    {
+        unsigned fileShard = 0;
+        uint64_t seq = 0;
+        int end = 0;
+        if (sscanf(entry->d_name, "shard-%u-%" SCNu64 ".snapshot%n", &fileShard, &seq, &end) != 2 ||
+            fileShard != shard)
+            continue;
+        const char *rest = entry->d_name + end;
+        if (*rest == '\0' || std::strcmp(rest, ".tmp") == 0)
+            files.push_back({seq, *rest != '\0', entry->d_name});
+    }
+    closedir(d);
+    return files;
+}
+} // namespace
+
+std::string Snapshot::path(const std::string &dir, uint32_t shard, uint64_t seq)
+{
+    char name[80];
+    snprintf(name, sizeof(name), "/shard-%u-%020" PRIu64 ".snapshot", shard, seq);
+    return dir + name;
+}
+
+bool Snapshot::write(const char *tmpPath, const char *finalPath, const char *dir,
+                     uint32_t shard, uint32_t shardCount, uint64_t seq,
+                     const BookMap &books, uint8_t *buffer, size_t capacity)
+{
+    int fd = ::open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    // 文件头最后写：先空出位置，body 写完、校验和算好后再回填
+    bool ok = lseek(fd, static_cast<off_t>(HEADER_SIZE), SEEK_SET) == static_cast<off_t>(HEADER_SIZE);
+    BufferedWriter out(fd, buffer, capacity);
+    uint64_t totalOrders = 0;
+    for (auto it = books.begin(); ok && it != books.end(); ++it)
+    {
+        const OrderBook &book = *it->second;
+        uint64_t count = 0;
+        book.forEachRestingOrder([&count](const OrderNode &)
+                                 { ++count; });
+
+        BookRecord bookRec{};
+        bookRec.symbol_id = it->first;
+        bookRec.num_levels = book.spec().num_levels;
+        bookRec.tick_size = book.spec().tick_size;
+        bookRec.base_price = book.spec().base_price;
+        bookRec.last_traded_ticks = book.lastTradeTicks();
+        bookRec.order_count = count;
+        ok = out.append(&bookRec, sizeof(bookRec));
+
+        book.forEachRestingOrder([&out, &ok](const OrderNode &node)
+                                 {
+            OrderRecord rec{};
+            rec.ticks = node.ticks;
+            rec.quantity = node.quantity;
+            rec.remaining_quantity = node.remaining_quantity;
+            rec.timestamp = node.timestamp;
+            rec.side = static_cast<uint8_t>(node.side);
+            std::memcpy(rec.user_id, node.user_id.data, sizeof(rec.user_id));
+            std::memcpy(rec.order_id, node.order_id.data, sizeof(rec.order_id));
+            rec.owner = node.owner;
+            ok = ok && out.append(&rec, sizeof(rec)); });
+        totalOrders += count;
+    }
+    ok = ok && out.flush();
+
+    uint8_t headerBlock[HEADER_SIZE] = {};
+    SnapshotHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.shard = shard;
+    header.shard_count = shardCount;
+    header.book_count = static_cast<uint32_t>(books.size());
+    header.last_seq = seq;
+    header.order_count = totalOrders;
+    header.body_size = out.size();
+    header.checksum = out.checksum();
+    std::memcpy(headerBlock, &header, sizeof(header));
+    ok = ok && pwrite(fd, headerBlock, sizeof(headerBlock), 0) == static_cast<ssize_t>(sizeof(headerBlock));
+    ok = ok && fsync(fd) == 0;
+    ::close(fd);
+
+    // 改名后同步目录，保证掉电后快照文件名也在
+    ok = ok && rename(tmpPath, finalPath) == 0;
+    if (!ok)
+    {
+        unlink(tmpPath);
+        return false;
+    }
+    int dirFd = ::open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0)
+    {
+        fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+}
+
+std::optional<uint64_t> Snapshot::loadLatest(const std::string &dir, uint32_t shard, uint32_t shardCount,
+                                             BookMap &books)
+{
+    std::vector<SnapshotFile> files = listSnapshots(dir, shard);
+    std::sort(files.begin(), files.end(), [](const SnapshotFile &a, const SnapshotFile &b)
+              { return a.seq > b.seq; });
+
+    for (const auto &file : files)
+    {
+        if (file.temporary)
+            continue;
+        std::string filePath = dir + "/" + file.name;
+        int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < HEADER_SIZE)
+        {
+            spdlog::warn("Snapshot: {} is unreadable or truncated, skipped", filePath);
+            if (fd >= 0)
+                ::close(fd);
+            continue;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+        {
+            spdlog::warn("Snapshot: mmap {} failed: {}", filePath, strerror(errno));
+            continue;
+        }
+        const auto *base = static_cast<const uint8_t *>(addr);
+
+        SnapshotHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || (header.version != VERSION && header.version != 1) ||
+            header.shard != shard || header.body_size != size - HEADER_SIZE ||
+            header.checksum != fnv1a(FNV_OFFSET, base + HEADER_SIZE, header.body_size))
+        {
+            spdlog::warn("Snapshot: {} is corrupt, trying an older one", filePath);
+            munmap(addr, size);
+            continue;
+        }
+        if (header.shard_count != shardCount)
+        {
+            spdlog::error("Snapshot: {} was written with {} shard(s), engine runs {}",
+                          filePath, header.shard_count, shardCount);
+            munmap(addr, size);
+            return std::nullopt;
+        }
+
+        // 校验和已覆盖全部字节，这里只需防范与配置不符的内容
+        const size_t orderRecordSize = header.version == 1 ? V1_ORDER_RECORD_SIZE : sizeof(OrderRecord);
+        const uint8_t *p = base + HEADER_SIZE;
+        const uint8_t *end = base + size;
+        bool ok = true;
+        for (uint32_t b = 0; ok && b < header.book_count; ++b)
+        {
+            if (static_cast<size_t>(end - p) < sizeof(BookRecord))
+            {
+                spdlog::error("Snapshot: {} ends before book {} of {}", filePath, b, header.book_count);
+                ok = false;
+                break;
+            }
+            BookRecord bookRec;
+            std::memcpy(&bookRec, p, sizeof(bookRec));
+            p += sizeof(bookRec);
+            auto it = books.find(bookRec.symbol_id);
+            if (it == books.end())
+            {
+                spdlog::error("Snapshot: {} contains symbol {} which is not configured on shard {}",
+                              filePath, bookRec.symbol_id, shard);
+                ok = false;
+                break;
+            }
+            OrderBook &book = *it->second;
+            const InstrumentSpec &spec = book.spec();
+            if (spec.num_levels != bookRec.num_levels || spec.tick_size != bookRec.tick_size ||
+                spec.base_price != bookRec.base_price ||
+                static_cast<uint64_t>(end - p) / orderRecordSize < bookRec.order_count)
+            {
+                spdlog::error("Snapshot: symbol {} in {} has a different price ladder than configured",
+                              bookRec.symbol_id, filePath);
+                ok = false;
+                break;
+            }
+            book.restoreLastTraded(bookRec.last_traded_ticks);
+
+            for (uint64_t i = 0; i < bookRec.order_count; ++i)
+            {
+                OrderRecord rec{};
+                std::memcpy(&rec, p, orderRecordSize);
+                p += orderRecordSize;
+                Order order{};
+                order.user_id = UserId::fromBytes(reinterpret_cast<const uint8_t *>(rec.user_id));
+                order.order_id = OrderId::fromBytes(reinterpret_cast<const uint8_t *>(rec.order_id));
+                order.side = static_cast<OrderSide>(rec.side);
+                order.price = spec.toPrice(rec.ticks);
+                order.quantity = rec.quantity;
+                order.remaining_quantity = rec.remaining_quantity;
+                order.timestamp = rec.timestamp;
+                order.symbol_id = bookRec.symbol_id;
+                if (!book.restoreOrder(order, rec.ticks, rec.owner))
+                {
+                    spdlog::error("Snapshot: cannot restore order {} of symbol {} from {}",
+                                  order.order_id.view(), bookRec.symbol_id, filePath);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+        munmap(addr, size);
+        if (!ok)
+            return std::nullopt;
+
+        spdlog::info("Snapshot: shard {} restored {} order(s) in {} book(s) from {}, seq {}",
+                     shard, header.order_count, header.book_count, filePath, header.last_seq);
+        return header.last_seq;
+    }
+    return 0;
+}
+
+void Snapshot::removeOlder(const std::string &dir, uint32_t shard, uint64_t seq)
+{
+    for (const auto &file : listSnapshots(dir, shard))
+    {
+        if (file.temporary || file.seq < seq)
+        {
+            std::string filePath = dir + "/" + file.name;
+            if (unlink(filePath.c_str()) != 0 && errno != ENOENT)
+                spdlog::warn("Snapshot: cannot remove {}: {}", filePath, strerror(errno));
+        }
+    }
+}
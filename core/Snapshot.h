@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include "OrderBook.h"
+
+using BookMap = std::unordered_map<uint32_t, std::unique_ptr<OrderBook>>;
+
+// 订单簿快照。每个撮合分片一份，与预写日志放在同一目录：
+//   <dir>/shard-<分片号>-<序号>.snapshot
+// 序号是快照包含的最后一条日志记录，恢复时只需重放其后的日志尾部。
+//
+// 文件格式（小端、定长记录）：64 字节文件头；每个品种一个品种头，随后是该品种的全部挂单：
+// 买方从最优价向外、卖方从最优价向外，同一价位按 FIFO 次序。订单索引不单独保存，
+// 按顺序把挂单逐条追加回订单簿即可同时还原档位队列和索引。
+// 文件头的校验和覆盖其后的全部字节，先写到 .tmp，fsync 后再改名，半个快照不会被当作有效快照。
+class Snapshot
+{
+public:
+    static std::string path(const std::string &dir, uint32_t shard, uint64_t seq);
+
+    // 写快照。供 fork 出的子进程调用：只用预先分配的 buffer 和系统调用，
+    // 不分配内存、不加锁、不写日志。路径须由父进程事先生成
+    static bool write(const char *tmpPath, const char *finalPath, const char *dir,
+                      uint32_t shard, uint32_t shardCount, uint64_t seq,
+                      const BookMap &books, uint8_t *buffer, size_t capacity);
+
+    // 加载分片最新的有效快照到 books（须已按配置建好、且为空），返回快照序号，
+    // 没有快照时返回 0。损坏的快照跳过并尝试更早的；品种参数不一致等无法恢复的情况返回 nullopt
+    static std::optional<uint64_t> loadLatest(const std::string &dir, uint32_t shard, uint32_t shardCount,
+                                              BookMap &books);
+
+    // 删除序号早于 seq 的快照和残留的 .tmp 文件
+    static void removeOlder(const std::string &dir, uint32_t shard, uint64_t seq);
+};
@@ -1,29 +1,136 @@
 #include <iostream>
 #include <csignal>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
 #include "utils/Logger.h"
 #include "network/TcpServer.h"
 #include "core/Order.h"
 #include "core/OrderBook.h"
 #include "core/ExecutionReport.h"
 #include "core/MatchingEngine.h"
+#include "core/EngineConfig.h"
+#include "utils/EventLog.h"
+#include "utils/LatencyTrace.h"
 
-int main()
+int main(int argc, char **argv)
 {
+    // Ctrl+C 退出与 SIGUSR1 输出分阶段延迟：在创建任何线程之前屏蔽，各线程继承屏蔽字，
+    // 信号只经 signalfd 交给 I/O 线程处理，退出时的收尾工作不在信号处理函数里执行
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    LATENCY_TRACE_ONLY(sigaddset(&signals, SIGUSR1));
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd == -1)
+        pthread_sigmask(SIG_UNBLOCK, &signals, nullptr); // 退回默认处理：Ctrl+C 直接终止进程
     Logger::init();
+    auto config = parseEngineConfig(argc, argv);
+    if (!config)
+    {
+        std::cerr << "Invalid arguments, see logs/engine.log\n";
+        return 1;
+    }
     spdlog::info("Matching Engine started!");
+    if (!config->event_log.empty() && !EventLog::open(config->event_log, config->event_log_ring))
+    {
+        std::cerr << "Cannot open event log " << config->event_log << "\n";
+        return 1;
+    }
 
-    MatchingEngine engine;
-    auto onMessage = [&engine](Connection* conn, MessageType type, const std::vector<uint8_t>& payload) {
+    MatchingEngine engine(*config);
+    auto onMessage = [&engine](Connection *conn, MessageType type, PayloadView payload) {
         engine.onMessage(conn, type, payload);
     };
-    // 启动服务器
-    TcpServer server(9999, onMessage);
+    // 启动服务器：每个 I/O 线程一个反应器，多于一个时各自以 SO_REUSEPORT 监听同一端口
+    std::vector<std::unique_ptr<TcpServer>> servers;
+    IoBackendOptions backend;
+    backend.backend = config->io_uring ? IoBackend::IO_URING : IoBackend::EPOLL;
+    backend.uring_entries = config->uring_entries;
+    backend.uring_buffers = config->uring_buffers;
+    backend.uring_buffer_size = config->uring_buffer_size;
+    for (uint32_t i = 0; i < engine.ioThreads(); ++i)
+    {
+        servers.push_back(std::make_unique<TcpServer>(config->port, onMessage, engine.connectionOptions(), i,
+                                                      engine.ioThreads() > 1, backend));
+        TcpServer &reactor = *servers.back();
+        reactor.setFirstConnectionSeq(engine.firstConnectionSeq());
+        reactor.setBatchEndHook([&engine, i]
+                                { engine.onBatchEnd(i); });
+        ThreadOptions threadOptions{config->idle, config->idle_spin_us, -1, config->rt_priority};
+        if (!config->io_cpus.empty())
+            threadOptions.cpu = config->io_cpus[i];
+        reactor.setThreadOptions(threadOptions);
+        if (!engine.hasEgressThread() && engine.reportFd(i) != -1)
+        {
+            engine.setConnectionLookup(i, [&reactor](uint64_t id)
+                                       { return reactor.findConnection(id); });
+            // 空转模式下事件循环从不阻塞，每轮直接检查回报，省去 eventfd 的读写
+            if (engine.pollsReports())
+                reactor.setPollHook([&engine, i]
+                                    { return engine.pollReports(i); });
+            else
+                reactor.addEventSource(engine.reportFd(i), [&engine, i]
+                                       { engine.drainReports(i); });
+        }
+    }
+    TcpServer &server = *servers[0];
+    // 共享内存会话、出口线程的连接通知（只支持单个 I/O 线程）与 SIGUSR1 都由第一个反应器处理
+    if (!config->shm_prefix.empty() &&
+        !server.enableSharedMemory(config->shm_prefix, config->shm_slots, config->shm_ring_size))
+    {
+        std::cerr << "Cannot create shared memory slots " << config->shm_prefix << ", see logs/engine.log\n";
+        return 1;
+    }
+    if (engine.hasEgressThread())
+    {
+        server.setConnectionHooks([&engine](uint64_t id)
+                                  { engine.onConnectionOpened(id); },
+                                  [&engine](uint64_t id)
+                                  { engine.onConnectionClosed(id); });
+    }
 
-    // 捕获 Ctrl+C
-    signal(SIGINT, [](int)
-           {
-        spdlog::info("Shutting down...");
-        exit(0); });
+    if (signalFd != -1)
+    {
+        server.addEventSource(signalFd, [signalFd, &servers]
+                              {
+            signalfd_siginfo info;
+            while (read(signalFd, &info, sizeof(info)) == sizeof(info))
+            {
+                if (info.ssi_signo == SIGINT)
+                {
+                    // 所有反应器处理完当前一轮后退出事件循环，收尾工作在 main 中进行
+                    for (auto &reactor : servers)
+                        reactor->stop();
+                }
+                else
+                {
+                    LATENCY_TRACE_ONLY(LatencyTrace::dump());
+                }
+            } });
+    }
+
+    // 对端断开后写 socket 返回 EPIPE，而不是收到 SIGPIPE 退出
+    signal(SIGPIPE, SIG_IGN);
+    // 其余反应器各占一个线程，第一个反应器在主线程上运行
+    std::vector<std::thread> reactorThreads;
+    for (size_t i = 1; i < servers.size(); ++i)
+    {
+        TcpServer *reactor = servers[i].get();
+        reactorThreads.emplace_back([reactor]
+                                    { reactor->start(); });
+    }
     server.start();
+    for (auto &thread : reactorThreads)
+        thread.join();
+
+    spdlog::info("Shutting down...");
+    engine.logStats();
+    LATENCY_TRACE_ONLY(LatencyTrace::dump());
+    EventLog::close();
     return 0;
 }
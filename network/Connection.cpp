@@ -1,67 +1,68 @@
 #include "Connection.h"
 #include "protocol/MessageCodec.h"
 #include "utils/Logger.h"
+#include "utils/EventLog.h"
+#include "utils/LatencyTrace.h"
 #include <spdlog/spdlog.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <algorithm>
+#include <cstring>
 #include <spdlog/fmt/bin_to_hex.h>
-Connection::Connection(int fd, MessageCallback cb) : sockfd_(fd), messageCallback_(std::move(cb)), recvBuffer_(BUFFER_SIZE)
+Connection::Connection(int fd, uint64_t id, MessageCallback cb, const ConnectionOptions &options, FlushScheduler scheduler)
+    : sockfd_(fd), id_(id), recvBuffer_(std::max(options.recv_buffer_size, MessageCodec::MAX_FRAME_SIZE)),
+      messageCallback_(std::move(cb)),
+      outBuffer_(options.output_buffer_size), options_(options), scheduler_(std::move(scheduler))
 {
     // 设置非阻塞
     int flags = fcntl(sockfd_, F_GETFL, 0);
     fcntl(sockfd_, F_SETFL, flags | O_NONBLOCK);
 }
 
+Connection::Connection(ShmSlot *slot, int key, uint64_t id, MessageCallback cb, const ConnectionOptions &options,
+                       FlushScheduler scheduler)
+    : sockfd_(key), id_(id), ownsFd_(false), shm_(slot), recvBuffer_(0),
+      messageCallback_(std::move(cb)),
+      outBuffer_(0), options_(options), scheduler_(std::move(scheduler))
+{
+}
+
 Connection::~Connection()
 {
-    close(sockfd_);
+    if (ownsFd_)
+        close(sockfd_);
     spdlog::info("Connection closed: fd={}", sockfd_);
 }
 
-void Connection::handleRead()
+bool Connection::handleRead()
 {
-    while (true)
+    batchCount_ = 0;
+    if (shm_)
+        return dispatchFrames(shm_->toEngine()); // 帧直接在共享内存环上解码，没有系统调用
+    if (dispatchFrames(recvBuffer_)) // 先处理上一轮留下或暂停前已收到的帧
+        return true;
+    while (!readPaused_ && !closing_)
     {
-        if (recvBuffer_.size() - readIndex_ < 1024)
+        uint8_t *dst = recvBuffer_.writePtr();
+        size_t space = recvBuffer_.writable();
+        if (space == 0)
         {
-            recvBuffer_.resize(recvBuffer_.size() + BUFFER_SIZE);
+            // 缓冲区不小于最大帧长，正常情况下不会出现
+            spdlog::error("Receive buffer full on fd={}", sockfd_);
+            closing_ = true;
+            break;
         }
 
-        ssize_t n = recv(sockfd_, recvBuffer_.data() + readIndex_, recvBuffer_.size() - readIndex_, 0);
+        LATENCY_TRACE_STAMP(recvStart);
+        ssize_t n = recv(sockfd_, dst, space, 0);
+        LATENCY_TRACE_RECORD(RECV, recvStart);
 
         if (n > 0)
         {
-
-            readIndex_ += n;
-            size_t currentOffset = 0; // 从 buffer 起点开始解析
-
-            while (true)
-            {
-                size_t tempIndex = currentOffset;
-
-                auto result = MessageCodec::decode(recvBuffer_, tempIndex);
-                if (result)
-                {
-                    auto [type, msg] = *result;
-                    messageCallback_(this, type, msg);
-                    currentOffset = tempIndex; // 更新已处理位置
-                }
-                else
-                {
-                    break;
-                }
-            }
-
-            // 滑动：只保留 [currentOffset, readIndex_) 的未处理数据
-            if (currentOffset > 0)
-            {
-                std::memmove(recvBuffer_.data(),
-                             recvBuffer_.data() + currentOffset,
-                             readIndex_ - currentOffset);
-                readIndex_ -= currentOffset;
-                recvBuffer_.resize(std::max(readIndex_, static_cast<size_t>(1024))); // 保留最小空间
-            }
+            recvBuffer_.commit(static_cast<size_t>(n));
+            if (dispatchFrames(recvBuffer_))
+                return true;
         }
         else if (n == 0)
         {
@@ -74,11 +75,133 @@ void Connection::handleRead()
             {
                 break; // 数据已读完
             }
-            else
+            else if (errno != EINTR)
             {
                 spdlog::error("Read error on fd={}: {}", sockfd_, strerror(errno));
                 break;
             }
         }
     }
-}
\ No newline at end of file
+    return false;
+}
+
+bool Connection::handleReceived(const std::function<size_t(uint8_t *, size_t)> &pull)
+{
+    batchCount_ = 0;
+    if (dispatchFrames(recvBuffer_))
+        return true;
+    while (!readPaused_ && !closing_)
+    {
+        uint8_t *dst = recvBuffer_.writePtr();
+        size_t space = recvBuffer_.writable();
+        if (space == 0)
+        {
+            spdlog::error("Receive buffer full on fd={}", sockfd_);
+            closing_ = true;
+            break;
+        }
+        size_t n = pull(dst, space);
+        if (n == 0)
+            break;
+        recvBuffer_.commit(n);
+        if (dispatchFrames(recvBuffer_))
+            return true;
+    }
+    return false;
+}
+
+template <typename Buffer>
+bool Connection::dispatchFrames(Buffer &buffer)
+{
+    // 帧直接在接收缓冲区上解码，payload 以视图形式交给回调，回调返回后才释放空间
+    size_t readable;
+    while (!readPaused_ && !closing_ && (readable = buffer.readable()) > 0)
+    {
+        if (options_.max_batch != 0 && batchCount_ >= options_.max_batch)
+            return true;
+        size_t consumed = 0;
+        LATENCY_TRACE_STAMP(decodeStart);
+        auto frame = MessageCodec::decode(buffer.readPtr(), readable, consumed);
+        if (frame)
+        {
+            LATENCY_TRACE_RECORD(DECODE, decodeStart);
+            LATENCY_TRACE_ONLY(LatencyTrace::setIngress(decodeStart));
+            messageCallback_(this, frame->type, frame->payload);
+            ++batchCount_;
+        }
+        else if (consumed > 0)
+        {
+            EventLog::write(EventType::MESSAGE_INVALID, static_cast<uint8_t>(RejectReason::BAD_MAGIC), 0, id_,
+                            0.0, 0, static_cast<int32_t>(consumed), nullptr);
+        }
+        buffer.consume(consumed);
+        if (!frame)
+        {
+            break; // 半包等待更多数据，或非法数据已被丢弃
+        }
+    }
+    return false;
+}
+
+bool Connection::sendFrame(const uint8_t *data, size_t len)
+{
+    if (closing_)
+        return false;
+
+    // 共享内存会话只 stage，批末 flushOutput 时才对客户端可见（与 socket 一样在日志提交之后）
+    if (shm_ ? !shm_->toClient().stage(data, len) : !outBuffer_.append(data, len))
+    {
+        // 回报不能静默丢弃：缓冲区满即断开，由客户端重连后对账
+        spdlog::error("Output buffer overflow on fd={} ({} bytes pending), disconnecting slow consumer",
+                      sockfd_, pendingOutput());
+        closing_ = true;
+    }
+    else if (pendingOutput() > outputCapacity() / 4 * 3)
+    {
+        if (options_.slow_consumer == SlowConsumerPolicy::DISCONNECT)
+        {
+            spdlog::warn("Slow consumer on fd={}: {} bytes pending, disconnecting", sockfd_, pendingOutput());
+            closing_ = true;
+        }
+        else if (!readPaused_)
+        {
+            spdlog::warn("Slow consumer on fd={}: {} bytes pending, pausing reads", sockfd_, pendingOutput());
+            readPaused_ = true;
+        }
+    }
+
+    if (!flushScheduled_ && scheduler_)
+    {
+        flushScheduled_ = true;
+        scheduler_(this);
+    }
+    return !closing_;
+}
+
+OutputBuffer::FlushResult Connection::flushOutput()
+{
+    if (shm_)
+    {
+        shm_->toClient().publish();
+        return OutputBuffer::FlushResult::DONE;
+    }
+    LATENCY_TRACE_STAMP(flushStart);
+    auto result = outBuffer_.flush(sockfd_);
+    LATENCY_TRACE_RECORD(FLUSH, flushStart);
+    if (result == OutputBuffer::FlushResult::ERROR)
+    {
+        spdlog::error("Write error on fd={}: {}", sockfd_, strerror(errno));
+    }
+    return result;
+}
+
+bool Connection::maybeResumeRead()
+{
+    if (readPaused_ && pendingOutput() < outputCapacity() / 4)
+    {
+        readPaused_ = false;
+        spdlog::info("Resuming reads on fd={}", sockfd_);
+        return true;
+    }
+    return false;
+}
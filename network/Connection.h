@@ -3,26 +3,109 @@
 #include <memory>
 #include <vector>
 #include <functional>
-#include "protocol/MessageType.h" 
+#include "protocol/WireMessages.h" 
+#include "protocol/PayloadView.h"
+#include "OutputBuffer.h"
+#include "RecvBuffer.h"
+#include "ShmRing.h"
+#include "ConnectionId.h"
 
 // class MessageCodec;
 
+// 慢消费者策略：发送缓冲区积压超过高水位时断开连接，或暂停读取该连接的新请求
+enum class SlowConsumerPolicy : uint8_t
+{
+    DISCONNECT,
+    THROTTLE
+};
+
+struct ConnectionOptions
+{
+    size_t recv_buffer_size = 1 << 17; // 不小于单帧最大长度
+    size_t output_buffer_size = 1 << 20;
+    size_t max_batch = 64; // 每轮事件循环每个连接最多处理的帧数，0 表示不限
+    SlowConsumerPolicy slow_consumer = SlowConsumerPolicy::DISCONNECT;
+    uint32_t busy_poll_us = 0; // 非 0 时对 socket 设置 SO_BUSY_POLL
+};
+
 class Connection {
 public:
-    using MessageCallback = std::function<void(Connection*, MessageType,const std::vector<uint8_t>&)>;
-    explicit Connection(int fd, MessageCallback cb);
+    // payload 指向接收缓冲区，只在回调期间有效
+    using MessageCallback = std::function<void(Connection *, MessageType, PayloadView)>;
+    // 连接首次出现待发送数据时回调，由事件循环在本轮结束时统一 flush
+    using FlushScheduler = std::function<void(Connection *)>;
+    // id: 全局唯一的连接标识（见 makeConnectionId），fd 复用后也不会混淆
+    Connection(int fd, uint64_t id, MessageCallback cb,
+               const ConnectionOptions &options = ConnectionOptions{}, FlushScheduler scheduler = nullptr);
+    // 共享内存会话：请求从 slot 的 toEngine 环读取，回报写入 toClient 环。
+    // key 是会话在连接表中的键（负数，不与 socket fd 冲突），id 的低 32 位与之相同
+    Connection(ShmSlot *slot, int key, uint64_t id, MessageCallback cb,
+               const ConnectionOptions &options = ConnectionOptions{}, FlushScheduler scheduler = nullptr);
     ~Connection();
 
-    void handleRead();
+    // 读取并分发帧；达到 max_batch 时提前返回 true，剩余数据留待下一轮继续处理
+    bool handleRead();
+    // 同 handleRead，但数据不从 socket 读取，而是由 pull(dst, space) 拷入（io_uring 后端：
+    // 内核已把数据收进提供缓冲区），pull 返回 0 表示暂无更多数据
+    bool handleReceived(const std::function<size_t(uint8_t *, size_t)> &pull);
+
+    // 追加一帧到发送缓冲区；超出容量时返回 false 并标记连接待关闭
+    bool sendFrame(const uint8_t *data, size_t len);
+    OutputBuffer::FlushResult flushOutput();
+    // 异步写出（io_uring 后端）：取待发送数据的 iovec，写完后 consumeOutput 已写出的字节数
+    unsigned outputSegments(iovec iov[2]) const { return outBuffer_.segments(iov); }
+    void consumeOutput(size_t n) { outBuffer_.consume(n); }
+    // 共享内存会话的回报在 flushOutput 时一次发布，从不需要 EPOLLOUT
+    bool hasPendingOutput() const { return !shm_ && !outBuffer_.empty(); }
+    void onFlushed() { flushScheduled_ = false; }
+    bool flushScheduled() const { return flushScheduled_; }
+    void markFlushScheduled() { flushScheduled_ = true; }
+
+    // THROTTLE 策略：积压降到低水位以下时恢复读取，返回是否刚刚恢复
+    bool maybeResumeRead();
+    bool readPaused() const { return readPaused_; }
+    bool shouldClose() const { return closing_; }
+
+    bool writeInterest() const { return writeInterest_; }
+    void setWriteInterest(bool on) { writeInterest_ = on; }
 
     int fd() const { return sockfd_; }
+    ShmSlot *shmSlot() const { return shm_; }
+    // 放弃 fd 所有权：析构时不再关闭（fd 已移交给其他线程）
+    void releaseFd() { ownsFd_ = false; }
+    uint64_t id() const { return id_; }
+    // 引擎附在连接上的路由：启用风控时为该会话最近一条指令经由的风控线程，以及它在该线程
+    // 输入队列中的位置（0 表示尚未发送过）。连接层不解释
+    uint32_t route() const { return route_; }
+    uint64_t routeMark() const { return routeMark_; }
+    void setRoute(uint32_t route, uint64_t mark)
+    {
+        route_ = route;
+        routeMark_ = mark;
+    }
 
 private:
     int sockfd_;
-    std::vector<uint8_t> recvBuffer_;
+    uint64_t id_;
+    bool ownsFd_ = true;
+    template <typename Buffer>
+    bool dispatchFrames(Buffer &buffer);
+    size_t pendingOutput() const { return shm_ ? shm_->toClient().used() : outBuffer_.size(); }
+    size_t outputCapacity() const { return shm_ ? shm_->toClient().capacity() : outBuffer_.capacity(); }
+
+    ShmSlot *shm_ = nullptr;
+    RecvBuffer recvBuffer_;
 
-    size_t readIndex_ = 0; 
-    static const size_t BUFFER_SIZE = 4096;
-    
     MessageCallback messageCallback_;
+
+    OutputBuffer outBuffer_;
+    ConnectionOptions options_;
+    FlushScheduler scheduler_;
+    bool flushScheduled_ = false;
+    bool writeInterest_ = false; // 是否已注册 EPOLLOUT
+    bool readPaused_ = false;
+    size_t batchCount_ = 0; // 本轮已分发的帧数
+    bool closing_ = false;
+    uint32_t route_ = 0;
+    uint64_t routeMark_ = 0;
 };
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+// 连接 ID：高 8 位为所属 I/O 线程（反应器）下标，随后 24 位为该线程内的连接序号，低 32 位为 fd。
+// 撮合分片据此把回报送回连接所在的 I/O 线程。挂单记下下单连接的 ID（会话）并随日志 / 快照持久化，
+// 重启后新连接的序号从恢复出的挂单所用序号之后继续（见 MatchingEngine::firstConnectionSeq），不与旧会话重复
+inline uint64_t makeConnectionId(uint32_t reactor, uint64_t seq, int fd)
+{
+    return (static_cast<uint64_t>(reactor) << 56) | ((seq & 0xffffffu) << 32) | static_cast<uint32_t>(fd);
+}
+
+inline uint32_t connectionReactor(uint64_t id) { return static_cast<uint32_t>(id >> 56); }
+
+inline uint64_t connectionSeq(uint64_t id) { return (id >> 32) & 0xffffffu; }
+
+inline int connectionFd(uint64_t id) { return static_cast<int>(id & 0xffffffffu); }
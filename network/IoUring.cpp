@@ -0,0 +1,284 @@
+#include "IoUring.h"
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+
+// 6.4 起内核可以代为分配提供缓冲区环，由用户态 mmap 映射；旧头文件中没有这些定义
+#ifndef IOU_PBUF_RING_MMAP
+#define IOU_PBUF_RING_MMAP 1
+#endif
+#ifndef IORING_OFF_PBUF_RING
+#define IORING_OFF_PBUF_RING 0x80000000ULL
+#define IORING_OFF_PBUF_SHIFT 16
+#endif
+
+namespace
+{
+int sysSetup(unsigned entries, io_uring_params *params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+int sysRegister(int fd, unsigned opcode, const void *arg, unsigned count)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+} // namespace
+
+IoUring::~IoUring()
+{
+    if (buffers_)
+        munmap(buffers_, static_cast<size_t>(bufferCount_) * bufferSize_);
+    if (bufRing_)
+        munmap(bufRing_, bufRingSize_);
+    if (sqes_)
+        munmap(sqes_, sqesSize_);
+    if (cqRing_ && cqRing_ != sqRing_)
+        munmap(cqRing_, cqRingSize_);
+    if (sqRing_)
+        munmap(sqRing_, sqRingSize_);
+    if (fd_ != -1)
+        close(fd_);
+}
+
+bool IoUring::init(unsigned entries)
+{
+    io_uring_params params{};
+    // COOP_TASKRUN + TASKRUN_FLAG：完成处理不打断用户态，需要进内核时由 sq flags 告知，
+    // 空转轮询时没有新提交、也没有待处理的完成就不必调用 io_uring_enter
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN |
+                   IORING_SETUP_TASKRUN_FLAG;
+    params.cq_entries = entries * 4;
+    fd_ = sysSetup(entries, &params);
+    if (fd_ < 0)
+    {
+        // 老内核不认识部分标志，退回最基本的配置
+        params = io_uring_params{};
+        fd_ = sysSetup(entries, &params);
+        if (fd_ < 0)
+            return false;
+    }
+    features_ = params.features;
+    // 多发 recv / accept 需要 IORING_FEAT_NODROP 之后的内核（5.19+ 才有多发，NODROP 在 5.5）
+    if (!(features_ & IORING_FEAT_NODROP) || !(features_ & IORING_FEAT_EXT_ARG))
+    {
+        errno = ENOSYS;
+        return false;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (features_ & IORING_FEAT_SINGLE_MMAP)
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        sqRing_ = nullptr;
+        return false;
+    }
+    if (features_ & IORING_FEAT_SINGLE_MMAP)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                       IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            cqRing_ = nullptr;
+            return false;
+        }
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return false;
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    auto *sq = static_cast<uint8_t *>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sqFlags_ = reinterpret_cast<unsigned *>(sq + params.sq_off.flags);
+    sqMask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqLocalTail_ = sqSubmitted_ = *sqTail_;
+
+    auto *cq = static_cast<uint8_t *>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+}
+
+bool IoUring::setupBufferRing(uint16_t bgid, unsigned count, unsigned size)
+{
+    bufRingSize_ = count * sizeof(io_uring_buf);
+    io_uring_buf_reg reg{};
+    reg.ring_entries = count;
+    reg.bgid = bgid;
+    // 优先让内核分配环，不支持（6.4 以前）时再用自己的内存
+    reg.pad = IOU_PBUF_RING_MMAP;
+    void *ring = MAP_FAILED;
+    if (sysRegister(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) == 0)
+    {
+        ring = mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                    IORING_OFF_PBUF_RING | (static_cast<uint64_t>(bgid) << IORING_OFF_PBUF_SHIFT));
+        if (ring == MAP_FAILED)
+            return false;
+    }
+    else
+    {
+        ring = mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (ring == MAP_FAILED)
+            return false;
+        reg.pad = 0;
+        reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+        if (sysRegister(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        {
+            munmap(ring, bufRingSize_);
+            return false;
+        }
+    }
+    bufRing_ = static_cast<io_uring_buf_ring *>(ring);
+
+    void *buffers = mmap(nullptr, static_cast<size_t>(count) * size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (buffers == MAP_FAILED)
+        return false;
+    buffers_ = static_cast<uint8_t *>(buffers);
+    bufferSize_ = size;
+    bufferCount_ = count;
+    for (unsigned i = 0; i < count; ++i)
+        recycleBuffer(static_cast<uint16_t>(i));
+    publishBuffers();
+    return true;
+}
+
+void IoUring::recycleBuffer(uint16_t bid)
+{
+    // 环的第 0 项从起始地址开始（tail 与其保留字段重叠）。旧版头文件在 C++ 下把 bufs 放在偏移 8，
+    // 不能用 bufRing_->bufs 索引
+    io_uring_buf &buf = reinterpret_cast<io_uring_buf *>(bufRing_)[bufTail_ & (bufferCount_ - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(buffer(bid));
+    buf.len = bufferSize_;
+    buf.bid = bid;
+    ++bufTail_;
+}
+
+void IoUring::publishBuffers()
+{
+    __atomic_store_n(&bufRing_->tail, bufTail_, __ATOMIC_RELEASE);
+}
+
+io_uring_sqe *IoUring::getSqe()
+{
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqLocalTail_ - head >= sqEntries_)
+    {
+        submitAndWait(0, 0);
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (sqLocalTail_ - head >= sqEntries_)
+            return nullptr;
+    }
+    unsigned index = sqLocalTail_ & sqMask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    ++sqLocalTail_;
+    return sqe;
+}
+
+int IoUring::submitAndWait(unsigned waitNr, int timeoutMs)
+{
+    unsigned toSubmit = sqLocalTail_ - sqSubmitted_;
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    sqSubmitted_ = sqLocalTail_;
+
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    io_uring_getevents_arg arg{};
+    struct __kernel_timespec ts{};
+    const void *argPtr = nullptr;
+    size_t argSize = 0;
+    if (waitNr > 0 && timeoutMs >= 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        flags |= IORING_ENTER_EXT_ARG;
+        argPtr = &arg;
+        argSize = sizeof(arg);
+    }
+    else if (waitNr == 0 && toSubmit == 0 &&
+             !(__atomic_load_n(sqFlags_, __ATOMIC_ACQUIRE) & (IORING_SQ_TASKRUN | IORING_SQ_CQ_OVERFLOW)))
+    {
+        return 0; // 无事可交、内核也没有待处理的完成：不必进内核
+    }
+
+    int ret = sysEnter(fd_, toSubmit, waitNr, flags, argPtr, argSize);
+    if (ret < 0 && (errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY))
+        return 0;
+    return ret < 0 ? -errno : ret;
+}
+
+void IoUring::prepMultishotAccept(io_uring_sqe *sqe, int fd, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = userData;
+}
+
+void IoUring::prepMultishotRecv(io_uring_sqe *sqe, int fd, uint16_t bgid, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bgid;
+    sqe->user_data = userData;
+}
+
+void IoUring::prepWritev(io_uring_sqe *sqe, int fd, const iovec *iov, unsigned count, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(iov);
+    sqe->len = count;
+    sqe->off = static_cast<uint64_t>(-1); // socket 没有文件位置
+    sqe->user_data = userData;
+}
+
+void IoUring::prepMultishotPoll(io_uring_sqe *sqe, int fd, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = userData;
+}
+
+void IoUring::prepCancel(io_uring_sqe *sqe, uint64_t targetUserData, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = targetUserData;
+    sqe->user_data = userData;
+}
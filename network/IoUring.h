@@ -0,0 +1,93 @@
+#pragma once
+#include <linux/io_uring.h>
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+
+// io_uring 的最小封装：直接用系统调用建环并 mmap 提交 / 完成队列，不依赖 liburing。
+// 只由创建它的线程使用（事件循环线程）：SQE 在一轮处理中逐个准备，
+// 下一次 submitAndWait 用一次 io_uring_enter 全部提交并收割完成事件。
+//
+// 接收使用提供缓冲区环（provided buffer ring）：count 个定长缓冲区交给内核，
+// 多发 recv 每次完成时由内核挑一个填入，CQE 标志位里带缓冲区编号，用完后 recycleBuffer 归还。
+class IoUring
+{
+public:
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    // entries: 提交队列深度（完成队列取其 4 倍，多发请求会产生大量 CQE）。
+    // 内核不支持或 io_uring 被禁用时返回 false
+    bool init(unsigned entries);
+    // 注册提供缓冲区环：count（2 的幂）个 size 字节的缓冲区，组号 bgid
+    bool setupBufferRing(uint16_t bgid, unsigned count, unsigned size);
+
+    // 取一个清零的 SQE；提交队列满时先把已准备的提交掉
+    io_uring_sqe *getSqe();
+
+    // 提交全部已准备的 SQE，等待至少 waitNr 个完成事件；timeoutMs < 0 表示不限时。
+    // 超时与被信号打断都不算错误，出错返回 -errno
+    int submitAndWait(unsigned waitNr, int timeoutMs);
+
+    // 依次处理完成队列中已有的 CQE，返回处理的个数
+    template <typename Fn>
+    unsigned forEachCqe(Fn &&fn)
+    {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE); // 内核写入
+        unsigned n = 0;
+        for (; head != tail; ++head, ++n)
+            fn(cqes_[head & cqMask_]);
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    uint8_t *buffer(uint16_t bid) const { return buffers_ + static_cast<size_t>(bid) * bufferSize_; }
+    unsigned bufferSize() const { return bufferSize_; }
+    unsigned bufferCount() const { return bufferCount_; }
+    // 归还缓冲区；批量归还后调用 publishBuffers 让内核可见
+    void recycleBuffer(uint16_t bid);
+    void publishBuffers();
+
+    // SQE 准备函数
+    static void prepMultishotAccept(io_uring_sqe *sqe, int fd, uint64_t userData);
+    static void prepMultishotRecv(io_uring_sqe *sqe, int fd, uint16_t bgid, uint64_t userData);
+    static void prepWritev(io_uring_sqe *sqe, int fd, const iovec *iov, unsigned count, uint64_t userData);
+    static void prepMultishotPoll(io_uring_sqe *sqe, int fd, uint64_t userData);
+    static void prepCancel(io_uring_sqe *sqe, uint64_t targetUserData, uint64_t userData);
+
+private:
+    int fd_ = -1;
+    unsigned features_ = 0;
+
+    void *sqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    void *cqRing_ = nullptr;
+    size_t cqRingSize_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+
+    unsigned *sqHead_ = nullptr;
+    unsigned *sqTail_ = nullptr;
+    unsigned *sqArray_ = nullptr;
+    unsigned *sqFlags_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned sqLocalTail_ = 0; // 已准备、尚未提交的 SQE 截止位置
+    unsigned sqSubmitted_ = 0; // 已交给内核的位置
+
+    unsigned *cqHead_ = nullptr;
+    unsigned *cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+
+    io_uring_buf_ring *bufRing_ = nullptr;
+    size_t bufRingSize_ = 0;
+    uint8_t *buffers_ = nullptr;
+    unsigned bufferSize_ = 0;
+    unsigned bufferCount_ = 0;
+    uint16_t bufTail_ = 0;
+};
@@ -0,0 +1,72 @@
+#include "OutputBuffer.h"
+#include <sys/uio.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+OutputBuffer::OutputBuffer(size_t capacity) : capacity_(capacity)
+{
+}
+
+bool OutputBuffer::append(const uint8_t *data, size_t len)
+{
+    if (len > capacity_ - size())
+        return false;
+    if (!data_)
+        data_ = std::make_unique<uint8_t[]>(capacity_); // 首次发送时才分配
+
+    size_t pos = tail_ % capacity_;
+    size_t first = std::min(len, capacity_ - pos);
+    std::memcpy(data_.get() + pos, data, first);
+    std::memcpy(data_.get(), data + first, len - first);
+    tail_ += len;
+    return true;
+}
+
+unsigned OutputBuffer::segments(iovec iov[2]) const
+{
+    if (empty())
+        return 0;
+    size_t pos = head_ % capacity_;
+    size_t first = std::min(size(), capacity_ - pos);
+    iov[0].iov_base = data_.get() + pos;
+    iov[0].iov_len = first;
+    iov[1].iov_base = data_.get();
+    iov[1].iov_len = size() - first;
+    return iov[1].iov_len > 0 ? 2 : 1;
+}
+
+void OutputBuffer::consume(size_t n)
+{
+    head_ += n;
+    // 清空后回到起点，下一批数据不再环绕
+    if (empty())
+        head_ = tail_ = 0;
+}
+
+OutputBuffer::FlushResult OutputBuffer::flush(int fd)
+{
+    struct iovec iov[2];
+    unsigned count;
+    while ((count = segments(iov)) > 0)
+    {
+        ssize_t n = writev(fd, iov, count);
+        if (n > 0)
+        {
+            consume(static_cast<size_t>(n));
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return FlushResult::PENDING;
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            return FlushResult::ERROR;
+        }
+    }
+    return FlushResult::DONE;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sys/uio.h>
+
+// 定长环形发送缓冲区。回报帧先追加到这里，事件循环醒来时用 writev 一次性写出
+// （环绕时两段 iovec），写不完的部分留待 EPOLLOUT。
+class OutputBuffer
+{
+public:
+    enum class FlushResult
+    {
+        DONE,    // 已全部写出
+        PENDING, // 内核发送缓冲区满（EAGAIN），仍有积压
+        ERROR    // 连接出错
+    };
+
+    explicit OutputBuffer(size_t capacity);
+
+    // 空间不足时返回 false，缓冲区内容不变
+    bool append(const uint8_t *data, size_t len);
+    FlushResult flush(int fd);
+    // 待发送数据的一到两段 iovec（环绕时两段），返回段数，空时为 0；
+    // 由调用方自行写出（如 io_uring 异步 writev）后 consume 已写出的字节数
+    unsigned segments(iovec iov[2]) const;
+    void consume(size_t n);
+
+    size_t size() const { return tail_ - head_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return head_ == tail_; }
+
+private:
+    std::unique_ptr<uint8_t[]> data_;
+    size_t capacity_;
+    size_t head_ = 0; // 单调递增，取模得到实际位置
+    size_t tail_ = 0;
+};
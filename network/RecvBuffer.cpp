@@ -0,0 +1,80 @@
+#include "RecvBuffer.h"
+#include "utils/Logger.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstring>
+
+RecvBuffer::RecvBuffer(size_t capacity)
+{
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    capacity_ = (capacity + page - 1) / page * page;
+    if (capacity_ == 0)
+        return; // 共享内存会话直接在槽位的环上解码，不需要接收缓冲区
+    if (!mapMirror())
+    {
+        spdlog::warn("Mirrored receive buffer unavailable ({}), falling back to linear buffer", strerror(errno));
+        base_ = new uint8_t[capacity_];
+    }
+}
+
+RecvBuffer::~RecvBuffer()
+{
+    if (mirrored_)
+        munmap(base_, capacity_ * 2);
+    else
+        delete[] base_;
+}
+
+bool RecvBuffer::mapMirror()
+{
+    int fd = memfd_create("recv_buffer", MFD_CLOEXEC);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, static_cast<off_t>(capacity_)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // 先保留 2 * capacity 的连续地址，再把同一个 memfd 覆盖映射到前后两半
+    void *area = mmap(nullptr, capacity_ * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+    uint8_t *base = static_cast<uint8_t *>(area);
+    bool ok = mmap(base, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+              mmap(base + capacity_, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+    close(fd); // 映射持有引用，fd 不再需要
+    if (!ok)
+    {
+        munmap(base, capacity_ * 2);
+        return false;
+    }
+    base_ = base;
+    mirrored_ = true;
+    return true;
+}
+
+uint8_t *RecvBuffer::writePtr()
+{
+    if (mirrored_)
+        return base_ + tail_ % capacity_;
+
+    // 线性模式：尾部空间不足一半时把未处理数据搬回起点
+    if (head_ > 0 && capacity_ - tail_ < capacity_ / 2)
+    {
+        std::memmove(base_, base_ + head_, readable());
+        tail_ -= head_;
+        head_ = 0;
+    }
+    return base_ + tail_;
+}
+
+void RecvBuffer::consume(size_t n)
+{
+    head_ += n;
+    if (head_ == tail_)
+        head_ = tail_ = 0; // 读空后回到起点
+}
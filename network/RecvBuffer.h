@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// 定长接收环形缓冲区。同一块物理内存（memfd）被连续映射两次，
+// [base, base + capacity) 之后紧跟它的镜像，任何不超过 capacity 的区间在虚拟地址上
+// 都是连续的：recv 可以一次写满空闲区，帧跨越环尾时也能直接按指针解码，无需 memmove。
+//
+// 镜像映射失败（如无 memfd_create）时退化为线性缓冲区，在写入空间不足时把未处理数据
+// 搬回起点。
+class RecvBuffer
+{
+public:
+    // capacity 向上取整到页大小
+    explicit RecvBuffer(size_t capacity);
+    ~RecvBuffer();
+
+    RecvBuffer(const RecvBuffer &) = delete;
+    RecvBuffer &operator=(const RecvBuffer &) = delete;
+
+    // 可写区：先取 writePtr()（线性模式下可能整理缓冲区）再取 writable()，
+    // recv 写入后调用 commit(n)
+    uint8_t *writePtr();
+    size_t writable() const { return mirrored_ ? capacity_ - readable() : capacity_ - tail_; }
+    void commit(size_t n) { tail_ += n; }
+
+    // 已收未处理的数据，解码后调用 consume(n)
+    const uint8_t *readPtr() const { return base_ + (mirrored_ ? head_ % capacity_ : head_); }
+    size_t readable() const { return tail_ - head_; }
+    void consume(size_t n);
+
+    size_t capacity() const { return capacity_; }
+    bool mirrored() const { return mirrored_; }
+
+private:
+    bool mapMirror();
+
+    uint8_t *base_ = nullptr;
+    size_t capacity_;
+    bool mirrored_ = false;
+    // 镜像模式下单调递增、取模定位；线性模式下是相对 base_ 的偏移
+    size_t head_ = 0;
+    size_t tail_ = 0;
+};
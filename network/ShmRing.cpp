@@ -0,0 +1,152 @@
+#include "ShmRing.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <new>
+
+namespace
+{
+constexpr char MAGIC[8] = {'M', 'E', 'S', 'H', 'M', '1', '\0', '\0'};
+constexpr uint32_t VERSION = 1;
+
+// 把 fd 中 [offset, offset + size) 连续映射两次
+uint8_t *mapMirrored(int fd, off_t offset, size_t size)
+{
+    void *area = mmap(nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED)
+        return nullptr;
+    auto *base = static_cast<uint8_t *>(area);
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, offset) == MAP_FAILED ||
+        mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, offset) == MAP_FAILED)
+    {
+        munmap(base, size * 2);
+        return nullptr;
+    }
+    return base;
+}
+} // namespace
+
+void ShmRing::attach(ShmRingControl *control, uint8_t *data, size_t capacity)
+{
+    control_ = control;
+    data_ = data;
+    capacity_ = capacity;
+    tail_ = control->tail.load(std::memory_order_acquire);
+    head_ = control->head.load(std::memory_order_acquire);
+    headCache_ = head_;
+}
+
+bool ShmRing::reserve(size_t len)
+{
+    if (tail_ + len - headCache_ > capacity_)
+    {
+        headCache_ = control_->head.load(std::memory_order_acquire);
+        if (tail_ + len - headCache_ > capacity_)
+            return false;
+    }
+    return true;
+}
+
+bool ShmRing::stage(const uint8_t *data, size_t len)
+{
+    if (!reserve(len))
+        return false;
+    std::memcpy(data_ + tail_ % capacity_, data, len); // 镜像映射，跨越环尾也是一次拷贝
+    tail_ += len;
+    return true;
+}
+
+ShmSlot::~ShmSlot()
+{
+    for (uint8_t *ring : rings_)
+    {
+        if (ring)
+            munmap(ring, ringSize_ * 2);
+    }
+    if (header_)
+        munmap(header_, headerSize_);
+    if (owner_)
+        shm_unlink(name_.c_str());
+}
+
+std::string ShmSlot::name(const std::string &prefix, uint32_t index)
+{
+    return prefix + "-" + std::to_string(index);
+}
+
+bool ShmSlot::map(int fd, size_t ringSize)
+{
+    headerSize_ = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    ringSize_ = ringSize;
+    void *header = mmap(nullptr, headerSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED)
+        return false;
+    header_ = static_cast<ShmSlotHeader *>(header);
+    rings_[0] = mapMirrored(fd, static_cast<off_t>(headerSize_), ringSize);
+    rings_[1] = mapMirrored(fd, static_cast<off_t>(headerSize_ + ringSize), ringSize);
+    if (!rings_[0] || !rings_[1])
+        return false;
+    attachRings();
+    return true;
+}
+
+bool ShmSlot::create(const std::string &name, size_t ringSize)
+{
+    name_ = name;
+    shm_unlink(name.c_str()); // 上次运行遗留的槽位
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return false;
+    owner_ = true;
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    bool ok = ftruncate(fd, static_cast<off_t>(page + ringSize * 2)) == 0 && map(fd, ringSize);
+    close(fd);
+    if (!ok)
+        return false;
+
+    // 新建对象全零，即 FREE、下标为 0；最后写 magic，客户端据此判断槽位已就绪
+    new (header_) ShmSlotHeader{};
+    header_->version = VERSION;
+    header_->ring_size = static_cast<uint32_t>(ringSize);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, MAGIC, sizeof(MAGIC));
+    return true;
+}
+
+bool ShmSlot::open(const std::string &name)
+{
+    name_ = name;
+    int fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    struct
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t ring_size;
+    } probe;
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    bool ok = pread(fd, &probe, sizeof(probe), 0) == static_cast<ssize_t>(sizeof(probe)) &&
+              std::memcmp(probe.magic, MAGIC, sizeof(MAGIC)) == 0 && probe.version == VERSION &&
+              probe.ring_size > 0 && probe.ring_size % page == 0 && map(fd, probe.ring_size);
+    close(fd);
+    return ok;
+}
+
+void ShmSlot::resetRings()
+{
+    for (ShmRingControl *control : {&header_->to_engine, &header_->to_client})
+    {
+        control->head.store(0, std::memory_order_relaxed);
+        control->tail.store(0, std::memory_order_relaxed);
+    }
+    attachRings();
+}
+
+void ShmSlot::attachRings()
+{
+    toEngine_.attach(&header_->to_engine, rings_[0], ringSize_);
+    toClient_.attach(&header_->to_client, rings_[1], ringSize_);
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 共享内存传输：同机客户端与引擎之间每个会话一个共享内存槽位（shm_open 对象），
+// 槽内两条单生产者 / 单消费者字节环，客户端 → 引擎传请求帧，引擎 → 客户端传回报帧，
+// 帧格式与 TCP 相同（MessageCodec）。
+//
+// 槽位布局：第一页是 ShmSlotHeader，之后依次是两条环的数据区。数据区与 RecvBuffer 一样
+// 连续映射两次，跨越环尾的帧在虚拟地址上也是连续的，双方都直接按指针读写。
+//
+// 会话建立：客户端把 FREE 的槽位 CAS 为 CLAIMING、写入 pid 后置 REQUESTED；
+// 引擎轮询到后清零两条环的下标并置 ACTIVE。客户端关闭时置 CLOSED，引擎回收为 FREE；
+// 引擎主动断开时置 DISCONNECTED，客户端确认后置 CLOSED。客户端进程退出后由引擎按 pid 回收。
+enum class ShmSlotState : uint32_t
+{
+    FREE = 0,
+    CLAIMING = 1,
+    REQUESTED = 2,
+    ACTIVE = 3,
+    CLOSED = 4,
+    DISCONNECTED = 5
+};
+
+// 环的共享下标：head 由消费者推进，tail 由生产者推进，各占一条缓存行
+struct ShmRingControl
+{
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+};
+
+struct ShmSlotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t ring_size;
+    alignas(64) std::atomic<uint32_t> state;
+    std::atomic<int32_t> client_pid;
+    ShmRingControl to_engine;
+    ShmRingControl to_client;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring indices must be lock-free across processes");
+static_assert(sizeof(ShmSlotHeader) <= 4096, "slot header must fit in the first page");
+
+// 一条环在本进程中的视图。同一进程只使用其中一种角色
+class ShmRing
+{
+public:
+    void attach(ShmRingControl *control, uint8_t *data, size_t capacity);
+
+    // 生产者：stage 只写数据、不对消费者可见，publish 一次发布此前 stage 的全部数据。
+    // 空间不足时 stage 返回 false，环内容不变
+    bool stage(const uint8_t *data, size_t len);
+    // 是否还能 stage len 字节；分段写一帧前先检查，避免留下半帧
+    bool reserve(size_t len);
+    void publish() { control_->tail.store(tail_, std::memory_order_release); }
+    size_t used() const { return tail_ - control_->head.load(std::memory_order_relaxed); }
+
+    // 消费者：读出已发布的数据，解码后调用 consume(n)
+    const uint8_t *readPtr() const { return data_ + head_ % capacity_; }
+    size_t readable() const { return control_->tail.load(std::memory_order_acquire) - head_; }
+    void consume(size_t n)
+    {
+        head_ += n;
+        control_->head.store(head_, std::memory_order_release);
+    }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    ShmRingControl *control_ = nullptr;
+    uint8_t *data_ = nullptr;
+    size_t capacity_ = 0;
+    uint64_t tail_ = 0;      // 生产者：已写入（含未发布）的位置
+    uint64_t headCache_ = 0; // 生产者：缓存的消费位置，空间不足时才重新读取
+    uint64_t head_ = 0;      // 消费者：已消费的位置
+};
+
+// 一个共享内存槽位的映射
+class ShmSlot
+{
+public:
+    ShmSlot() = default;
+    ~ShmSlot();
+    ShmSlot(const ShmSlot &) = delete;
+    ShmSlot &operator=(const ShmSlot &) = delete;
+
+    static std::string name(const std::string &prefix, uint32_t index);
+
+    // 引擎：创建（同名旧对象先删除）并映射，ringSize 为页大小的整数倍
+    bool create(const std::string &name, size_t ringSize);
+    // 客户端：打开已存在的槽位
+    bool open(const std::string &name);
+
+    // 引擎：清零两条环的下标并重新绑定本地视图，仅在槽位尚未 ACTIVE 时调用
+    void resetRings();
+    // 按共享下标重新绑定本地视图（客户端在槽位变为 ACTIVE 后调用）
+    void attachRings();
+
+    ShmSlotHeader *header() const { return header_; }
+    ShmRing &toEngine() { return toEngine_; }
+    ShmRing &toClient() { return toClient_; }
+
+private:
+    bool map(int fd, size_t ringSize);
+
+    std::string name_;
+    bool owner_ = false; // 引擎创建的槽位在析构时 shm_unlink
+    ShmSlotHeader *header_ = nullptr;
+    size_t headerSize_ = 0;
+    uint8_t *rings_[2] = {nullptr, nullptr};
+    size_t ringSize_ = 0;
+    ShmRing toEngine_;
+    ShmRing toClient_;
+};
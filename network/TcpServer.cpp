@@ -1,17 +1,25 @@
 #include "TcpServer.h"
+#include "IoUring.h"
 #include "utils/Logger.h"
+#include "utils/LatencyTrace.h"
 #include <spdlog/spdlog.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cstring>
 #include <cerrno>
 #include <iostream>
 
-TcpServer::TcpServer(int port, MessageCallback cb)
-    : port_(port), messageCallback_(std::move(cb))
+TcpServer::TcpServer(int port, MessageCallback cb, const ConnectionOptions &options, uint32_t reactor,
+                     bool reusePort, const IoBackendOptions &backend)
+    : messageCallback_(std::move(cb)), port_(port), reactor_(reactor),
+      stopFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), connOptions_(options)
 {
     // 创建监听 socket
     listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
@@ -24,6 +32,23 @@ TcpServer::TcpServer(int port, MessageCallback cb)
     // 设置 SO_REUSEADDR,立即重启服务而不被 TIME_WAIT 阻塞
     int opt = 1;
     setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    // 多反应器：每个 I/O 线程一个监听 socket，accept 不必在线程间分发
+    if (reusePort && setsockopt(listenFd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1)
+    {
+        spdlog::critical("Setsockopt SO_REUSEPORT failed: {}", strerror(errno));
+        exit(1);
+    }
+
+    // 忙轮询：阻塞读与 epoll_wait 在睡眠前先轮询网卡队列若干微秒（需要驱动支持，提高上限需 CAP_NET_ADMIN）
+    if (connOptions_.busy_poll_us > 0)
+    {
+        int usec = static_cast<int>(connOptions_.busy_poll_us);
+        if (setsockopt(listenFd_, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) == -1)
+        {
+            spdlog::warn("Setsockopt SO_BUSY_POLL failed: {}, busy polling disabled", strerror(errno));
+            connOptions_.busy_poll_us = 0;
+        }
+    }
 
     // 绑定
     struct sockaddr_in addr{};
@@ -43,6 +68,22 @@ TcpServer::TcpServer(int port, MessageCallback cb)
         exit(1);
     }
 
+    if (backend.backend == IoBackend::IO_URING)
+    {
+        ring_ = std::make_unique<IoUring>();
+        if (ring_->init(backend.uring_entries) &&
+            ring_->setupBufferRing(0, backend.uring_buffers, backend.uring_buffer_size))
+        {
+            epollFd_ = -1;
+            armAccept();
+            spdlog::info("TcpServer {} listening on port {} (io_uring, {} x {} byte buffers)", reactor_, port_,
+                         backend.uring_buffers, backend.uring_buffer_size);
+            return;
+        }
+        spdlog::warn("io_uring unavailable ({}), falling back to epoll", strerror(errno));
+        ring_.reset();
+    }
+
     // 创建 epoll
     epollFd_ = epoll_create1(EPOLL_CLOEXEC);
     if (epollFd_ == -1)
@@ -61,13 +102,16 @@ TcpServer::TcpServer(int port, MessageCallback cb)
         exit(1);
     }
 
-    spdlog::info("TcpServer listening on port {}", port_);
+    spdlog::info("TcpServer {} listening on port {}", reactor_, port_);
 }
 
 TcpServer::~TcpServer()
 {
     close(listenFd_);
-    close(epollFd_);
+    if (epollFd_ != -1)
+        close(epollFd_);
+    if (stopFd_ != -1)
+        close(stopFd_);
 }
 
 void TcpServer::handleAccept()
@@ -79,12 +123,29 @@ void TcpServer::handleAccept()
     while ((clientFd = accept4(listenFd_, (struct sockaddr *)&clientAddr, &clientLen, SOCK_NONBLOCK)) != -1)
     {
         spdlog::info("New connection from {}:{}", inet_ntoa(clientAddr.sin_addr), ntohs(clientAddr.sin_port));
+        addConnection(clientFd);
+    }
 
-        // 设置客户端 socket 为非阻塞（accept4 已设置，双重保险）
-        int flags = fcntl(clientFd, F_GETFL, 0);
-        fcntl(clientFd, F_SETFL, flags | O_NONBLOCK);
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        spdlog::error("Accept error: {}", strerror(errno));
+    }
+}
+
+void TcpServer::addConnection(int clientFd)
+{
+    // 设置客户端 socket 为非阻塞（accept4 已设置，双重保险）
+    int flags = fcntl(clientFd, F_GETFL, 0);
+    fcntl(clientFd, F_SETFL, flags | O_NONBLOCK);
+    if (connOptions_.busy_poll_us > 0)
+    {
+        int usec = static_cast<int>(connOptions_.busy_poll_us);
+        setsockopt(clientFd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec));
+    }
 
-        // 注册到 epoll
+    // 注册到 epoll
+    if (!ring_)
+    {
         struct epoll_event ev;
         ev.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
         ev.data.fd = clientFd;
@@ -92,28 +153,41 @@ void TcpServer::handleAccept()
         {
             spdlog::error("Epoll_ctl add client fd failed: {}", strerror(errno));
             close(clientFd);
-            continue;
+            return;
         }
-
-        // 保存连接
-        connections_[clientFd] = std::make_unique<Connection>(clientFd, messageCallback_);
     }
 
-    if (errno != EAGAIN && errno != EWOULDBLOCK)
+    // 保存连接
+    uint64_t connId = makeConnectionId(reactor_, nextConnSeq_++, clientFd);
+    auto &entry = connections_[clientFd];
+    entry = std::make_unique<Connection>(
+        clientFd, connId, messageCallback_, connOptions_,
+        [this](Connection *conn)
+        { pendingFlush_.push_back(conn->id()); });
+    if (ring_)
     {
-        spdlog::error("Accept error: {}", strerror(errno));
+        auto &state = uringConns_[clientFd];
+        state = std::make_unique<UringConn>();
+        armRecv(entry.get(), *state);
     }
+    if (onOpen_)
+        onOpen_(connId);
 }
 
 void TcpServer::runEventLoop()
 {
     std::vector<epoll_event> events(MAX_EVENTS);
-    spdlog::info("Starting event loop...");
-    std::cout<<"Starting event loop...\n";
-    while (true)
+    std::vector<uint64_t> carryOver;
+    spdlog::info("Starting event loop {}...", reactor_);
+    LATENCY_TRACE_ONLY(LatencyTrace::setThreadName("io " + std::to_string(reactor_)));
+    if (reactor_ == 0)
+        std::cout<<"Starting event loop...\n";
+    IdleSpinner spinner(threadOptions_);
+    while (!stopping_.load(std::memory_order_acquire))
     {
-        int nfds = epoll_wait(epollFd_, events.data(), MAX_EVENTS, -1);
-        
+        int nfds = epoll_wait(epollFd_, events.data(), MAX_EVENTS, waitTimeout(spinner, !carryOver.empty()));
+        LATENCY_TRACE_STAMP(wakeup);
+
         if (nfds == -1)
         {
             if (errno == EINTR)
@@ -134,25 +208,645 @@ void TcpServer::runEventLoop()
             {
                 auto it = connections_.find(fd);
                 if (it == connections_.end())
+                {
+                    auto src = eventSources_.find(fd);
+                    if (src != eventSources_.end())
+                        src->second();
                     continue;
+                }
 
                 if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
                 {
                     spdlog::info("Client disconnected: fd={}", fd);
-                    connections_.erase(it);
+                    closeConnection(it);
                     continue;
                 }
 
-                if (events[i].events & EPOLLIN)
+                if (events[i].events & EPOLLOUT)
+                {
+                    // 不在这里直接写：所有写出集中在批末 flushPending（预写日志提交之后）
+                    Connection *conn = it->second.get();
+                    if (!conn->flushScheduled())
+                    {
+                        conn->markFlushScheduled();
+                        pendingFlush_.push_back(conn->id());
+                    }
+                }
+
+                if ((events[i].events & EPOLLIN) && !it->second->readPaused())
                 {
-                    it->second->handleRead();
+                    LATENCY_TRACE_RECORD(EPOLL_DISPATCH, wakeup);
+                    readConnection(it->second.get());
                 }
             }
         }
+
+        // 上一轮达到批量上限的连接（ET 模式下不会再有事件提醒）
+        bool active = nfds > 0 || !carryOver.empty();
+        if (!carryOver.empty())
+        {
+            for (uint64_t id : carryOver)
+            {
+                Connection *conn = findConnection(id);
+                if (conn && !conn->readPaused())
+                    readConnection(conn);
+            }
+            carryOver.clear();
+        }
+        finishIteration(spinner, active);
+
+        // 一批请求处理完毕：先让撮合阶段开工 / 提交日志，再把本轮产生的回报统一写出
+        flushPending();
+        carryOver.swap(pendingRead_);
+    }
+}
+
+int TcpServer::waitTimeout(const IdleSpinner &spinner, bool carryOver) const
+{
+    // 还有连接因批量上限未读完、或有共享内存会话在轮询时不阻塞，处理完新事件后继续读它们
+    if (carryOver || shmSessions_ > 0 || !spinner.blocks())
+        return 0;
+    if (!shmSlots_.empty())
+        return SHM_IDLE_POLL_MS;
+    return -1;
+}
+
+void TcpServer::finishIteration(IdleSpinner &spinner, bool active)
+{
+    if (!shmSlots_.empty() && pollSharedMemory())
+        active = true;
+    if (pollHook_ && pollHook_())
+        active = true;
+    if (active)
+        spinner.busy();
+    else if (!spinner.blocks())
+        spinner.idle();
+    else if (shmSessions_ > 0)
+        sched_yield(); // 共享内存会话没有事件通知，轮询空转时让出 CPU，同核的客户端得以运行
+}
+
+void TcpServer::readConnection(Connection *conn)
+{
+    if (!ring_ || conn->shmSlot())
+    {
+        if (conn->handleRead())
+            pendingRead_.push_back(conn->id());
+        return;
+    }
+
+    // io_uring：数据已在提供缓冲区中，按顺序拷入连接的接收缓冲区，拷完的缓冲区立即归还
+    UringConn &state = *uringConns_[conn->fd()];
+    bool more = conn->handleReceived(
+        [this, &state](uint8_t *dst, size_t space)
+        {
+            size_t copied = 0;
+            while (copied < space && !state.backlog.empty())
+            {
+                UringChunk &chunk = state.backlog.front();
+                size_t n = std::min(space - copied, static_cast<size_t>(chunk.len - chunk.offset));
+                std::memcpy(dst + copied, ring_->buffer(chunk.bid) + chunk.offset, n);
+                copied += n;
+                chunk.offset += static_cast<uint32_t>(n);
+                if (chunk.offset == chunk.len)
+                {
+                    releaseBuffer(chunk.bid);
+                    state.backlog.pop_front();
+                }
+            }
+            return copied;
+        });
+    if (more)
+        pendingRead_.push_back(conn->id());
+    else if (conn->readPaused())
+        cancelRecv(conn, state);
+}
+
+void TcpServer::flushPending()
+{
+    // flush 过程中恢复读取可能产生新的请求和回报：每轮写出前都先结束当前批，循环直到清空
+    while (true)
+    {
+        if (onBatchEnd_)
+            onBatchEnd_();
+        if (pendingFlush_.empty())
+            break;
+        std::vector<uint64_t> batch;
+        batch.swap(pendingFlush_);
+        for (uint64_t id : batch)
+        {
+            Connection *conn = findConnection(id);
+            if (conn)
+            {
+                conn->onFlushed();
+                flushConnection(conn);
+            }
+        }
+    }
+}
+
+void TcpServer::flushConnection(Connection *conn)
+{
+    auto result = ring_ && !conn->shmSlot() ? submitSend(conn) : conn->flushOutput();
+    if (result == OutputBuffer::FlushResult::ERROR || conn->shouldClose())
+    {
+        auto it = connections_.find(conn->fd());
+        if (it != connections_.end())
+        {
+            spdlog::info("Closing connection: fd={}", conn->fd());
+            closeConnection(it);
+        }
+        return;
+    }
+
+    if (!ring_)
+        updateWriteInterest(conn);
+    if (conn->maybeResumeRead())
+    {
+        // ET 模式下暂停期间到达的数据不会再触发事件，恢复后主动读一次；
+        // io_uring 下先处理暂停期间积压的数据，多发 recv 在本轮末尾重新提交
+        readConnection(conn);
+        if (ring_ && !conn->shmSlot())
+            uringRearm_.push_back(conn->id());
+    }
+}
+
+void TcpServer::updateWriteInterest(Connection *conn)
+{
+    // 只有存在积压时才关注 EPOLLOUT，避免空转唤醒
+    bool want = conn->hasPendingOutput();
+    if (want == conn->writeInterest())
+        return;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET | EPOLLRDHUP | (want ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    ev.data.fd = conn->fd();
+    if (epoll_ctl(epollFd_, EPOLL_CTL_MOD, conn->fd(), &ev) == -1)
+    {
+        spdlog::error("Epoll_ctl mod fd={} failed: {}", conn->fd(), strerror(errno));
+        return;
+    }
+    conn->setWriteInterest(want);
+}
+
+void TcpServer::addEventSource(int fd, std::function<void()> handler)
+{
+    if (ring_)
+    {
+        eventSources_[fd] = std::move(handler);
+        armEventSource(fd);
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) == -1)
+    {
+        spdlog::critical("Epoll_ctl add event source fd={} failed: {}", fd, strerror(errno));
+        exit(1);
+    }
+    eventSources_[fd] = std::move(handler);
+}
+
+void TcpServer::setConnectionHooks(std::function<void(uint64_t)> onOpen, std::function<void(uint64_t)> onClose)
+{
+    onOpen_ = std::move(onOpen);
+    onClose_ = std::move(onClose);
+}
+
+void TcpServer::closeConnection(std::unordered_map<int, std::unique_ptr<Connection>>::iterator it)
+{
+    if (it->first < 0)
+    {
+        releaseSharedMemory(it->first);
+        if (onClose_)
+            onClose_(it->second->id());
+    }
+    else if (ring_)
+    {
+        // 关闭读方向，多发 recv 随之结束；之后到达的完成事件按连接 ID 识别为过期并归还缓冲区
+        shutdown(it->first, SHUT_RD);
+        auto state = uringConns_.find(it->first);
+        for (const UringChunk &chunk : state->second->backlog)
+            releaseBuffer(chunk.bid);
+        state->second->backlog.clear();
+        if (onClose_)
+        {
+            it->second->releaseFd();
+            onClose_(it->second->id());
+        }
+        if (state->second->sendInFlight)
+        {
+            uint64_t id = it->second->id();
+            retired_.emplace(id, std::make_pair(std::move(it->second), std::move(state->second)));
+        }
+        uringConns_.erase(state);
+    }
+    else if (onClose_)
+    {
+        // fd 移交出去，不会随 Connection 析构而关闭，需要显式移出 epoll
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, it->first, nullptr);
+        it->second->releaseFd();
+        onClose_(it->second->id());
+    }
+    connections_.erase(it);
+}
+
+Connection *TcpServer::findConnection(uint64_t id)
+{
+    auto it = connections_.find(connectionFd(id));
+    if (it == connections_.end() || it->second->id() != id)
+        return nullptr;
+    return it->second.get();
+}
+
+bool TcpServer::enableSharedMemory(const std::string &prefix, uint32_t slots, size_t ringSize)
+{
+    for (uint32_t i = 0; i < slots; ++i)
+    {
+        auto slot = std::make_unique<ShmSlot>();
+        std::string name = ShmSlot::name(prefix, i);
+        if (!slot->create(name, ringSize))
+        {
+            spdlog::critical("Cannot create shared memory slot {}: {}", name, strerror(errno));
+            shmSlots_.clear();
+            return false;
+        }
+        shmSlots_.push_back(std::move(slot));
+    }
+    nextShmReap_ = std::chrono::steady_clock::now();
+    spdlog::info("Shared memory transport on {}-[0..{}], ring size {} bytes", prefix, slots - 1, ringSize);
+    return true;
+}
+
+bool TcpServer::pollSharedMemory()
+{
+    bool received = false;
+    // 客户端进程异常退出时不会走 CLOSED，按 pid 定期回收
+    auto now = std::chrono::steady_clock::now();
+    bool reap = now >= nextShmReap_;
+    if (reap)
+        nextShmReap_ = now + std::chrono::seconds(1);
+
+    for (size_t i = 0; i < shmSlots_.size(); ++i)
+    {
+        ShmSlotHeader *header = shmSlots_[i]->header();
+        auto state = static_cast<ShmSlotState>(header->state.load(std::memory_order_acquire));
+        if (state == ShmSlotState::FREE)
+            continue;
+        int key = shmKey(i);
+        auto it = connections_.find(key);
+
+        if (state == ShmSlotState::ACTIVE && it != connections_.end())
+        {
+            Connection *conn = it->second.get();
+            // 暂停读取的会话在客户端取走回报后恢复（没有 EPOLLOUT 触发 flush）
+            if (conn->readPaused())
+                conn->maybeResumeRead();
+            if (!conn->readPaused() && conn->shmSlot()->toEngine().readable() > 0)
+            {
+                readConnection(conn);
+                received = true;
+            }
+        }
+        else if (state == ShmSlotState::REQUESTED)
+        {
+            if (it != connections_.end())
+                closeConnection(it); // 上一个会话的残留，不会发生在正常关闭流程中
+            shmSlots_[i]->resetRings();
+            uint32_t expected = static_cast<uint32_t>(ShmSlotState::REQUESTED);
+            if (!header->state.compare_exchange_strong(expected, static_cast<uint32_t>(ShmSlotState::ACTIVE),
+                                                       std::memory_order_acq_rel))
+                continue; // 客户端等待超时已放弃，下一轮按 CLOSED 回收
+            uint64_t connId = makeConnectionId(reactor_, nextConnSeq_++, key);
+            connections_[key] = std::make_unique<Connection>(
+                shmSlots_[i].get(), key, connId, messageCallback_, connOptions_,
+                [this](Connection *conn)
+                { pendingFlush_.push_back(conn->id()); });
+            ++shmSessions_;
+            spdlog::info("New shared memory session on slot {} from pid {}", i,
+                         header->client_pid.load(std::memory_order_relaxed));
+            if (onOpen_)
+                onOpen_(connId);
+            continue;
+        }
+        else if (state == ShmSlotState::CLOSED)
+        {
+            spdlog::info("Shared memory session closed by client: slot {}", i);
+            if (it != connections_.end())
+                closeConnection(it);
+            header->state.store(static_cast<uint32_t>(ShmSlotState::FREE), std::memory_order_release);
+            continue;
+        }
+
+        if (reap)
+        {
+            pid_t pid = header->client_pid.load(std::memory_order_relaxed);
+            if (pid > 0 && kill(pid, 0) == -1 && errno == ESRCH)
+            {
+                spdlog::info("Shared memory client pid {} exited, releasing slot {}", pid, i);
+                it = connections_.find(key);
+                if (it != connections_.end())
+                    closeConnection(it);
+                header->state.store(static_cast<uint32_t>(ShmSlotState::FREE), std::memory_order_release);
+            }
+        }
+    }
+    return received;
+}
+
+void TcpServer::releaseSharedMemory(int key)
+{
+    // 引擎主动断开时通知客户端；客户端已经置了 CLOSED 时由调用方回收为 FREE
+    ShmSlotHeader *header = shmSlots_[shmSlotIndex(key)]->header();
+    uint32_t expected = static_cast<uint32_t>(ShmSlotState::ACTIVE);
+    header->state.compare_exchange_strong(expected, static_cast<uint32_t>(ShmSlotState::DISCONNECTED),
+                                          std::memory_order_acq_rel);
+    --shmSessions_;
+}
+
+void TcpServer::runUringLoop()
+{
+    std::vector<uint64_t> carryOver;
+    std::vector<uint64_t> readable;
+    spdlog::info("Starting io_uring event loop {}...", reactor_);
+    LATENCY_TRACE_ONLY(LatencyTrace::setThreadName("io " + std::to_string(reactor_)));
+    IdleSpinner spinner(threadOptions_);
+    while (!stopping_.load(std::memory_order_acquire))
+    {
+        // 上一轮准备的 recv / writev / 取消在这里一次提交，同时等待完成事件
+        int timeout = waitTimeout(spinner, !carryOver.empty());
+        int ret = ring_->submitAndWait(timeout == 0 ? 0 : 1, timeout);
+        LATENCY_TRACE_STAMP(wakeup);
+        if (ret < 0)
+        {
+            spdlog::critical("io_uring_enter failed: {}", strerror(-ret));
+            break;
+        }
+        unsigned completions = ring_->forEachCqe([this](const io_uring_cqe &cqe)
+                                                 { handleCompletion(cqe); });
+
+        // 完成事件只把数据挂到连接上；每个连接每轮读一次，批量上限与 epoll 后端一致
+        readable.swap(uringReadable_);
+        for (uint64_t id : readable)
+        {
+            Connection *conn = findConnection(id);
+            if (!conn)
+                continue;
+            UringConn &state = *uringConns_[conn->fd()];
+            state.readQueued = false;
+            if (conn->readPaused())
+            {
+                cancelRecv(conn, state);
+                continue;
+            }
+            LATENCY_TRACE_RECORD(EPOLL_DISPATCH, wakeup);
+            readConnection(conn);
+        }
+        readable.clear();
+
+        bool active = completions > 0 || !carryOver.empty();
+        if (!carryOver.empty())
+        {
+            for (uint64_t id : carryOver)
+            {
+                Connection *conn = findConnection(id);
+                if (conn && !conn->readPaused())
+                    readConnection(conn);
+            }
+            carryOver.clear();
+        }
+        finishIteration(spinner, active);
+
+        flushPending();
+        rearmReceives();
+        ring_->publishBuffers();
+        carryOver.swap(pendingRead_);
     }
 }
 
+void TcpServer::handleCompletion(const io_uring_cqe &cqe)
+{
+    switch (static_cast<UringOp>(cqe.user_data >> 56))
+    {
+    case UringOp::ACCEPT:
+        if (cqe.res >= 0)
+        {
+            struct sockaddr_in clientAddr{};
+            socklen_t clientLen = sizeof(clientAddr);
+            getpeername(cqe.res, (struct sockaddr *)&clientAddr, &clientLen);
+            spdlog::info("New connection from {}:{}", inet_ntoa(clientAddr.sin_addr), ntohs(clientAddr.sin_port));
+            addConnection(cqe.res);
+        }
+        else
+        {
+            spdlog::error("Accept error: {}", strerror(-cqe.res));
+        }
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+            armAccept();
+        break;
+    case UringOp::RECV:
+        handleRecvCompletion(cqe);
+        break;
+    case UringOp::SEND:
+        handleSendCompletion(cqe);
+        break;
+    case UringOp::POLL:
+    {
+        int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+        auto src = eventSources_.find(fd);
+        if (src == eventSources_.end())
+            break;
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+            armEventSource(fd);
+        src->second();
+        break;
+    }
+    case UringOp::CANCEL:
+        break; // 取消的结果体现在被取消的 recv 的完成事件上
+    }
+}
+
+void TcpServer::handleRecvCompletion(const io_uring_cqe &cqe)
+{
+    uint64_t id = uringConnId(cqe.user_data);
+    bool hasBuffer = cqe.flags & IORING_CQE_F_BUFFER;
+    auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    if (hasBuffer)
+        ++buffersHeld_;
+    Connection *conn = findConnection(id);
+    if (!conn)
+    {
+        // 连接已关闭，关闭前已在途的完成事件
+        if (hasBuffer)
+            releaseBuffer(bid);
+        return;
+    }
+    UringConn &state = *uringConns_[conn->fd()];
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+    if (!more)
+    {
+        state.recvArmed = false;
+        state.canceling = false;
+    }
+
+    if (cqe.res > 0)
+    {
+        state.backlog.push_back({bid, 0, static_cast<uint32_t>(cqe.res)});
+        if (!state.readQueued)
+        {
+            state.readQueued = true;
+            uringReadable_.push_back(id);
+        }
+        if (!more)
+            uringRearm_.push_back(id);
+        return;
+    }
+    if (hasBuffer)
+        releaseBuffer(bid);
+    // 提供缓冲区耗尽或暂停读取时被取消：连接仍然有效，条件允许时重新提交
+    if (cqe.res == -ENOBUFS || cqe.res == -ECANCELED)
+    {
+        if (!more)
+            uringRearm_.push_back(id);
+        return;
+    }
+
+    if (cqe.res == 0)
+        spdlog::info("Client disconnected: fd={}", conn->fd());
+    else
+        spdlog::error("Read error on fd={}: {}", conn->fd(), strerror(-cqe.res));
+    closeConnection(connections_.find(conn->fd()));
+}
+
+void TcpServer::handleSendCompletion(const io_uring_cqe &cqe)
+{
+    uint64_t id = uringConnId(cqe.user_data);
+    auto retired = retired_.find(id);
+    if (retired != retired_.end())
+    {
+        retired_.erase(retired); // 已关闭的连接最后一次写出完成，此时才析构并关闭 fd
+        return;
+    }
+    Connection *conn = findConnection(id);
+    if (!conn)
+        return;
+    uringConns_[conn->fd()]->sendInFlight = false;
+    if (cqe.res < 0)
+    {
+        spdlog::error("Write error on fd={}: {}", conn->fd(), strerror(-cqe.res));
+        closeConnection(connections_.find(conn->fd()));
+        return;
+    }
+    conn->consumeOutput(static_cast<size_t>(cqe.res));
+    // 余下的数据（含在途期间新追加的回报）与恢复读取都在批末 flushPending 中处理，保证写在日志提交之后
+    if (!conn->flushScheduled())
+    {
+        conn->markFlushScheduled();
+        pendingFlush_.push_back(id);
+    }
+}
+
+OutputBuffer::FlushResult TcpServer::submitSend(Connection *conn)
+{
+    UringConn &state = *uringConns_[conn->fd()];
+    if (state.sendInFlight)
+        return OutputBuffer::FlushResult::PENDING; // 完成后再发送余下部分
+    unsigned count = conn->outputSegments(state.iov);
+    if (count == 0)
+        return OutputBuffer::FlushResult::DONE;
+    IoUring::prepWritev(uringSqe(), conn->fd(), state.iov, count, uringData(UringOp::SEND, conn->id()));
+    state.sendInFlight = true;
+    return OutputBuffer::FlushResult::PENDING;
+}
+
+void TcpServer::armAccept()
+{
+    IoUring::prepMultishotAccept(uringSqe(), listenFd_, uringData(UringOp::ACCEPT, static_cast<uint32_t>(listenFd_)));
+}
+
+void TcpServer::armRecv(Connection *conn, UringConn &state)
+{
+    IoUring::prepMultishotRecv(uringSqe(), conn->fd(), 0, uringData(UringOp::RECV, conn->id()));
+    state.recvArmed = true;
+}
+
+void TcpServer::armEventSource(int fd)
+{
+    IoUring::prepMultishotPoll(uringSqe(), fd, uringData(UringOp::POLL, static_cast<uint32_t>(fd)));
+}
+
+void TcpServer::cancelRecv(Connection *conn, UringConn &state)
+{
+    if (!state.recvArmed || state.canceling)
+        return;
+    IoUring::prepCancel(uringSqe(), uringData(UringOp::RECV, conn->id()), uringData(UringOp::CANCEL, conn->id()));
+    state.canceling = true;
+}
+
+void TcpServer::rearmReceives()
+{
+    size_t count = uringRearm_.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t id = uringRearm_[i];
+        Connection *conn = findConnection(id);
+        if (!conn)
+            continue;
+        UringConn &state = *uringConns_[conn->fd()];
+        if (state.recvArmed || conn->readPaused() || conn->shouldClose())
+            continue;
+        if (buffersHeld_ >= ring_->bufferCount())
+        {
+            // 缓冲区全部积压在各连接中：等它们被处理、归还后再提交，避免 ENOBUFS 空转
+            uringRearm_.push_back(id);
+            continue;
+        }
+        armRecv(conn, state);
+    }
+    uringRearm_.erase(uringRearm_.begin(), uringRearm_.begin() + static_cast<std::ptrdiff_t>(count));
+}
+
+void TcpServer::releaseBuffer(uint16_t bid)
+{
+    ring_->recycleBuffer(bid);
+    --buffersHeld_;
+}
+
+io_uring_sqe *TcpServer::uringSqe()
+{
+    io_uring_sqe *sqe = ring_->getSqe();
+    if (!sqe)
+    {
+        spdlog::critical("io_uring submission queue full");
+        exit(1);
+    }
+    return sqe;
+}
+
 void TcpServer::start()
 {
-    runEventLoop();
-}
\ No newline at end of file
+    applyThreadOptions("io " + std::to_string(reactor_), threadOptions_);
+    if (stopFd_ != -1)
+    {
+        addEventSource(stopFd_, [this]
+                       {
+            uint64_t value;
+            ssize_t n = read(stopFd_, &value, sizeof(value));
+            (void)n; });
+    }
+    if (ring_)
+        runUringLoop();
+    else
+        runEventLoop();
+}
+
+void TcpServer::stop()
+{
+    stopping_.store(true, std::memory_order_release);
+    if (stopFd_ != -1)
+    {
+        uint64_t one = 1;
+        ssize_t n = write(stopFd_, &one, sizeof(one));
+        (void)n;
+    }
+}
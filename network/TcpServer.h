@@ -1,25 +1,165 @@
 #pragma once
 #include <sys/epoll.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <unordered_map>
 #include <memory>
+#include <string>
+#include <vector>
 #include "Connection.h"
+#include "ShmRing.h"
+#include "utils/ThreadTuning.h"
 
-using MessageCallback = std::function<void(Connection *, MessageType, const std::vector<uint8_t> &)>;
+using MessageCallback = Connection::MessageCallback;
 
+class IoUring;
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+// I/O 后端：epoll 就绪通知 + 非阻塞 recv / writev，或 io_uring 完成通知
+// （多发 accept、多发 recv 收进共享的提供缓冲区环、writev 批量提交，每轮一次 io_uring_enter）
+enum class IoBackend : uint8_t
+{
+    EPOLL,
+    IO_URING
+};
+
+struct IoBackendOptions
+{
+    IoBackend backend = IoBackend::EPOLL;
+    unsigned uring_entries = 4096;      // 提交队列深度
+    unsigned uring_buffers = 1024;      // 提供缓冲区个数（2 的幂），本反应器的所有连接共享
+    unsigned uring_buffer_size = 16384; // 每个提供缓冲区的字节数
+};
+
+// 单线程反应器：一个监听 socket、一个 epoll 实例、一张连接表，start() 在调用线程上运行事件循环。
+// 多反应器模式下每个 I/O 线程各有一个 TcpServer，reactor 为其下标（写入连接 ID），
+// reusePort 时各自以 SO_REUSEPORT 监听同一端口，由内核按四元组哈希把新连接分给各线程。
+// io_uring 后端初始化失败（内核过旧或被禁用）时记录警告并退回 epoll
 class TcpServer
 {
 public:
-    explicit TcpServer(int port, MessageCallback cb);
+    TcpServer(int port, MessageCallback cb, const ConnectionOptions &options = ConnectionOptions{},
+              uint32_t reactor = 0, bool reusePort = false, const IoBackendOptions &backend = IoBackendOptions{});
     ~TcpServer();
+    // 在调用线程上运行事件循环，直到 stop()
     void start();
+    // 可在任何线程调用：唤醒事件循环，当前一轮处理完后 start() 返回
+    void stop();
+
+    // 新连接序号的起点（写入连接 ID），start() 之前调用
+    void setFirstConnectionSeq(uint64_t seq) { nextConnSeq_ = seq; }
+
+    // 注册额外的可读事件源（如撮合线程的回报 eventfd），在事件循环线程上回调
+    void addEventSource(int fd, std::function<void()> handler);
+    // 按连接 ID 查找，连接已关闭返回 nullptr
+    Connection *findConnection(uint64_t id);
+    // 连接建立 / 断开通知。设置了 onClose 时，断开的 fd 由 onClose 的接收方负责关闭
+    void setConnectionHooks(std::function<void(uint64_t)> onOpen, std::function<void(uint64_t)> onClose);
+    // 每轮事件循环处理完所有可读事件、写出回报之前调用（批量唤醒撮合线程、提交预写日志）
+    void setBatchEndHook(std::function<void()> hook) { onBatchEnd_ = std::move(hook); }
+    // 事件循环线程的绑核 / 调度 / 空闲策略，start() 时在该线程上生效。非 BLOCK 策略下循环从不阻塞
+    void setThreadOptions(const ThreadOptions &options) { threadOptions_ = options; }
+    // 每轮事件循环写出回报之前调用，返回是否取到了工作（空转模式下代替 eventfd 轮询撮合线程的回报）
+    void setPollHook(std::function<bool()> hook) { pollHook_ = std::move(hook); }
+    // 开启同机共享内存传输：创建 <prefix>-0 .. <prefix>-(slots-1) 共 slots 个会话槽位，
+    // 每条环 ringSize 字节。会话与 TCP 连接走同一套回调、批处理与回报路径。失败返回 false
+    bool enableSharedMemory(const std::string &prefix, uint32_t slots, size_t ringSize);
+
+    IoBackend backend() const { return ring_ ? IoBackend::IO_URING : IoBackend::EPOLL; }
 
 private:
     void handleAccept();
+    // 新连接加入连接表（epoll 注册或 io_uring 多发 recv 由后端各自完成）
+    void addConnection(int clientFd);
     void runEventLoop();
+    void closeConnection(std::unordered_map<int, std::unique_ptr<Connection>>::iterator it);
+    void readConnection(Connection *conn);
+    void flushPending();
+    // 一轮事件循环的收尾：共享内存轮询、轮询钩子、空闲策略。active 表示本轮已经处理过事件
+    void finishIteration(IdleSpinner &spinner, bool active);
+    // 本轮等待的超时：有积压或非阻塞策略时为 0
+    int waitTimeout(const IdleSpinner &spinner, bool carryOver) const;
+    void flushConnection(Connection *conn);
+    void updateWriteInterest(Connection *conn);
+    // 轮询各槽位的状态与请求环，返回是否读到了新的请求
+    bool pollSharedMemory();
+    void releaseSharedMemory(int key);
+    // 共享内存会话在连接表中的键为负数，不与 socket fd 冲突
+    static int shmKey(size_t slot) { return -static_cast<int>(slot) - 1; }
+    static size_t shmSlotIndex(int key) { return static_cast<size_t>(-key - 1); }
+
+    // ---- io_uring 后端 ----
+    // user_data 高 8 位是操作类型，低 56 位是连接 ID 去掉反应器下标（或 fd）
+    enum class UringOp : uint8_t
+    {
+        ACCEPT = 1,
+        RECV,
+        SEND,
+        POLL,
+        CANCEL
+    };
+    struct UringChunk
+    {
+        uint16_t bid;    // 提供缓冲区编号
+        uint32_t offset; // 已拷入连接接收缓冲区的字节数
+        uint32_t len;
+    };
+    // 每个 socket 连接的 io_uring 状态
+    struct UringConn
+    {
+        std::deque<UringChunk> backlog; // 已收到、尚未拷入接收缓冲区的数据（持有提供缓冲区）
+        bool recvArmed = false;         // 多发 recv 仍在进行
+        bool canceling = false;         // 暂停读取，已提交取消
+        bool readQueued = false;        // 本轮已加入 uringReadable_
+        bool sendInFlight = false;      // 每个连接同时只有一个 writev
+        iovec iov[2];                   // 在途 writev 的 iovec，完成前不能移动
+    };
+    static uint64_t uringData(UringOp op, uint64_t id) { return static_cast<uint64_t>(op) << 56 | (id & ((1ull << 56) - 1)); }
+    uint64_t uringConnId(uint64_t data) const { return static_cast<uint64_t>(reactor_) << 56 | (data & ((1ull << 56) - 1)); }
+    void runUringLoop();
+    void handleCompletion(const io_uring_cqe &cqe);
+    void handleRecvCompletion(const io_uring_cqe &cqe);
+    void handleSendCompletion(const io_uring_cqe &cqe);
+    void armAccept();
+    void armRecv(Connection *conn, UringConn &state);
+    void armEventSource(int fd);
+    // 暂停读取的连接取消多发 recv，不再占用提供缓冲区
+    void cancelRecv(Connection *conn, UringConn &state);
+    void rearmReceives();
+    OutputBuffer::FlushResult submitSend(Connection *conn);
+    void releaseBuffer(uint16_t bid);
+    io_uring_sqe *uringSqe();
+    std::unique_ptr<IoUring> ring_;
+    std::unordered_map<int, std::unique_ptr<UringConn>> uringConns_;
+    // 关闭时仍有 writev 在途的连接，等写完成事件到达后再析构（iovec 指向其发送缓冲区）
+    std::unordered_map<uint64_t, std::pair<std::unique_ptr<Connection>, std::unique_ptr<UringConn>>> retired_;
+    std::vector<uint64_t> uringReadable_; // 本轮收到数据的连接 ID
+    std::vector<uint64_t> uringRearm_;    // 多发 recv 已结束、待重新提交的连接 ID
+    unsigned buffersHeld_ = 0;            // 积压在各连接 backlog 中的提供缓冲区数
     MessageCallback messageCallback_;
     int listenFd_;
     int epollFd_;
     int port_;
+    uint32_t reactor_;
     std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    std::unordered_map<int, std::function<void()>> eventSources_;
+    int stopFd_;                       // stop() 写入的 eventfd，唤醒阻塞中的事件循环
+    std::atomic<bool> stopping_{false};
+    uint64_t nextConnSeq_ = 1;
+    ConnectionOptions connOptions_;
+    std::vector<uint64_t> pendingFlush_; // 本轮有待发送数据的连接 ID
+    std::vector<uint64_t> pendingRead_;  // 达到批量上限、还有数据未处理的连接 ID
+    std::function<void()> onBatchEnd_;
+    std::function<bool()> pollHook_;
+    ThreadOptions threadOptions_;
+    std::function<void(uint64_t)> onOpen_;
+    std::function<void(uint64_t)> onClose_;
+    std::vector<std::unique_ptr<ShmSlot>> shmSlots_;
+    size_t shmSessions_ = 0; // ACTIVE 会话数，大于 0 时事件循环不阻塞
+    std::chrono::steady_clock::time_point nextShmReap_;
     static const int MAX_EVENTS = 1024;
+    static const int SHM_IDLE_POLL_MS = 10; // 没有共享内存会话时检查新会话请求的间隔
 };
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "protocol/WireMessages.h"
+
+// 行情线上格式（小端、紧凑）。UDP 每个数据报是一个包；TCP 上是连续的包，
+// 包长由 count 推出：sizeof(MdPacketHeader) + count * sizeof(MdMessage)。
+//
+//   INCREMENTAL 包：seq 为包内第一条消息的序号，其后的消息依次加一，收端据此检测丢包
+//   SNAPSHOT 包：   全量深度，seq 为快照反映的最后一条增量序号。一轮快照以 SNAPSHOT_BEGIN 开头，
+//                   其 quantity 为随后的价位条数，可跨多个包
+//   TOP_OF_BOOK 包：按固定间隔合并后的最优买卖价，seq 含义同 SNAPSHOT，只包含有变化的品种
+//
+// 后加入的订阅者先缓存增量，收到快照后丢弃 seq 不大于快照 seq 的增量再继续应用。
+//
+// 枚举与结构体的定义在 protocol/messages.schema 中，由其生成的 WireMessages.h 提供
+using wire::MdMessage;
+using wire::MdPacketHeader;
+using wire::MdSubscribeRequest;
+
+// 单个包不超过以太网 MTU（去掉 IP / UDP 头）
+constexpr size_t MD_MAX_PACKET = 1400;
+constexpr size_t MD_MAX_MESSAGES = (MD_MAX_PACKET - sizeof(MdPacketHeader)) / sizeof(MdMessage);
@@ -2,20 +2,28 @@
 #include <vector>
 #include <cstdint>
 #include <optional>
-#include "MessageType.h"
+#include "protocol/WireMessages.h"
+#include "PayloadView.h"
+
+struct FrameView
+{
+    MessageType type;
+    PayloadView payload;
+};
 class MessageCodec
 {
 public:
     // 编码：将 payload 打包成完整帧
     static std::vector<uint8_t> encode(MessageType type, const std::vector<uint8_t>& payload);
+    // 只写帧头（HEADER_SIZE 字节），payload 由调用方紧随其后写入
+    static void encodeHeader(uint8_t *out, MessageType type, uint16_t payloadLen);
 
-    // 解码：返回 (type, payload)
-    static std::optional<std::pair<MessageType, std::vector<uint8_t>>> decode(
-        const std::vector<uint8_t>& buffer,
-        size_t& readIndex
-    );
+    // 解码 [data, data + available) 开头的一帧，payload 直接指向输入缓冲区（零拷贝）。
+    // 成功时 consumed 为整帧长度；半包返回 nullopt 且 consumed = 0；
+    // magic 非法时丢弃全部已收数据：返回 nullopt 且 consumed = available
+    static std::optional<FrameView> decode(const uint8_t *data, size_t available, size_t &consumed);
 
-private:
-    static constexpr uint32_t MAGIC = 0xABCDEF00;
-    static constexpr size_t HEADER_SIZE = 7; // 4 (magic) + 2 (length)+1 (type)
+    static constexpr size_t HEADER_SIZE = sizeof(wire::FrameHeader); // 4 (magic) + 2 (length)+1 (type)
+    // 单帧最大长度（length 字段为 uint16），接收缓冲区不能小于它
+    static constexpr size_t MAX_FRAME_SIZE = HEADER_SIZE + 0xFFFF;
 };
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// 指向接收缓冲区内某帧 payload 的只读视图，不持有内存。
+// 只在消息回调期间有效，回调返回后缓冲区可能被新数据覆盖。
+struct PayloadView
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    const uint8_t &operator[](size_t i) const { return data[i]; }
+    bool empty() const { return size == 0; }
+
+    // 定长消息：长度恰好为 sizeof(T) 时把 payload 原地视为线上结构 T（WireMessages.h），否则返回 nullptr
+    template <typename T>
+    const T *as() const
+    {
+        return size == sizeof(T) ? reinterpret_cast<const T *>(data) : nullptr;
+    }
+};
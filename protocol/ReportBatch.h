@@ -0,0 +1,53 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "MessageCodec.h"
+#include "core/ExecutionReport.h"
+
+// 批量回报帧的暂存区：批量指令产生的回报逐条编码进同一帧
+// （wire::ExecutionReportBatch：count + count 条 wire::ExecutionReport），批末整帧发出。
+// 缓冲区构造时一次分配，之后复用。单帧容量受帧长字段与发送缓冲区大小限制，
+// 回报更多时由调用方在 full() 时先把已满的一帧发出
+class ReportBatch
+{
+public:
+    static constexpr size_t COUNT_SIZE = sizeof(wire::ExecutionReportBatch);
+    static constexpr size_t MAX_REPORTS = (0xFFFF - COUNT_SIZE) / ExecutionReport::WIRE_SIZE;
+
+    // outputBufferSize: 连接发送缓冲区大小，单帧不超过其 1/4，不会独自触发慢消费者处理
+    explicit ReportBatch(size_t outputBufferSize)
+        : capacity_(std::max<size_t>(1, std::min(MAX_REPORTS, outputBufferSize / 4 / ExecutionReport::WIRE_SIZE))),
+          frame_(MessageCodec::HEADER_SIZE + COUNT_SIZE + capacity_ * ExecutionReport::WIRE_SIZE)
+    {
+    }
+
+    bool full() const { return count_ == capacity_; }
+    uint16_t count() const { return count_; }
+
+    void add(const ExecutionReport &report)
+    {
+        report.serializeTo(frame_.data() + MessageCodec::HEADER_SIZE + COUNT_SIZE +
+                           static_cast<size_t>(count_) * ExecutionReport::WIRE_SIZE);
+        ++count_;
+    }
+
+    // 补全帧头与条数，返回整帧；count 为 0 时也是合法的空帧（批量撤单没有撤到任何订单）
+    const uint8_t *frame()
+    {
+        MessageCodec::encodeHeader(frame_.data(), MessageType::EXECUTION_REPORT_BATCH,
+                                   static_cast<uint16_t>(payloadSize()));
+        reinterpret_cast<wire::ExecutionReportBatch *>(frame_.data() + MessageCodec::HEADER_SIZE)->count = count_;
+        return frame_.data();
+    }
+    size_t frameSize() const { return MessageCodec::HEADER_SIZE + payloadSize(); }
+
+    void clear() { count_ = 0; }
+
+private:
+    size_t payloadSize() const { return COUNT_SIZE + static_cast<size_t>(count_) * ExecutionReport::WIRE_SIZE; }
+
+    size_t capacity_;
+    uint16_t count_ = 0;
+    std::vector<uint8_t> frame_;
+};
@@ -0,0 +1,385 @@
+"""线上消息 schema（protocol/messages.schema）的解析与代码生成。
+
+    python3 wiregen.py messages.schema --cpp WireMessages.h   # 构建时由 CMake 调用
+
+C++ 侧生成紧凑、可平凡拷贝的结构体，每个字段的偏移都有 static_assert 校验，
+收到的 payload 长度核对后直接按结构体原地访问，不逐字段拷贝。
+Python 侧不落地生成文件：客户端脚本 import 本模块，调用 load() 在加载时按同一份 schema 生成编解码器，
+
+    wire = wiregen.load()
+    wire.frame(wire.NewOrder, user_id='u1', order_id='O1', side=wire.OrderSide.BUY, price=10.0, quantity=5)
+    wire.ExecutionReport.unpack(payload)   # -> {'order_id': 'O1', 'exec_type': 0, 'leaves_qty': 5}
+"""
+import enum
+import os
+import re
+import struct
+import sys
+import types
+
+SCHEMA_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'messages.schema')
+
+# schema 类型 -> (C++ 类型, struct 格式字符)
+PRIMITIVES = {
+    'uint8': ('uint8_t', 'B'),
+    'uint16': ('uint16_t', 'H'),
+    'uint32': ('uint32_t', 'I'),
+    'uint64': ('uint64_t', 'Q'),
+    'int32': ('int32_t', 'i'),
+    'int64': ('int64_t', 'q'),
+    'double': ('double', 'd'),
+}
+
+
+class SchemaError(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, name, kind, comment, length=0, entry=None, count=None):
+        self.name = name
+        self.kind = kind        # 基本类型名，'char' 或 'group'
+        self.comment = comment
+        self.length = length    # char[N] 的 N
+        self.entry = entry      # 重复组的条目结构
+        self.count = count      # 重复组的计数字段名
+        self.offset = 0
+
+    @property
+    def size(self):
+        if self.kind == 'char':
+            return self.length
+        return struct.calcsize('<' + PRIMITIVES[self.kind][1])
+
+
+class StructDef:
+    def __init__(self, name, doc, message=None, type_id=None, type_comment=''):
+        self.name = name
+        self.doc = doc
+        self.message = message  # MessageType 中的名字，不是独立消息时为 None
+        self.type_id = type_id
+        self.type_comment = type_comment
+        self.fields = []
+        self.group = None
+        self.size = 0
+
+
+class Schema:
+    def __init__(self):
+        self.consts = []    # (名字, 类型, 值)
+        self.enums = []     # (名字, 底层类型, 说明, [(值名, 值, 说明)])
+        self.structs = []   # StructDef，按声明顺序
+        self.messages = []  # (类型名, 编号, 说明, StructDef 或 None)
+
+    def struct_named(self, name):
+        for s in self.structs:
+            if s.name == name:
+                return s
+        return None
+
+
+def _split_comment(line):
+    code, _, comment = line.partition('#')
+    return code.strip(), comment.strip()
+
+
+def parse(path=SCHEMA_PATH):
+    schema = Schema()
+    doc = []
+    with open(path, encoding='utf-8') as f:
+        lines = list(enumerate(f, 1))
+    i = 0
+
+    def fail(lineno, msg):
+        raise SchemaError(f'{path}:{lineno}: {msg}')
+
+    def body():
+        # 读取 { ... } 内的行，返回 [(行号, 代码, 行尾注释)]
+        nonlocal i
+        items = []
+        while i < len(lines):
+            lineno, raw = lines[i]
+            i += 1
+            code, comment = _split_comment(raw)
+            if code == '}':
+                return items
+            if code:
+                items.append((lineno, code, comment))
+        fail(lines[-1][0], 'missing }')
+
+    while i < len(lines):
+        lineno, raw = lines[i]
+        i += 1
+        stripped = raw.strip()
+        if not stripped:
+            doc = []
+            continue
+        if stripped.startswith('#'):
+            doc.append(stripped[1:].strip())
+            continue
+        code, comment = _split_comment(raw)
+        words = code.split()
+        if words[0] == 'const' and len(words) == 4 and words[2] in PRIMITIVES:
+            schema.consts.append((words[1], words[2], int(words[3], 0)))
+        elif words[0] == 'enum' and len(words) == 4 and words[3] == '{' and words[2] in PRIMITIVES:
+            values = []
+            for n, text, c in body():
+                m = re.fullmatch(r'(\w+)\s*=\s*(\w+)', text)
+                if not m:
+                    fail(n, f'bad enum value: {text}')
+                values.append((m.group(1), int(m.group(2), 0), c))
+            schema.enums.append((words[1], words[2], doc, values))
+        elif words[0] == 'struct' and len(words) == 3 and words[2] == '{':
+            s = StructDef(words[1], doc)
+            _parse_fields(schema, s, body(), fail)
+            schema.structs.append(s)
+        elif words[0] == 'message':
+            m = re.fullmatch(r'message\s+(\w+)\s*=\s*(\w+)(?:\s+(\w+)\s*\{)?', code)
+            if not m:
+                fail(lineno, f'bad message: {code}')
+            s = None
+            if m.group(3):
+                s = StructDef(m.group(3), doc, m.group(1), int(m.group(2), 0), comment)
+                _parse_fields(schema, s, body(), fail)
+                schema.structs.append(s)
+            schema.messages.append((m.group(1), int(m.group(2), 0), doc, s))
+        else:
+            fail(lineno, f'unknown definition: {code}')
+        doc = []
+
+    names = [s.name for s in schema.structs] + [e[0] for e in schema.enums] + ['MessageType']
+    dup = {n for n in names if names.count(n) > 1}
+    if dup:
+        raise SchemaError(f'{path}: duplicate definitions: {", ".join(sorted(dup))}')
+    ids = [m[1] for m in schema.messages]
+    if len(set(ids)) != len(ids) or not all(0 < v < 256 for v in ids):
+        raise SchemaError(f'{path}: message type ids must be unique and fit in uint8')
+    return schema
+
+
+def _parse_fields(schema, s, items, fail):
+    offset = 0
+    for lineno, text, comment in items:
+        if s.group:
+            fail(lineno, f'{s.name}: repeating group must be the last field')
+        words = text.split()
+        if len(words) != 2:
+            fail(lineno, f'bad field: {text}')
+        name, ftype = words
+        if any(f.name == name for f in s.fields):
+            fail(lineno, f'{s.name}: duplicate field {name}')
+        m = re.fullmatch(r'(\w+)\[(\w+)\]', ftype)
+        if ftype in PRIMITIVES:
+            field = Field(name, ftype, comment)
+        elif m and m.group(1) == 'char' and m.group(2).isdigit():
+            field = Field(name, 'char', comment, length=int(m.group(2)))
+        elif m and schema.struct_named(m.group(1)):
+            counter = next((f for f in s.fields if f.name == m.group(2)), None)
+            if counter is None or counter.kind not in ('uint8', 'uint16', 'uint32'):
+                fail(lineno, f'{s.name}.{name}: count field {m.group(2)} must be an earlier unsigned field')
+            s.group = Field(name, 'group', comment, entry=schema.struct_named(m.group(1)), count=m.group(2))
+            continue
+        else:
+            fail(lineno, f'{s.name}.{name}: unknown type {ftype}')
+        field.offset = offset
+        offset += field.size
+        s.fields.append(field)
+    if not s.fields:
+        fail(items[0][0] if items else 0, f'{s.name}: struct has no fixed fields')
+    s.size = offset
+
+
+# ---------------------------------------------------------------- C++
+
+def _cpp_comment(lines, indent=''):
+    return [f'{indent}// {line}' if line else f'{indent}//' for line in lines]
+
+
+def _cpp_line(code, comment):
+    return f'{code} // {comment}' if comment else code
+
+
+def generate_cpp(schema, source_name='protocol/messages.schema'):
+    out = [
+        f'// 由 protocol/wiregen.py 根据 {source_name} 生成，不要手工修改',
+        '#pragma once',
+        '#include <cstddef>',
+        '#include <cstdint>',
+        '#include <type_traits>',
+        '',
+    ]
+    for name, base, doc, values in schema.enums:
+        out += _cpp_comment(doc)
+        out += [f'enum class {name} : {PRIMITIVES[base][0]}', '{']
+        for j, (vname, value, comment) in enumerate(values):
+            sep = ',' if j + 1 < len(values) else ''
+            out.append(_cpp_line(f'    {vname} = {value}{sep}', comment))
+        out += ['};', '']
+
+    out += ['enum class MessageType : uint8_t', '{']
+    for j, (mname, type_id, _doc, s) in enumerate(schema.messages):
+        sep = ',' if j + 1 < len(schema.messages) else ''
+        comment = s.type_comment if s else ''
+        if not comment and s:
+            comment = f'payload: wire::{s.name}'
+        out.append(_cpp_line(f'    {mname} = {type_id}{sep}', comment))
+    out += ['};', '']
+
+    out += ['namespace wire', '{']
+    for name, ctype, value in schema.consts:
+        out.append(f'constexpr {PRIMITIVES[ctype][0]} {name} = {value:#X};'.replace('0X', '0x'))
+    out += ['', '#pragma pack(push, 1)']
+    for s in schema.structs:
+        out.append('')
+        out += _cpp_comment(s.doc)
+        out += [f'struct {s.name}', '{']
+        if s.message:
+            out.append(f'    static constexpr MessageType TYPE = MessageType::{s.message};')
+        for f in s.fields:
+            if f.kind == 'char':
+                decl = f'    uint8_t {f.name}[{f.length}];'
+            else:
+                decl = f'    {PRIMITIVES[f.kind][0]} {f.name};'
+            out.append(_cpp_line(decl, f.comment))
+        g = s.group
+        if g:
+            e = g.entry.name
+            out += [
+                '',
+                _cpp_line(f'    // 其后紧跟 {g.count} 个 {e}', g.comment),
+                f'    static constexpr size_t sizeFor(size_t n) {{ return sizeof({s.name}) + n * sizeof({e}); }}',
+                f'    const {e} *{g.name}() const {{ return reinterpret_cast<const {e} *>(this + 1); }}',
+                f'    {e} *{g.name}() {{ return reinterpret_cast<{e} *>(this + 1); }}',
+            ]
+        out.append('};')
+    out += ['#pragma pack(pop)', '']
+    for s in schema.structs:
+        out.append(f'static_assert(sizeof({s.name}) == {s.size}, "{s.name} layout is part of the wire format");')
+        out.append(f'static_assert(std::is_trivially_copyable<{s.name}>::value, "{s.name} is accessed in place");')
+        for f in s.fields:
+            out.append(f'static_assert(offsetof({s.name}, {f.name}) == {f.offset}, "{s.name}::{f.name} offset");')
+    out += ['} // namespace wire', '']
+    return '\n'.join(out)
+
+
+def write_if_changed(path, text):
+    # 内容不变时不改动文件时间戳，避免无谓的重新编译
+    try:
+        with open(path, encoding='utf-8') as f:
+            if f.read() == text:
+                return
+    except FileNotFoundError:
+        pass
+    os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+    with open(path, 'w', encoding='utf-8') as f:
+        f.write(text)
+
+
+# ---------------------------------------------------------------- Python
+
+class Codec:
+    """一个结构体的编解码器。char[N] 字段编码时接受 str / bytes，解码为去掉 \\0 填充的 str"""
+
+    def __init__(self, s, codecs):
+        self.name = s.name
+        self.fields = [f.name for f in s.fields]
+        self._chars = {f.name for f in s.fields if f.kind == 'char'}
+        fmt = ''.join(f'{f.length}s' if f.kind == 'char' else PRIMITIVES[f.kind][1] for f in s.fields)
+        self._struct = struct.Struct('<' + fmt)
+        self.size = self._struct.size
+        self.TYPE = None
+        self.group = s.group and (s.group.name, s.group.count, codecs[s.group.entry.name])
+
+    def pack(self, **values):
+        """未给出的字段填 0；重复组以条目列表（dict 或已编码的 bytes）给出，计数字段自动填写"""
+        entries = b''
+        if self.group:
+            name, count, entry = self.group
+            items = values.pop(name, [])
+            values[count] = len(items)
+            entries = b''.join(e if isinstance(e, (bytes, bytearray)) else entry.pack(**e) for e in items)
+        unknown = set(values) - set(self.fields)
+        if unknown:
+            raise TypeError(f'{self.name}: unknown fields {sorted(unknown)}')
+        args = []
+        for name in self.fields:
+            v = values.get(name, b'' if name in self._chars else 0)
+            if name in self._chars and isinstance(v, str):
+                v = v.encode('utf-8')
+            args.append(v)
+        return self._struct.pack(*args) + entries
+
+    def unpack(self, data, offset=0):
+        """解码 data[offset:] 开头的一条；重复组解码为条目 dict 的列表"""
+        msg = dict(zip(self.fields, self._struct.unpack_from(data, offset)))
+        for name in self._chars:
+            msg[name] = msg[name].split(b'\0', 1)[0].decode('utf-8', 'replace')
+        if self.group:
+            name, count, entry = self.group
+            base = offset + self.size
+            msg[name] = [entry.unpack(data, base + k * entry.size) for k in range(msg[count])]
+        return msg
+
+
+def load(path=SCHEMA_PATH):
+    """按 schema 生成 Python 编解码器，返回的命名空间里有常量、枚举（IntEnum）、
+    每个结构体的 Codec，以及帧的编解码函数 frame() / parse_frame()"""
+    schema = parse(path)
+    ns = types.SimpleNamespace()
+    for name, _ctype, value in schema.consts:
+        setattr(ns, name, value)
+    for name, _base, _doc, values in schema.enums:
+        setattr(ns, name, enum.IntEnum(name, [(v[0], v[1]) for v in values]))
+    ns.MessageType = enum.IntEnum('MessageType', [(m[0], m[1]) for m in schema.messages])
+    codecs = {}
+    for s in schema.structs:
+        codec = Codec(s, codecs)
+        if s.message:
+            codec.TYPE = ns.MessageType[s.message]
+        codecs[s.name] = codec
+        setattr(ns, s.name, codec)
+    ns.codecs = {c.TYPE: c for c in codecs.values() if c.TYPE is not None}
+    header = codecs['FrameHeader']
+    ns.HEADER_SIZE = header.size
+
+    def frame(msg, **values):
+        """编码一整帧。msg 为消息的 Codec（payload 由 values 编码）或 MessageType（values 里给 payload=bytes）"""
+        if isinstance(msg, Codec):
+            msg_type, payload = msg.TYPE, msg.pack(**values)
+        else:
+            msg_type, payload = msg, values.get('payload', b'')
+        return header.pack(magic=ns.FRAME_MAGIC, length=len(payload), type=msg_type) + payload
+
+    def parse_frame(data, offset=0):
+        """解码 data[offset:] 开头的一帧，返回 (MessageType 或未知的编号, payload, 帧长)；半包返回 None"""
+        if len(data) - offset < header.size:
+            return None
+        h = header.unpack(data, offset)
+        if h['magic'] != ns.FRAME_MAGIC:
+            raise ValueError(f"invalid magic {h['magic']:08x}")
+        end = offset + header.size + h['length']
+        if len(data) < end:
+            return None
+        msg_type = ns.MessageType(h['type']) if h['type'] in ns.MessageType._value2member_map_ else h['type']
+        return msg_type, bytes(data[offset + header.size:end]), end - offset
+
+    ns.frame = frame
+    ns.parse_frame = parse_frame
+    return ns
+
+
+def main(argv):
+    if len(argv) != 4 or argv[2] != '--cpp':
+        print(f'usage: {argv[0]} SCHEMA --cpp OUTPUT', file=sys.stderr)
+        return 2
+    try:
+        schema = parse(argv[1])
+    except SchemaError as e:
+        print(e, file=sys.stderr)
+        return 1
+    write_if_changed(argv[3], generate_cpp(schema))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,135 @@
+// 事件日志解码工具：把 EventLog 写出的二进制文件转成文本，每条记录一行
+// 用法：eventlog_decode <events.bin>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include "utils/EventLog.h"
+
+namespace
+{
+const char *sideName(uint8_t side)
+{
+    return side == 1 ? "BUY" : "SELL";
+}
+
+const char *orderTypeName(uint8_t type)
+{
+    static const char *names[] = {"LIMIT", "MARKET", "IOC", "FOK"};
+    return type < sizeof(names) / sizeof(names[0]) ? names[type] : "UNKNOWN";
+}
+
+const char *massCancelScopeName(uint8_t scope)
+{
+    return scope == 0 ? "SESSION" : scope == 1 ? "USER" : "UNKNOWN";
+}
+
+const char *massCancelSideName(int32_t side)
+{
+    return side == 2 ? "BOTH" : sideName(static_cast<uint8_t>(side));
+}
+
+const char *execTypeName(uint8_t type)
+{
+    static const char *names[] = {"NEW", "PARTIAL_FILL", "FILL", "CANCELED", "REJECTED", "REPLACED"};
+    return type < sizeof(names) / sizeof(names[0]) ? names[type] : "UNKNOWN";
+}
+
+void printRecord(const EventRecord &rec)
+{
+    time_t sec = static_cast<time_t>(rec.timestamp_ns / 1000000000ull);
+    struct tm tm;
+    gmtime_r(&sec, &tm);
+    char when[32];
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+
+    char id[33];
+    std::memcpy(id, rec.order_id, 32);
+    id[32] = '\0';
+
+    printf("%s.%09" PRIu64 " t%u %-15s conn=%" PRIx64 " symbol=%u",
+           when, static_cast<uint64_t>(rec.timestamp_ns % 1000000000ull), rec.thread_id, eventTypeName(rec.type),
+           rec.conn_id, rec.symbol_id);
+    switch (rec.type)
+    {
+    case EventType::ORDER_RECEIVED:
+        printf(" order_id=%s side=%s type=%s price=%g qty=%d", id, sideName(rec.code),
+               orderTypeName(static_cast<uint8_t>(rec.aux)), rec.price, rec.quantity);
+        break;
+    case EventType::CANCEL_RECEIVED:
+    case EventType::ORDER_CANCELED:
+        printf(" order_id=%s", id);
+        break;
+    case EventType::REPLACE_RECEIVED:
+        printf(" order_id=%s price=%g qty=%d", id, rec.price, rec.quantity);
+        break;
+    case EventType::ORDER_REPLACED:
+        printf(" order_id=%s price=%g qty=%d prev_leaves=%d", id, rec.price, rec.quantity, rec.aux);
+        break;
+    case EventType::ORDER_REJECTED:
+    case EventType::CANCEL_REJECTED:
+    case EventType::REPLACE_REJECTED:
+        printf(" order_id=%s reason=%s price=%g", id,
+               rejectReasonName(static_cast<RejectReason>(rec.code)), rec.price);
+        break;
+    case EventType::REPORT_SENT:
+        printf(" order_id=%s exec_type=%s price=%g last=%d leaves=%d", id, execTypeName(rec.code),
+               rec.price, rec.quantity, rec.aux);
+        break;
+    case EventType::MESSAGE_INVALID:
+        printf(" reason=%s detail=%d", rejectReasonName(static_cast<RejectReason>(rec.code)), rec.aux);
+        break;
+    case EventType::ORDER_EXPIRED:
+        printf(" order_id=%s type=%s price=%g qty=%d canceled=%d", id, orderTypeName(rec.code), rec.price,
+               rec.quantity, rec.aux);
+        break;
+    case EventType::MASS_CANCEL_RECEIVED:
+        printf(" scope=%s side=%s user_id=%s", massCancelScopeName(rec.code), massCancelSideName(rec.aux), id);
+        break;
+    case EventType::MASS_CANCELED:
+        printf(" scope=%s side=%s user_id=%s canceled=%d", massCancelScopeName(rec.code),
+               massCancelSideName(rec.aux), id, rec.quantity);
+        break;
+    }
+    printf("\n");
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <events.bin>\n", argv[0]);
+        return 1;
+    }
+    FILE *in = fopen(argv[1], "rb");
+    if (!in)
+    {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    EventLogHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        std::memcmp(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic)) != 0)
+    {
+        fprintf(stderr, "%s: not an event log\n", argv[1]);
+        return 1;
+    }
+    if (header.version != EVENT_LOG_VERSION || header.record_size != sizeof(EventRecord))
+    {
+        fprintf(stderr, "%s: unsupported version %u (record size %u)\n", argv[1], header.version, header.record_size);
+        return 1;
+    }
+
+    EventRecord rec;
+    uint64_t count = 0;
+    while (fread(&rec, sizeof(rec), 1, in) == 1)
+    {
+        printRecord(rec);
+        ++count;
+    }
+    fclose(in);
+    fprintf(stderr, "%" PRIu64 " records\n", count);
+    return 0;
+}
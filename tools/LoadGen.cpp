@@ -0,0 +1,761 @@
+// 压测客户端：多条 TCP 连接开环发送订单流，统计端到端延迟与持续吞吐
+//
+// 开环：按目标速率预先排定每笔消息的发送时刻，不等待回报；延迟从"计划发送时刻"算起，
+// 引擎或网络卡顿时积压的消息不会被少算（避免 coordinated omission）。另外单独统计从实际
+// 写出时刻算起的延迟，两者之差就是压测端自身的排队。
+//
+// 订单流：默认按参数合成（挂单 / 主动单 / 撤自己的挂单）；--replay 则重放 EventLog 录下的
+// ORDER_RECEIVED / CANCEL_RECEIVED（按原连接分配到压测连接，订单号改写为本次运行唯一）。
+//
+// 用法：load_gen --port=9999 --connections=8 --rate=200000 --duration=10 [--replay=logs/events.bin]
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "core/ExecutionReport.h"
+#include "core/Order.h"
+#include "protocol/MessageCodec.h"
+#include "utils/EventLog.h"
+#include "utils/HdrHistogram.h"
+
+namespace
+{
+struct Options
+{
+    std::string host = "127.0.0.1";
+    int port = 9999;
+    uint32_t connections = 4;
+    uint32_t threads = 1;
+    double rate = 10000;          // 全部连接合计每秒消息数
+    double duration = 10;         // 发送时长（秒）
+    double warmup = 1;            // 开头这段时间的样本不计入直方图
+    double drain = 2;             // 发送结束后等待回报的最长时间
+    double report_interval = 1;   // 进度输出间隔，0 关闭
+    uint32_t symbols = 1;
+    double tick = 0.001;
+    double mid = 100.0;
+    uint32_t levels = 50;         // 挂单距中间价的最大档数
+    double aggressive_ratio = 0.1; // 主动单比例（价格越过中间价）
+    double cancel_ratio = 0.2;    // 撤单比例（撤本连接的挂单）
+    uint32_t window = 1u << 16;   // 每条连接跟踪的在途订单数，超出后最早的订单不再统计
+    uint64_t seed = 20240601;
+    std::string replay;
+    std::string hist_out;         // 输出 <prefix>-order.hgrm 等百分位分布文件
+};
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+// 订单号：LG<运行标识 8 位十六进制>-<连接 4 位>-<序号 12 位>，回报里按固定偏移解析出序号
+constexpr size_t ID_SEQ_OFFSET = 16;
+constexpr size_t ID_SEQ_DIGITS = 12;
+
+OrderId makeOrderId(uint32_t runTag, uint32_t conn, uint64_t seq)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "LG%08x-%04x-%012" PRIx64, runTag, conn & 0xffff, static_cast<uint64_t>(seq & 0xffffffffffffull));
+    return OrderId::fromString(buf);
+}
+
+bool parseSeq(const uint8_t *id, uint64_t &seq)
+{
+    if (id[0] != 'L' || id[1] != 'G')
+        return false;
+    seq = 0;
+    for (size_t i = 0; i < ID_SEQ_DIGITS; ++i)
+    {
+        uint8_t c = id[ID_SEQ_OFFSET + i];
+        uint64_t digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else
+            return false;
+        seq = (seq << 4) | digit;
+    }
+    return true;
+}
+
+// 重放的一条消息，订单号在加载时已分配好（连接 + 序号）
+struct ReplayMessage
+{
+    uint32_t conn;
+    bool cancel;
+    uint64_t seq; // 新订单的序号，或被撤订单的序号
+    uint32_t symbol_id;
+    OrderSide side;
+    double price;
+    int32_t quantity;
+};
+
+bool loadReplay(const Options &opt, std::vector<ReplayMessage> &out)
+{
+    FILE *f = std::fopen(opt.replay.c_str(), "rb");
+    if (!f)
+    {
+        std::fprintf(stderr, "Cannot open %s: %s\n", opt.replay.c_str(), std::strerror(errno));
+        return false;
+    }
+    EventLogHeader header;
+    if (std::fread(&header, sizeof(header), 1, f) != 1 ||
+        std::memcmp(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+        header.record_size != sizeof(EventRecord))
+    {
+        std::fprintf(stderr, "%s is not an event log\n", opt.replay.c_str());
+        std::fclose(f);
+        return false;
+    }
+
+    std::unordered_map<uint64_t, uint32_t> connMap; // 录制时的连接 → 压测连接（按首次出现轮流分配）
+    std::unordered_map<std::string, std::pair<uint32_t, uint64_t>> orders; // 录制的订单号 → (连接, 序号)
+    std::vector<uint64_t> nextSeq(opt.connections, 0);
+    size_t skipped = 0;
+    EventRecord rec;
+    while (std::fread(&rec, sizeof(rec), 1, f) == 1)
+    {
+        if (rec.type != EventType::ORDER_RECEIVED && rec.type != EventType::CANCEL_RECEIVED)
+            continue;
+        std::string id(rec.order_id, strnlen(rec.order_id, sizeof(rec.order_id)));
+        ReplayMessage msg{};
+        msg.symbol_id = rec.symbol_id;
+        if (rec.type == EventType::ORDER_RECEIVED)
+        {
+            auto it = connMap.emplace(rec.conn_id, static_cast<uint32_t>(connMap.size() % opt.connections)).first;
+            msg.conn = it->second;
+            msg.seq = nextSeq[msg.conn]++;
+            msg.side = static_cast<OrderSide>(rec.code);
+            msg.price = rec.price;
+            msg.quantity = rec.quantity;
+            orders[id] = {msg.conn, msg.seq};
+        }
+        else
+        {
+            // 撤单从下单的那条连接发出，回报与订单的跟踪记录在同一处
+            auto it = orders.find(id);
+            if (it == orders.end())
+            {
+                ++skipped;
+                continue;
+            }
+            msg.cancel = true;
+            msg.conn = it->second.first;
+            msg.seq = it->second.second;
+        }
+        out.push_back(msg);
+    }
+    std::fclose(f);
+    std::printf("replay: %zu messages from %s (%zu distinct connections, %zu cancels of unknown orders skipped)\n",
+                out.size(), opt.replay.c_str(), connMap.size(), skipped);
+    return !out.empty();
+}
+
+class Worker
+{
+public:
+    Worker(const Options &opt, uint32_t index, uint32_t runTag, std::vector<ReplayMessage> replay)
+        : opt_(opt), index_(index), runTag_(runTag), replay_(std::move(replay)), rng_(opt.seed + index)
+    {
+    }
+
+    bool connectAll()
+    {
+        epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+        for (uint32_t c = index_; c < opt_.connections; c += opt_.threads)
+        {
+            int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(opt_.port));
+            if (inet_pton(AF_INET, opt_.host.c_str(), &addr.sin_addr) != 1 ||
+                connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+            {
+                std::fprintf(stderr, "connect %s:%d failed: %s\n", opt_.host.c_str(), opt_.port, std::strerror(errno));
+                close(fd);
+                return false;
+            }
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            auto conn = std::make_unique<Conn>();
+            conn->fd = fd;
+            conn->id = c;
+            conn->pending.resize(opt_.window);
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u32 = static_cast<uint32_t>(conns_.size());
+            epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+            localIndex_[c] = static_cast<uint32_t>(conns_.size());
+            conns_.push_back(std::move(conn));
+        }
+        return true;
+    }
+
+    void run(uint64_t start)
+    {
+        double perWorkerRate = opt_.rate / opt_.threads;
+        uint64_t intervalNs = static_cast<uint64_t>(1e9 / perWorkerRate);
+        uint64_t stop = start + static_cast<uint64_t>(opt_.duration * 1e9);
+        warmupEnd_ = start + static_cast<uint64_t>(opt_.warmup * 1e9);
+        // 各线程的发送时刻错开，合起来仍是均匀的速率
+        uint64_t next = start + intervalNs * index_ / opt_.threads;
+        size_t replayPos = 0;
+        std::vector<epoll_event> events(64);
+
+        while (true)
+        {
+            uint64_t now = nowNs();
+            bool sending = next < stop && (replay_.empty() ? true : replayPos < replay_.size());
+            if (!sending)
+            {
+                // 发送结束：所有订单都有回报，或等满 drain
+                if (outstanding() == 0 || now >= stop + static_cast<uint64_t>(opt_.drain * 1e9))
+                    break;
+            }
+
+            // 到期的消息全部写入发送缓冲，每轮最多 256 条以免饿死接收
+            for (int burst = 0; sending && next <= now && burst < 256; ++burst)
+            {
+                if (replay_.empty())
+                    sendSynthetic(next, now);
+                else
+                    sendReplay(replay_[replayPos++], next, now);
+                next += intervalNs;
+                sending = next < stop && (replay_.empty() ? true : replayPos < replay_.size());
+            }
+            for (auto &conn : conns_)
+                flush(*conn);
+
+            timespec timeout{0, 0};
+            if (!sending)
+                timeout.tv_nsec = 1000000;
+            else if (next > now + 2000)
+                timeout.tv_nsec = static_cast<long>(std::min<uint64_t>(next - now - 1000, 999999999));
+            int n = epoll_pwait2(epollFd_, events.data(), static_cast<int>(events.size()), &timeout, nullptr);
+            for (int i = 0; i < n; ++i)
+            {
+                Conn &conn = *conns_[events[i].data.u32];
+                if (events[i].events & EPOLLOUT)
+                    flush(conn);
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    receive(conn);
+            }
+        }
+        for (auto &conn : conns_)
+        {
+            for (const Pending &p : conn->pending)
+            {
+                if (p.state == State::SENT && p.intended >= warmupEnd_)
+                    ++unanswered;
+            }
+            close(conn->fd);
+        }
+        close(epollFd_);
+    }
+
+    // 延迟直方图（纳秒），run 结束后由主线程合并
+    HdrHistogram orderLatency;   // 计划发送时刻 → 首条回报
+    HdrHistogram serviceLatency; // 实际写入时刻 → 首条回报
+    HdrHistogram cancelLatency;  // 撤单计划发送时刻 → CANCELED 回报
+    std::atomic<uint64_t> sentOrders{0};
+    std::atomic<uint64_t> sentCancels{0};
+    std::atomic<uint64_t> acked{0};
+    uint64_t rejected = 0;
+    uint64_t unanswered = 0;      // 结束时仍无回报的订单（不含预热期）
+    uint64_t untracked = 0;       // 回报到达时跟踪窗口已被覆盖
+    uint64_t disconnected = 0;
+
+private:
+    enum class State : uint8_t
+    {
+        FREE,
+        SENT,    // 已发出，等待首条回报
+        RESTING, // 已挂在订单簿上
+        DONE
+    };
+
+    struct Pending
+    {
+        uint64_t seq = 0;
+        uint64_t intended = 0;
+        uint64_t sent = 0;
+        uint64_t cancelIntended = 0;
+        State state = State::FREE;
+        bool cancelPending = false;
+    };
+
+    struct Conn
+    {
+        int fd = -1;
+        uint32_t id = 0;
+        bool closed = false;
+        bool writeInterest = false;
+        uint64_t nextSeq = 0;
+        std::vector<uint8_t> out;
+        size_t outOffset = 0;
+        std::vector<uint8_t> in;
+        std::vector<Pending> pending;
+        std::vector<uint64_t> resting; // 可被撤的挂单序号
+    };
+
+    Pending &slot(Conn &conn, uint64_t seq) { return conn.pending[seq % conn.pending.size()]; }
+
+    uint64_t outstanding() const
+    {
+        return sentOrders.load(std::memory_order_relaxed) - acked.load(std::memory_order_relaxed) - droppedTracking_;
+    }
+
+    void appendFrame(Conn &conn, MessageType type, const uint8_t *payload, uint16_t len)
+    {
+        size_t pos = conn.out.size();
+        conn.out.resize(pos + MessageCodec::HEADER_SIZE + len);
+        MessageCodec::encodeHeader(conn.out.data() + pos, type, len);
+        std::memcpy(conn.out.data() + pos + MessageCodec::HEADER_SIZE, payload, len);
+    }
+
+    void sendOrder(Conn &conn, uint64_t seq, uint32_t symbol, OrderSide side, double price, int32_t qty,
+                   uint64_t intended, uint64_t now)
+    {
+        Pending &p = slot(conn, seq);
+        if (p.state == State::SENT)
+            ++droppedTracking_; // 窗口内最早的订单一直没有回报，放弃跟踪
+        p = Pending{seq, intended, now, 0, State::SENT, false};
+
+        Order order{};
+        order.user_id = UserId::fromString("load_gen");
+        order.order_id = makeOrderId(runTag_, conn.id, seq);
+        order.side = side;
+        order.price = price;
+        order.quantity = qty;
+        order.remaining_quantity = qty;
+        order.timestamp = intended;
+        order.symbol_id = symbol;
+        uint8_t payload[Order::WIRE_SIZE];
+        order.serializeTo(payload);
+        appendFrame(conn, MessageType::NEW_ORDER, payload, sizeof(payload));
+        sentOrders.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void sendCancel(Conn &conn, uint64_t seq, uint32_t symbol, uint64_t intended)
+    {
+        Pending &p = slot(conn, seq);
+        if (p.seq == seq && (p.state == State::SENT || p.state == State::RESTING))
+        {
+            p.cancelPending = true;
+            p.cancelIntended = intended;
+        }
+        OrderId id = makeOrderId(runTag_, conn.id, seq);
+        wire::CancelOrder msg{};
+        std::memcpy(msg.order_id, id.data, sizeof(msg.order_id));
+        msg.symbol_id = symbol;
+        appendFrame(conn, wire::CancelOrder::TYPE, reinterpret_cast<const uint8_t *>(&msg), sizeof(msg));
+        sentCancels.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void sendSynthetic(uint64_t intended, uint64_t now)
+    {
+        Conn &conn = *conns_[roundRobin_++ % conns_.size()];
+        if (conn.closed)
+            return;
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        if (unit(rng_) < opt_.cancel_ratio)
+        {
+            // 撤一笔仍在订单簿上的挂单；没有可撤的就改发新订单
+            while (!conn.resting.empty())
+            {
+                size_t pick = std::uniform_int_distribution<size_t>(0, conn.resting.size() - 1)(rng_);
+                uint64_t seq = conn.resting[pick];
+                conn.resting[pick] = conn.resting.back();
+                conn.resting.pop_back();
+                Pending &p = slot(conn, seq);
+                if (p.seq != seq || p.state != State::RESTING || p.cancelPending)
+                    continue;
+                sendCancel(conn, seq, symbolOf(seq), intended);
+                return;
+            }
+        }
+
+        uint64_t seq = conn.nextSeq++;
+        int64_t midTicks = std::llround(opt_.mid / opt_.tick);
+        OrderSide side = (rng_() & 1) ? OrderSide::BUY : OrderSide::SELL;
+        int64_t offset = 1 + static_cast<int64_t>(rng_() % opt_.levels);
+        if (unit(rng_) < opt_.aggressive_ratio)
+            offset = -offset + 1; // 越过中间价，与对手方挂单成交
+        int64_t ticks = side == OrderSide::BUY ? midTicks - offset : midTicks + offset;
+        int32_t qty = 1 + static_cast<int32_t>(rng_() % 100);
+        sendOrder(conn, seq, symbolOf(seq), side, static_cast<double>(ticks) * opt_.tick, qty, intended, now);
+    }
+
+    uint32_t symbolOf(uint64_t seq) const { return static_cast<uint32_t>(seq % opt_.symbols); }
+
+    void sendReplay(const ReplayMessage &msg, uint64_t intended, uint64_t now)
+    {
+        Conn &conn = *conns_[localIndex_.at(msg.conn)];
+        if (conn.closed)
+            return;
+        if (msg.cancel)
+            sendCancel(conn, msg.seq, msg.symbol_id, intended);
+        else
+            sendOrder(conn, msg.seq, msg.symbol_id, msg.side, msg.price, msg.quantity, intended, now);
+    }
+
+    void flush(Conn &conn)
+    {
+        while (!conn.closed && conn.outOffset < conn.out.size())
+        {
+            ssize_t n = ::send(conn.fd, conn.out.data() + conn.outOffset, conn.out.size() - conn.outOffset,
+                               MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                conn.outOffset += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            if (n < 0 && errno == EINTR)
+                continue;
+            closeConn(conn);
+            return;
+        }
+        if (conn.outOffset == conn.out.size())
+        {
+            conn.out.clear();
+            conn.outOffset = 0;
+        }
+        // 内核缓冲区满时等 EPOLLOUT，积压留在用户态缓冲里（仍按计划时刻计延迟）
+        bool want = conn.outOffset < conn.out.size();
+        if (want != conn.writeInterest && !conn.closed)
+        {
+            epoll_event ev{};
+            ev.events = EPOLLIN | (want ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+            ev.data.u32 = localIndex_.at(conn.id);
+            epoll_ctl(epollFd_, EPOLL_CTL_MOD, conn.fd, &ev);
+            conn.writeInterest = want;
+        }
+    }
+
+    void receive(Conn &conn)
+    {
+        uint8_t buf[1 << 16];
+        while (!conn.closed)
+        {
+            ssize_t n = recv(conn.fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n > 0)
+            {
+                conn.in.insert(conn.in.end(), buf, buf + n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            if (n < 0 && errno == EINTR)
+                continue;
+            closeConn(conn);
+            break;
+        }
+
+        uint64_t now = nowNs();
+        size_t pos = 0;
+        while (pos < conn.in.size())
+        {
+            size_t consumed = 0;
+            auto frame = MessageCodec::decode(conn.in.data() + pos, conn.in.size() - pos, consumed);
+            if (!frame)
+            {
+                pos += consumed;
+                if (consumed == 0)
+                    break;
+                continue;
+            }
+            pos += consumed;
+            if (frame->type == MessageType::EXECUTION_REPORT && frame->payload.size >= ExecutionReport::WIRE_SIZE)
+                onReport(conn, *reinterpret_cast<const wire::ExecutionReport *>(frame->payload.data), now);
+        }
+        conn.in.erase(conn.in.begin(), conn.in.begin() + static_cast<std::ptrdiff_t>(pos));
+    }
+
+    void onReport(Conn &conn, const wire::ExecutionReport &report, uint64_t now)
+    {
+        uint64_t seq;
+        if (!parseSeq(report.order_id, seq))
+            return;
+        Pending &p = slot(conn, seq);
+        if (p.seq != seq || p.state == State::FREE)
+        {
+            ++untracked;
+            return;
+        }
+        auto type = static_cast<ExecType>(report.exec_type);
+        int32_t leaves = report.leaves_qty;
+
+        if (p.state == State::SENT)
+        {
+            if (p.intended >= warmupEnd_)
+            {
+                orderLatency.record(now - p.intended);
+                serviceLatency.record(now - p.sent);
+            }
+            acked.fetch_add(1, std::memory_order_relaxed);
+            if (type == ExecType::REJECTED)
+                ++rejected;
+            bool resting = (type == ExecType::NEW || type == ExecType::PARTIAL_FILL) && leaves > 0;
+            p.state = resting ? State::RESTING : State::DONE;
+            if (resting && !p.cancelPending)
+                conn.resting.push_back(seq);
+        }
+        if (type == ExecType::CANCELED && p.cancelPending)
+        {
+            if (p.cancelIntended >= warmupEnd_)
+                cancelLatency.record(now - p.cancelIntended);
+            p.state = State::DONE;
+        }
+        else if (type == ExecType::FILL || (type == ExecType::PARTIAL_FILL && leaves == 0))
+        {
+            p.state = State::DONE;
+        }
+    }
+
+    void closeConn(Conn &conn)
+    {
+        if (conn.closed)
+            return;
+        std::fprintf(stderr, "connection %u closed by engine\n", conn.id);
+        conn.closed = true;
+        ++disconnected;
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, conn.fd, nullptr);
+    }
+
+    const Options &opt_;
+    uint32_t index_;
+    uint32_t runTag_;
+    std::vector<ReplayMessage> replay_;
+    std::mt19937_64 rng_;
+    int epollFd_ = -1;
+    std::vector<std::unique_ptr<Conn>> conns_;
+    std::unordered_map<uint32_t, uint32_t> localIndex_; // 全局连接号 → conns_ 下标
+    size_t roundRobin_ = 0;
+    uint64_t warmupEnd_ = 0;
+    uint64_t droppedTracking_ = 0;
+};
+
+bool parseOptions(int argc, char **argv, Options &opt)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos)
+        {
+            std::fprintf(stderr, "Invalid argument: %s (expected --key=value)\n", arg.c_str());
+            return false;
+        }
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        try
+        {
+            if (key == "host")
+                opt.host = value;
+            else if (key == "port")
+                opt.port = std::stoi(value);
+            else if (key == "connections")
+                opt.connections = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "threads")
+                opt.threads = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "rate")
+                opt.rate = std::stod(value);
+            else if (key == "duration")
+                opt.duration = std::stod(value);
+            else if (key == "warmup")
+                opt.warmup = std::stod(value);
+            else if (key == "drain")
+                opt.drain = std::stod(value);
+            else if (key == "report-interval")
+                opt.report_interval = std::stod(value);
+            else if (key == "symbols")
+                opt.symbols = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "tick-size")
+                opt.tick = std::stod(value);
+            else if (key == "mid-price")
+                opt.mid = std::stod(value);
+            else if (key == "levels")
+                opt.levels = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "aggressive-ratio")
+                opt.aggressive_ratio = std::stod(value);
+            else if (key == "cancel-ratio")
+                opt.cancel_ratio = std::stod(value);
+            else if (key == "window")
+                opt.window = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "seed")
+                opt.seed = std::stoull(value);
+            else if (key == "replay")
+                opt.replay = value;
+            else if (key == "hist-out")
+                opt.hist_out = value;
+            else
+            {
+                std::fprintf(stderr, "Unknown option: --%s\n", key.c_str());
+                return false;
+            }
+        }
+        catch (const std::exception &)
+        {
+            std::fprintf(stderr, "Invalid value for --%s: %s\n", key.c_str(), value.c_str());
+            return false;
+        }
+    }
+    if (opt.connections == 0 || opt.threads == 0 || opt.threads > opt.connections || opt.rate <= 0 ||
+        opt.duration <= 0 || opt.symbols == 0 || opt.levels == 0 || opt.window == 0 || opt.tick <= 0)
+    {
+        std::fprintf(stderr, "Invalid options: connections >= threads >= 1, positive rate, duration, symbols, "
+                             "levels, window and tick-size are required\n");
+        return false;
+    }
+    return true;
+}
+
+void printLatency(const char *name, const HdrHistogram &h)
+{
+    if (h.count() == 0)
+    {
+        std::printf("%-22s no samples\n", name);
+        return;
+    }
+    auto us = [&h](double p)
+    { return static_cast<double>(h.valueAtPercentile(p)) / 1000.0; };
+    std::printf("%-22s n=%-10" PRIu64 " p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f p99.99=%.1f max=%.1f us\n", name,
+                h.count(), us(50), us(90), us(99), us(99.9), us(99.99), static_cast<double>(h.max()) / 1000.0);
+}
+
+void writeHistogram(const std::string &prefix, const char *name, const HdrHistogram &h)
+{
+    std::string path = prefix + "-" + name + ".hgrm";
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f)
+    {
+        std::fprintf(stderr, "Cannot write %s: %s\n", path.c_str(), std::strerror(errno));
+        return;
+    }
+    h.writePercentiles(f, 1000.0);
+    std::fclose(f);
+    std::printf("wrote %s\n", path.c_str());
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parseOptions(argc, argv, opt))
+        return 1;
+
+    std::vector<ReplayMessage> replay;
+    if (!opt.replay.empty() && !loadReplay(opt, replay))
+        return 1;
+
+    uint32_t runTag = static_cast<uint32_t>(getpid()) ^ static_cast<uint32_t>(nowNs() >> 10);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (uint32_t t = 0; t < opt.threads; ++t)
+    {
+        // 重放消息按连接分给所属线程，保持每条连接内的原始顺序
+        std::vector<ReplayMessage> mine;
+        for (const ReplayMessage &msg : replay)
+        {
+            if (msg.conn % opt.threads == t)
+                mine.push_back(msg);
+        }
+        workers.push_back(std::make_unique<Worker>(opt, t, runTag, std::move(mine)));
+        if (!workers.back()->connectAll())
+            return 1;
+    }
+
+    std::printf("load_gen: %u connections, %u threads, %.0f msg/s for %.1fs (warmup %.1fs), %s flow\n",
+                opt.connections, opt.threads, opt.rate, opt.duration, opt.warmup,
+                replay.empty() ? "synthetic" : "replayed");
+    uint64_t start = nowNs() + 10000000; // 留 10ms 让各线程就绪
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> running{opt.threads};
+    for (auto &w : workers)
+    {
+        threads.emplace_back([&w, start, &running]
+                             {
+                                 w->run(start);
+                                 running.fetch_sub(1); });
+    }
+
+    if (opt.report_interval > 0)
+    {
+        uint64_t lastSent = 0, lastAcked = 0;
+        auto interval = std::chrono::duration<double>(opt.report_interval);
+        auto tick = std::chrono::steady_clock::now();
+        while (running.load() > 0)
+        {
+            tick += std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+            while (running.load() > 0 && std::chrono::steady_clock::now() < tick)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            uint64_t sent = 0, acked = 0;
+            for (auto &w : workers)
+            {
+                sent += w->sentOrders.load(std::memory_order_relaxed) + w->sentCancels.load(std::memory_order_relaxed);
+                acked += w->acked.load(std::memory_order_relaxed);
+            }
+            std::printf("[%6.1fs] sent %10.0f msg/s   acked %10.0f orders/s\n",
+                        static_cast<double>(nowNs() - start) / 1e9, (sent - lastSent) / opt.report_interval,
+                        (acked - lastAcked) / opt.report_interval);
+            std::fflush(stdout);
+            lastSent = sent;
+            lastAcked = acked;
+        }
+    }
+    for (auto &t : threads)
+        t.join();
+    uint64_t end = nowNs();
+
+    HdrHistogram orderLatency, serviceLatency, cancelLatency;
+    uint64_t sentOrders = 0, sentCancels = 0, acked = 0, rejected = 0, unanswered = 0, untracked = 0, disconnected = 0;
+    for (auto &w : workers)
+    {
+        orderLatency.add(w->orderLatency);
+        serviceLatency.add(w->serviceLatency);
+        cancelLatency.add(w->cancelLatency);
+        sentOrders += w->sentOrders.load();
+        sentCancels += w->sentCancels.load();
+        acked += w->acked.load();
+        rejected += w->rejected;
+        unanswered += w->unanswered;
+        untracked += w->untracked;
+        disconnected += w->disconnected;
+    }
+    double sendSeconds = std::min(opt.duration, static_cast<double>(end - start) / 1e9);
+    std::printf("\nsent %" PRIu64 " orders + %" PRIu64 " cancels (%.0f msg/s), acked %" PRIu64
+                " (%.0f orders/s), rejected %" PRIu64 ", unanswered %" PRIu64 ", untracked %" PRIu64
+                ", disconnected %" PRIu64 "\n",
+                sentOrders, sentCancels, static_cast<double>(sentOrders + sentCancels) / sendSeconds, acked,
+                static_cast<double>(acked) / sendSeconds, rejected, unanswered, untracked, disconnected);
+    printLatency("order (intended)", orderLatency);
+    printLatency("order (actual send)", serviceLatency);
+    printLatency("cancel (intended)", cancelLatency);
+    if (!opt.hist_out.empty())
+    {
+        writeHistogram(opt.hist_out, "order", orderLatency);
+        writeHistogram(opt.hist_out, "service", serviceLatency);
+        writeHistogram(opt.hist_out, "cancel", cancelLatency);
+    }
+    return disconnected == 0 ? 0 : 2;
+}
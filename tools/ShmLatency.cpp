@@ -0,0 +1,108 @@
+// 共享内存传输往返延迟：逐笔发送订单，等到该订单的第一条回报再发下一笔，统计分位数
+// 用法：shm_latency [prefix=/matching-engine] [count=100000] [symbol=0] [slots=4]
+// 买卖交替、同一价格，订单两两成交，订单簿不会增长
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "client/ShmClient.h"
+
+namespace
+{
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+{
+    size_t index = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string prefix = argc > 1 ? argv[1] : "/matching-engine";
+    int count = argc > 2 ? std::atoi(argv[2]) : 100000;
+    uint32_t symbol = argc > 3 ? static_cast<uint32_t>(std::atoi(argv[3])) : 0;
+    uint32_t slots = argc > 4 ? static_cast<uint32_t>(std::atoi(argv[4])) : 4;
+    if (count <= 0)
+    {
+        fprintf(stderr, "count must be positive\n");
+        return 1;
+    }
+
+    ShmClient client;
+    if (!client.connect(prefix, slots))
+    {
+        fprintf(stderr, "Cannot connect to %s-[0..%u]\n", prefix.c_str(), slots - 1);
+        return 1;
+    }
+
+    Order order{};
+    order.user_id = UserId::fromString("shm_latency");
+    order.price = 100.0;
+    order.quantity = 1;
+    order.remaining_quantity = 1;
+    order.symbol_id = symbol;
+
+    std::string runTag = std::to_string(getpid());
+    std::vector<uint64_t> samples;
+    samples.reserve(static_cast<size_t>(count));
+    int warmup = std::min(count / 10, 1000);
+    for (int i = 0; i < count + warmup; ++i)
+    {
+        order.order_id = OrderId::fromString("L" + runTag + "-" + std::to_string(i));
+        order.side = (i & 1) ? OrderSide::SELL : OrderSide::BUY;
+        order.timestamp = static_cast<uint64_t>(i);
+
+        uint64_t start = nowNs();
+        while (!client.sendOrder(order))
+        {
+            if (!client.connected())
+            {
+                fprintf(stderr, "Disconnected by engine after %d orders\n", i);
+                return 1;
+            }
+            client.poll([](MessageType, PayloadView) {});
+        }
+        // 等本订单的回报（成交时对手方的回报也会到达）
+        bool acked = false;
+        while (!acked)
+        {
+            size_t polled = client.poll([&](MessageType type, PayloadView payload)
+                        {
+                            const auto *report = payload.as<wire::ExecutionReport>();
+                            if (type == MessageType::EXECUTION_REPORT && report &&
+                                std::memcmp(report->order_id, order.order_id.data, sizeof(report->order_id)) == 0)
+                                acked = true; });
+            if (!acked && !client.connected())
+            {
+                fprintf(stderr, "Disconnected by engine after %d orders\n", i);
+                return 1;
+            }
+            if (polled == 0)
+                std::this_thread::yield(); // 与引擎共用 CPU 核时让出时间片
+
+        }
+        if (i >= warmup)
+            samples.push_back(nowNs() - start);
+    }
+    client.poll([](MessageType, PayloadView) {});
+
+    std::sort(samples.begin(), samples.end());
+    printf("orders=%d  rtt ns: min=%" PRIu64 " p50=%" PRIu64 " p90=%" PRIu64 " p99=%" PRIu64 " p99.9=%" PRIu64
+           " max=%" PRIu64 "\n",
+           count, samples.front(), percentile(samples, 50), percentile(samples, 90), percentile(samples, 99),
+           percentile(samples, 99.9), samples.back());
+    return 0;
+}
@@ -0,0 +1,182 @@
+#include "EventLog.h"
+#include "SpscQueue.h"
+#include "Logger.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<bool> EventLog::enabled_{false};
+
+namespace
+{
+struct Producer
+{
+    Producer(uint32_t capacity, uint16_t id) : ring(capacity), thread_id(id) {}
+    SpscQueue<EventRecord> ring;
+    uint16_t thread_id;
+    std::atomic<uint64_t> dropped{0};
+};
+
+struct State
+{
+    std::mutex mutex; // 保护 producers 列表（仅线程首次写日志时注册）
+    std::vector<std::unique_ptr<Producer>> producers;
+    std::atomic<size_t> producerCount{0};
+    uint32_t ringCapacity = 0;
+    FILE *file = nullptr;
+    std::thread drainer;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> written{0};
+
+    // 致命错误时 exit() 直接析构到这里：先停掉排空线程，否则 std::thread 析构会 terminate
+    ~State()
+    {
+        running.store(false);
+        if (drainer.joinable())
+            drainer.join();
+        if (file)
+            fclose(file);
+    }
+};
+
+State &state()
+{
+    static State s;
+    return s;
+}
+
+thread_local Producer *tlsProducer = nullptr;
+
+Producer *registerThread()
+{
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto id = static_cast<uint16_t>(s.producers.size());
+    s.producers.push_back(std::make_unique<Producer>(s.ringCapacity, id));
+    s.producerCount.store(s.producers.size(), std::memory_order_release);
+    return s.producers.back().get();
+}
+
+// 把所有生产者环中的记录写入文件，返回写出的条数
+size_t drainOnce(std::vector<EventRecord> &batch)
+{
+    State &s = state();
+    size_t count = s.producerCount.load(std::memory_order_acquire);
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Producer *p;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            p = s.producers[i].get();
+        }
+        batch.clear();
+        while (const EventRecord *rec = p->ring.front())
+        {
+            batch.push_back(*rec);
+            p->ring.pop();
+            if (batch.size() == batch.capacity())
+                break;
+        }
+        if (!batch.empty())
+        {
+            fwrite(batch.data(), sizeof(EventRecord), batch.size(), s.file);
+            total += batch.size();
+        }
+    }
+    s.written.fetch_add(total, std::memory_order_relaxed);
+    return total;
+}
+
+void drainLoop()
+{
+    State &s = state();
+    std::vector<EventRecord> batch;
+    batch.reserve(4096);
+    while (s.running.load(std::memory_order_relaxed))
+    {
+        if (drainOnce(batch) == 0)
+        {
+            // 空闲时交给内核写出 stdio 缓冲，再短暂休眠
+            fflush(s.file);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    while (drainOnce(batch) > 0)
+    {
+    }
+    fflush(s.file);
+}
+} // namespace
+
+bool EventLog::open(const std::string &path, uint32_t ringCapacity)
+{
+    State &s = state();
+    if (s.file)
+        return false;
+    s.file = fopen(path.c_str(), "wb");
+    if (!s.file)
+    {
+        spdlog::error("Cannot open event log: {}", path);
+        return false;
+    }
+    setvbuf(s.file, nullptr, _IOFBF, 1 << 20);
+
+    EventLogHeader header{};
+    std::memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(header.magic));
+    header.version = EVENT_LOG_VERSION;
+    header.record_size = sizeof(EventRecord);
+    fwrite(&header, sizeof(header), 1, s.file);
+
+    s.ringCapacity = ringCapacity;
+    s.running.store(true);
+    s.drainer = std::thread(drainLoop);
+    enabled_.store(true);
+    spdlog::info("Event log: {} (ring capacity {} per thread)", path, ringCapacity);
+    return true;
+}
+
+void EventLog::close()
+{
+    State &s = state();
+    if (!enabled_.exchange(false))
+        return;
+    s.running.store(false);
+    if (s.drainer.joinable())
+        s.drainer.join();
+    fclose(s.file);
+    s.file = nullptr;
+    // 生产者环保留到进程退出：其他线程可能仍持有 tlsProducer
+    spdlog::info("Event log closed: written={} dropped={}", written(), dropped());
+}
+
+void EventLog::push(EventRecord &rec)
+{
+    Producer *p = tlsProducer;
+    if (!p)
+        p = tlsProducer = registerThread();
+    rec.thread_id = p->thread_id;
+    rec.timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                 std::chrono::system_clock::now().time_since_epoch())
+                                                 .count());
+    if (!p->ring.push(rec))
+        p->dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t EventLog::written()
+{
+    return state().written.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLog::dropped()
+{
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    uint64_t total = 0;
+    for (auto &p : s.producers)
+        total += p->dropped.load(std::memory_order_relaxed);
+    return total;
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// 热路径事件日志：定长二进制记录写入每个线程私有的无锁 SPSC 环，
+// 后台线程批量落盘，tools/EventLogDecode 离线转成文本。
+// 生产者只读一次时钟、拷贝一条 72 字节记录，不格式化、不加锁、不做系统调用；
+// 环满时丢弃记录并计数，不阻塞撮合。spdlog 只保留启动、连接、告警等生命周期日志。
+
+enum class EventType : uint8_t
+{
+    ORDER_RECEIVED = 1,  // I/O 线程解码出新订单
+    CANCEL_RECEIVED = 2, // I/O 线程解码出撤单
+    ORDER_REJECTED = 3,  // 订单被拒，code 为 RejectReason
+    ORDER_CANCELED = 4,  // 撤单成功
+    CANCEL_REJECTED = 5, // 撤单失败，code 为 RejectReason
+    REPORT_SENT = 6,     // 回报写入发送缓冲区，code 为 ExecType
+    MESSAGE_INVALID = 7, // 帧或消息体非法，code 为 RejectReason，aux 为消息类型 / 长度
+    ORDER_EXPIRED = 8,   // 市价 / IOC / FOK 单未成交部分撤销，code 为 OrderType，aux 为撤销数量
+    REPLACE_RECEIVED = 9,  // I/O 线程解码出改单
+    ORDER_REPLACED = 10,   // 改单成功，price / quantity 为新值，aux 为改单前的剩余数量
+    REPLACE_REJECTED = 11, // 改单失败，code 为 RejectReason
+    MASS_CANCEL_RECEIVED = 12, // I/O 线程解码出批量撤单，code 为范围，aux 为方向，order_id 处为 user_id
+    MASS_CANCELED = 13,        // 一个分片执行完批量撤单，code 为范围，quantity 为撤销笔数，aux 为方向
+};
+
+enum class RejectReason : uint8_t
+{
+    NONE = 0,
+    OFF_GRID_PRICE = 1,
+    DUPLICATE_ORDER_ID = 2,
+    POOL_EXHAUSTED = 3,
+    UNKNOWN_SYMBOL = 4,
+    ORDER_NOT_FOUND = 5,
+    MALFORMED = 6,
+    BAD_MAGIC = 7,
+    UNKNOWN_MESSAGE_TYPE = 8,
+    INVALID_QUANTITY = 9,
+    RISK_ORDER_SIZE = 10,  // 风控：单笔数量超限
+    RISK_PRICE_BAND = 11,  // 风控：价格偏离最近成交价超出价格带
+    RISK_OPEN_ORDERS = 12, // 风控：用户未结订单笔数超限
+    RISK_NOTIONAL = 13,    // 风控：用户未结名义金额超限
+    RISK_NO_REFERENCE = 14, // 风控：市价单所在品种尚无成交价，无法估算名义金额
+    USER_MISMATCH = 15,     // 改单的 user_id 与订单所属用户不符
+    RISK_NO_USER = 16,      // 风控：旧格式改单不带 user_id，不能增加名义金额
+};
+
+#pragma pack(push, 1)
+struct EventRecord
+{
+    uint64_t timestamp_ns; // CLOCK_REALTIME
+    EventType type;
+    uint8_t code;          // side / exec_type / RejectReason，依 type 而定
+    uint16_t thread_id;    // 生产者线程在日志内的编号
+    uint32_t symbol_id;
+    uint64_t conn_id;
+    double price;
+    int32_t quantity;
+    int32_t aux;           // leaves_qty / 消息长度等
+    char order_id[32];     // 不足 32 字节补 0
+};
+#pragma pack(pop)
+static_assert(sizeof(EventRecord) == 72, "EventRecord layout is part of the file format");
+
+// 文件格式：EventLogHeader 后紧跟若干 EventRecord（小端）
+struct EventLogHeader
+{
+    char magic[8];        // "MEEVLOG\0"
+    uint32_t version;     // 1
+    uint32_t record_size; // sizeof(EventRecord)
+};
+static_assert(sizeof(EventLogHeader) == 16, "EventLogHeader layout is part of the file format");
+
+inline constexpr char EVENT_LOG_MAGIC[8] = {'M', 'E', 'E', 'V', 'L', 'O', 'G', '\0'};
+inline constexpr uint32_t EVENT_LOG_VERSION = 1;
+
+inline const char *eventTypeName(EventType type)
+{
+    switch (type)
+    {
+    case EventType::ORDER_RECEIVED: return "ORDER_RECEIVED";
+    case EventType::CANCEL_RECEIVED: return "CANCEL_RECEIVED";
+    case EventType::ORDER_REJECTED: return "ORDER_REJECTED";
+    case EventType::ORDER_CANCELED: return "ORDER_CANCELED";
+    case EventType::CANCEL_REJECTED: return "CANCEL_REJECTED";
+    case EventType::REPORT_SENT: return "REPORT_SENT";
+    case EventType::MESSAGE_INVALID: return "MESSAGE_INVALID";
+    case EventType::ORDER_EXPIRED: return "ORDER_EXPIRED";
+    case EventType::REPLACE_RECEIVED: return "REPLACE_RECEIVED";
+    case EventType::ORDER_REPLACED: return "ORDER_REPLACED";
+    case EventType::REPLACE_REJECTED: return "REPLACE_REJECTED";
+    case EventType::MASS_CANCEL_RECEIVED: return "MASS_CANCEL_RECEIVED";
+    case EventType::MASS_CANCELED: return "MASS_CANCELED";
+    }
+    return "UNKNOWN";
+}
+
+inline const char *rejectReasonName(RejectReason reason)
+{
+    switch (reason)
+    {
+    case RejectReason::NONE: return "NONE";
+    case RejectReason::OFF_GRID_PRICE: return "OFF_GRID_PRICE";
+    case RejectReason::DUPLICATE_ORDER_ID: return "DUPLICATE_ORDER_ID";
+    case RejectReason::POOL_EXHAUSTED: return "POOL_EXHAUSTED";
+    case RejectReason::UNKNOWN_SYMBOL: return "UNKNOWN_SYMBOL";
+    case RejectReason::ORDER_NOT_FOUND: return "ORDER_NOT_FOUND";
+    case RejectReason::MALFORMED: return "MALFORMED";
+    case RejectReason::BAD_MAGIC: return "BAD_MAGIC";
+    case RejectReason::UNKNOWN_MESSAGE_TYPE: return "UNKNOWN_MESSAGE_TYPE";
+    case RejectReason::INVALID_QUANTITY: return "INVALID_QUANTITY";
+    case RejectReason::RISK_ORDER_SIZE: return "RISK_ORDER_SIZE";
+    case RejectReason::RISK_PRICE_BAND: return "RISK_PRICE_BAND";
+    case RejectReason::RISK_OPEN_ORDERS: return "RISK_OPEN_ORDERS";
+    case RejectReason::RISK_NOTIONAL: return "RISK_NOTIONAL";
+    case RejectReason::RISK_NO_REFERENCE: return "RISK_NO_REFERENCE";
+    case RejectReason::USER_MISMATCH: return "USER_MISMATCH";
+    case RejectReason::RISK_NO_USER: return "RISK_NO_USER";
+    }
+    return "UNKNOWN";
+}
+
+class EventLog
+{
+public:
+    // 打开日志文件并启动落盘线程；ringCapacity 为每个生产者线程的环容量（条）
+    static bool open(const std::string &path, uint32_t ringCapacity);
+    // 停止落盘线程，写出剩余记录并关闭文件
+    static void close();
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // 热路径调用。orderId 指向 32 字节 id，可为 nullptr
+    static void write(EventType type, uint8_t code, uint32_t symbolId, uint64_t connId,
+                      double price, int32_t quantity, int32_t aux, const char *orderId)
+    {
+        if (!enabled())
+            return;
+        EventRecord rec;
+        rec.type = type;
+        rec.code = code;
+        rec.symbol_id = symbolId;
+        rec.conn_id = connId;
+        rec.price = price;
+        rec.quantity = quantity;
+        rec.aux = aux;
+        if (orderId)
+            std::memcpy(rec.order_id, orderId, sizeof(rec.order_id));
+        else
+            std::memset(rec.order_id, 0, sizeof(rec.order_id));
+        push(rec);
+    }
+
+    static uint64_t written();
+    static uint64_t dropped();
+
+private:
+    static void push(EventRecord &rec);
+
+    static std::atomic<bool> enabled_;
+};
@@ -0,0 +1,184 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// HDR 直方图：对数分桶、桶内线性分格，在 [1, highest] 范围内保持 significantDigits 位有效数字
+// （3 位即相对误差 < 0.1%），内存与记录开销都与样本数无关。记录只是一次数组自增，可以放在热路径上。
+// 计数布局与 HdrHistogram 的标准实现一致，输出的 .hgrm 文本可直接用其绘图工具打开。
+//
+// 非线程安全：每个线程一份，结束后用 add() 合并。
+class HdrHistogram
+{
+public:
+    explicit HdrHistogram(uint64_t highest = 3600ull * 1000000000ull, int significantDigits = 3)
+        : highest_(highest)
+    {
+        uint64_t largestSingleUnit = 2 * static_cast<uint64_t>(std::pow(10, significantDigits));
+        int subBucketCountMagnitude = static_cast<int>(std::ceil(std::log2(static_cast<double>(largestSingleUnit))));
+        subBucketHalfCountMagnitude_ = std::max(subBucketCountMagnitude, 1) - 1;
+        subBucketCount_ = 1ull << (subBucketHalfCountMagnitude_ + 1);
+        subBucketHalfCount_ = subBucketCount_ / 2;
+        subBucketMask_ = subBucketCount_ - 1;
+
+        uint64_t trackable = subBucketCount_;
+        int buckets = 1;
+        while (trackable <= highest)
+        {
+            if (trackable > (UINT64_MAX >> 1))
+            {
+                ++buckets;
+                break;
+            }
+            trackable <<= 1;
+            ++buckets;
+        }
+        bucketCount_ = buckets;
+        counts_.assign(static_cast<size_t>(buckets + 1) * subBucketHalfCount_, 0);
+    }
+
+    void record(uint64_t value)
+    {
+        if (value > highest_)
+        {
+            ++clamped_;
+            value = highest_;
+        }
+        ++counts_[countsIndex(value)];
+        ++total_;
+        max_ = std::max(max_, value);
+        min_ = std::min(min_, value);
+        sum_ += static_cast<double>(value);
+    }
+
+    void add(const HdrHistogram &other)
+    {
+        size_t n = std::min(counts_.size(), other.counts_.size());
+        for (size_t i = 0; i < n; ++i)
+            counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        clamped_ += other.clamped_;
+        max_ = std::max(max_, other.max_);
+        min_ = std::min(min_, other.min_);
+        sum_ += other.sum_;
+    }
+
+    void reset()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        total_ = clamped_ = max_ = 0;
+        min_ = UINT64_MAX;
+        sum_ = 0;
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t clamped() const { return clamped_; } // 超过 highest、按 highest 记录的样本数
+    uint64_t max() const { return max_; }
+    uint64_t min() const { return total_ == 0 ? 0 : min_; }
+    double mean() const { return total_ == 0 ? 0.0 : sum_ / static_cast<double>(total_); }
+
+    // 不小于 percentile% 样本的最小值（所在格的上界）
+    uint64_t valueAtPercentile(double percentile) const
+    {
+        if (total_ == 0)
+            return 0;
+        double p = std::min(std::max(percentile, 0.0), 100.0);
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(total_))));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            seen += counts_[i];
+            if (seen >= target)
+                return std::min(highestEquivalent(valueFromIndex(i)), max_);
+        }
+        return max_;
+    }
+
+    // HdrHistogram 百分位分布格式，值除以 scale 输出（纳秒样本 scale=1000 即以微秒输出）
+    void writePercentiles(FILE *out, double scale) const
+    {
+        std::fprintf(out, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+        // 每接近 100% 一半距离输出 5 个点，与标准工具的默认刻度一致
+        for (int tick = 0;; ++tick)
+        {
+            double p = 100.0 * (1.0 - std::pow(0.5, tick / 5.0));
+            uint64_t value = valueAtPercentile(p);
+            uint64_t below = countAtOrBelow(value);
+            double fraction = static_cast<double>(below) / static_cast<double>(std::max<uint64_t>(total_, 1));
+            if (fraction >= 1.0 || p >= 99.9999)
+            {
+                std::fprintf(out, "%12.3f %14.12f %10llu\n", static_cast<double>(max_) / scale, 1.0,
+                             static_cast<unsigned long long>(total_));
+                break;
+            }
+            std::fprintf(out, "%12.3f %14.12f %10llu %14.2f\n", static_cast<double>(value) / scale, p / 100.0,
+                         static_cast<unsigned long long>(below), 1.0 / (1.0 - p / 100.0));
+        }
+        double variance = 0.0;
+        for (size_t i = 0; i < counts_.size(); ++i)
+        {
+            if (counts_[i] == 0)
+                continue;
+            double d = static_cast<double>(medianEquivalent(valueFromIndex(i))) - mean();
+            variance += d * d * static_cast<double>(counts_[i]);
+        }
+        double stddev = total_ == 0 ? 0.0 : std::sqrt(variance / static_cast<double>(total_));
+        std::fprintf(out, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean() / scale, stddev / scale);
+        std::fprintf(out, "#[Max     = %12.3f, Total count    = %12llu]\n", static_cast<double>(max_) / scale,
+                     static_cast<unsigned long long>(total_));
+        std::fprintf(out, "#[Buckets = %12d, SubBuckets     = %12llu]\n", bucketCount_,
+                     static_cast<unsigned long long>(subBucketCount_));
+    }
+
+private:
+    size_t countsIndex(uint64_t value) const
+    {
+        int bucket = 63 - subBucketHalfCountMagnitude_ - __builtin_clzll(value | subBucketMask_);
+        uint64_t sub = value >> bucket;
+        return (static_cast<size_t>(bucket + 1) << subBucketHalfCountMagnitude_) + (sub - subBucketHalfCount_);
+    }
+
+    uint64_t valueFromIndex(size_t index) const
+    {
+        int bucket = static_cast<int>(index >> subBucketHalfCountMagnitude_) - 1;
+        uint64_t sub = (index & (subBucketHalfCount_ - 1)) + subBucketHalfCount_;
+        if (bucket < 0)
+        {
+            sub -= subBucketHalfCount_;
+            bucket = 0;
+        }
+        return sub << bucket;
+    }
+
+    uint64_t unitSize(uint64_t value) const
+    {
+        int bucket = 63 - subBucketHalfCountMagnitude_ - __builtin_clzll(value | subBucketMask_);
+        return 1ull << bucket;
+    }
+    uint64_t highestEquivalent(uint64_t value) const { return value + unitSize(value) - 1; }
+    uint64_t medianEquivalent(uint64_t value) const { return value + unitSize(value) / 2; }
+
+    uint64_t countAtOrBelow(uint64_t value) const
+    {
+        uint64_t seen = 0;
+        size_t last = countsIndex(std::min(value, highest_));
+        for (size_t i = 0; i <= last && i < counts_.size(); ++i)
+            seen += counts_[i];
+        return seen;
+    }
+
+    uint64_t highest_;
+    int subBucketHalfCountMagnitude_;
+    uint64_t subBucketCount_;
+    uint64_t subBucketHalfCount_;
+    uint64_t subBucketMask_;
+    int bucketCount_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t clamped_ = 0;
+    uint64_t max_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    double sum_ = 0.0;
+};
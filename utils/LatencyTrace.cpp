@@ -0,0 +1,122 @@
+#include "LatencyTrace.h"
+
+#ifdef LATENCY_TRACE_ENABLED
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+namespace
+{
+constexpr size_t STAGES = static_cast<size_t>(TraceStage::COUNT);
+
+struct TracedThread
+{
+    std::string name;
+    std::unique_ptr<TraceHistogram[]> histograms{new TraceHistogram[STAGES]};
+    // 上次 dump 时的计数快照：dump 输出区间增量，不必清零所属线程正在写的计数
+    std::vector<uint64_t> lastCounts = std::vector<uint64_t>(STAGES * TraceHistogram::SLOTS, 0);
+};
+
+uint64_t steadyNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+struct Registry
+{
+    std::mutex mutex; // 保护 threads 列表（线程首次记录时注册）与 dump 快照
+    std::vector<std::unique_ptr<TracedThread>> threads;
+    // 换算基准：首次使用时的 TSC 与 steady_clock，dump 时用两者的增量之比校准
+    uint64_t baseTicks = LatencyTrace::now();
+    uint64_t baseNs = steadyNs();
+};
+
+Registry &registry()
+{
+    static Registry r;
+    return r;
+}
+
+thread_local TracedThread *tlsThread = nullptr;
+
+double ticksPerNs(const Registry &r)
+{
+    uint64_t ns = steadyNs() - r.baseNs;
+    uint64_t ticks = LatencyTrace::now() - r.baseTicks;
+    return ns == 0 || ticks == 0 ? 1.0 : static_cast<double>(ticks) / static_cast<double>(ns);
+}
+} // namespace
+
+thread_local TraceHistogram *LatencyTrace::local_ = nullptr;
+thread_local uint64_t LatencyTrace::ingress_ = 0;
+
+TraceHistogram *LatencyTrace::registerThread()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.threads.push_back(std::make_unique<TracedThread>());
+    tlsThread = r.threads.back().get();
+    tlsThread->name = "thread " + std::to_string(r.threads.size() - 1);
+    return tlsThread->histograms.get();
+}
+
+void LatencyTrace::setThreadName(const std::string &name)
+{
+    histograms();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    tlsThread->name = name;
+}
+
+void LatencyTrace::dump()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    double scale = ticksPerNs(r);
+    constexpr double PERCENTILES[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+    spdlog::info("Latency trace (ns, since last dump, {:.3f} ticks/ns):", scale);
+    std::vector<uint64_t> delta(TraceHistogram::SLOTS);
+    for (auto &thread : r.threads)
+    {
+        for (size_t s = 0; s < STAGES; ++s)
+        {
+            TraceHistogram &h = thread->histograms[s];
+            uint64_t *last = thread->lastCounts.data() + s * TraceHistogram::SLOTS;
+            // 所属线程可能同时在写：各格分别读取，样本数以本次读到的格计数之和为准
+            uint64_t samples = 0;
+            for (size_t i = 0; i < TraceHistogram::SLOTS; ++i)
+            {
+                uint64_t c = h.counts[i].load(std::memory_order_relaxed);
+                delta[i] = c - last[i];
+                last[i] = c;
+                samples += delta[i];
+            }
+            if (samples == 0)
+                continue;
+
+            uint64_t values[sizeof(PERCENTILES) / sizeof(PERCENTILES[0])] = {};
+            size_t next = 0;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < TraceHistogram::SLOTS && next < std::size(values); ++i)
+            {
+                seen += delta[i];
+                while (next < std::size(values) &&
+                       static_cast<double>(seen) >= PERCENTILES[next] / 100.0 * static_cast<double>(samples))
+                {
+                    values[next++] = TraceHistogram::upperBound(i);
+                }
+            }
+            auto ns = [scale](uint64_t ticks)
+            { return static_cast<uint64_t>(static_cast<double>(ticks) / scale); };
+            spdlog::info("  [{}] {:<18} n={} p50={} p90={} p99={} p99.9={} p99.99={} max_since_start={}", thread->name,
+                         traceStageName(static_cast<TraceStage>(s)), samples, ns(values[0]), ns(values[1]),
+                         ns(values[2]), ns(values[3]), ns(values[4]),
+                         ns(h.max.load(std::memory_order_relaxed)));
+        }
+    }
+}
+#endif
@@ -0,0 +1,152 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// 热路径分阶段延迟追踪：每条入站消息在各阶段边界打一个 TSC 时间戳，阶段耗时记入当前线程私有的直方图。
+// 直方图只有所属线程写入（计数用 relaxed load + store，不带 lock 前缀），dump 时任意线程都可以读取，
+// 因此热路径上没有锁、没有共享写；每个阶段只多一次 rdtsc 和一次数组自增，可以常开。
+// 时间戳是原始 TSC 计数，dump 时按首次记录以来 TSC 与 steady_clock 的增量之比换算成纳秒。
+//
+// 编译开关：cmake -DENABLE_LATENCY_TRACE=OFF 时下面的宏全部展开为空，EngineCommand 等结构也不带追踪字段。
+
+enum class TraceStage : uint8_t
+{
+    EPOLL_DISPATCH = 0, // epoll_wait 返回 → 开始读该连接（同一轮中排在前面的连接耗时）
+    RECV,               // 一次 recv 系统调用
+    DECODE,             // MessageCodec::decode 一帧
+    DESERIALIZE,        // Order::deserialize
+    RISK,               // 风控阶段：I/O 线程入队 → 风控线程检查完毕、转发给撮合分片
+    QUEUE,              // 线程模式：I/O 线程（启用风控时为风控线程）入队 → 分片出队
+    MATCH,              // 撮合 / 撤单一条指令（含回调中产生的回报）
+    REPORT,             // sendExecutionReport：编码回报并追加到发送缓冲区
+    INGRESS_TO_REPORT,  // 帧开始解码 → 该消息的回报进入发送缓冲区（端到端，不含写 socket）
+    FLUSH,              // 一个连接的 writev（I/O 线程或出口线程）
+    COUNT
+};
+
+inline const char *traceStageName(TraceStage stage)
+{
+    switch (stage)
+    {
+    case TraceStage::EPOLL_DISPATCH: return "epoll_dispatch";
+    case TraceStage::RECV: return "recv";
+    case TraceStage::DECODE: return "decode";
+    case TraceStage::DESERIALIZE: return "deserialize";
+    case TraceStage::RISK: return "risk";
+    case TraceStage::QUEUE: return "queue";
+    case TraceStage::MATCH: return "match";
+    case TraceStage::REPORT: return "report";
+    case TraceStage::INGRESS_TO_REPORT: return "ingress_to_report";
+    case TraceStage::FLUSH: return "flush";
+    case TraceStage::COUNT: break;
+    }
+    return "unknown";
+}
+
+#ifdef LATENCY_TRACE_ENABLED
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// 单写者直方图：对数分桶、每桶 32 格（相对误差 < 3.2%），覆盖 [0, 2^48) 个 tick
+struct TraceHistogram
+{
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB_COUNT = 1ull << SUB_BITS;
+    static constexpr int MAX_BITS = 48;
+    static constexpr size_t SLOTS = SUB_COUNT * (MAX_BITS - SUB_BITS + 1);
+
+    static size_t index(uint64_t value)
+    {
+        if (value >= (1ull << MAX_BITS))
+            value = (1ull << MAX_BITS) - 1;
+        if (value < SUB_COUNT)
+            return static_cast<size_t>(value);
+        int shift = 63 - __builtin_clzll(value) - SUB_BITS;
+        return static_cast<size_t>(SUB_COUNT * (shift + 1) + ((value >> shift) - SUB_COUNT));
+    }
+
+    // 格内最大值，百分位按上界报告
+    static uint64_t upperBound(size_t index)
+    {
+        if (index < SUB_COUNT)
+            return index;
+        int shift = static_cast<int>(index / SUB_COUNT) - 1;
+        uint64_t sub = index % SUB_COUNT + SUB_COUNT;
+        return (sub << shift) + (1ull << shift) - 1;
+    }
+
+    void record(uint64_t ticks)
+    {
+        bump(counts[index(ticks)], 1);
+        if (ticks > max.load(std::memory_order_relaxed))
+            max.store(ticks, std::memory_order_relaxed);
+    }
+
+    static void bump(std::atomic<uint64_t> &counter, uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> counts[SLOTS] = {};
+    std::atomic<uint64_t> max{0};
+};
+
+class LatencyTrace
+{
+public:
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // 记录 start 到现在的耗时，返回当前时间戳，便于串联下一阶段
+    static uint64_t record(TraceStage stage, uint64_t start)
+    {
+        uint64_t end = now();
+        histograms()[static_cast<size_t>(stage)].record(end - start);
+        return end;
+    }
+
+    // 当前线程正在处理的消息的入站时间戳（内联模式下回报回调据此计算端到端耗时）
+    static void setIngress(uint64_t ticks) { ingress_ = ticks; }
+    static uint64_t ingress() { return ingress_; }
+
+    // 给当前线程命名（dump 中显示），未命名的线程首次记录时按注册顺序编号
+    static void setThreadName(const std::string &name);
+
+    // 输出每个线程、每个阶段自上次 dump 以来的样本数与分位数（spdlog，单位纳秒）
+    static void dump();
+
+private:
+    static TraceHistogram *histograms()
+    {
+        if (!local_)
+            local_ = registerThread();
+        return local_;
+    }
+    static TraceHistogram *registerThread();
+
+    static thread_local TraceHistogram *local_;
+    static thread_local uint64_t ingress_;
+};
+
+#define LATENCY_TRACE_STAMP(var) [[maybe_unused]] uint64_t var = LatencyTrace::now()
+#define LATENCY_TRACE_RECORD(stage, start) LatencyTrace::record(TraceStage::stage, start)
+#define LATENCY_TRACE_ONLY(...) __VA_ARGS__
+
+#else
+
+#define LATENCY_TRACE_STAMP(var)
+#define LATENCY_TRACE_RECORD(stage, start) ((void)0)
+#define LATENCY_TRACE_ONLY(...)
+
+#endif
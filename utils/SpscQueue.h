@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// 单生产者 / 单消费者无锁环形队列。
+// 容量取 2 的幂，head/tail 分别独占缓存行，并各自缓存对端下标以减少跨核读取。
+template <typename T>
+class SpscQueue
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SpscQueue element must be trivially copyable");
+
+public:
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t cap = 2;
+        while (cap < capacity)
+            cap <<= 1;
+        mask_ = cap - 1;
+        buffer_ = std::make_unique<T[]>(cap);
+    }
+
+    // 生产者调用，队列满时返回 false
+    bool push(const T &item)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headCache_ > mask_)
+        {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail - headCache_ > mask_)
+                return false;
+        }
+        buffer_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者调用，队列空时返回 nullptr；处理完后调用 pop() 释放槽位
+    const T *front()
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tailCache_)
+        {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head == tailCache_)
+                return nullptr;
+        }
+        return &buffer_[head & mask_];
+    }
+
+    void pop()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // 近似深度，供监控使用
+    size_t size() const
+    {
+        size_t head = head_.load(std::memory_order_acquire);
+        return tail_.load(std::memory_order_acquire) - head;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    alignas(CACHE_LINE) std::atomic<size_t> head_{0}; // 消费者写
+    size_t tailCache_ = 0;                            // 消费者缓存的 tail
+    alignas(CACHE_LINE) std::atomic<size_t> tail_{0}; // 生产者写
+    size_t headCache_ = 0;                            // 生产者缓存的 head
+    alignas(CACHE_LINE) size_t mask_;
+    std::unique_ptr<T[]> buffer_;
+};
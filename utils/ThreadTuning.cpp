@@ -0,0 +1,30 @@
+#include "ThreadTuning.h"
+#include <pthread.h>
+#include <sched.h>
+#include <cstring>
+#include <spdlog/spdlog.h>
+
+void applyThreadOptions(const std::string &name, const ThreadOptions &options)
+{
+    if (options.cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(options.cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0)
+            spdlog::warn("Cannot pin {} to CPU {}: {}", name, options.cpu, strerror(err));
+        else
+            spdlog::info("Pinned {} to CPU {}", name, options.cpu);
+    }
+    if (options.rt_priority > 0)
+    {
+        sched_param param{};
+        param.sched_priority = options.rt_priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0)
+            spdlog::warn("Cannot set SCHED_FIFO priority {} for {}: {}", options.rt_priority, name, strerror(err));
+        else
+            spdlog::info("{} running with SCHED_FIFO priority {}", name, options.rt_priority);
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <sched.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// 低延迟线程配置：空闲策略、CPU 绑定与实时调度。
+// 默认（BLOCK、不绑核、普通调度）与原先的行为完全相同。
+
+// 事件循环 / 撮合线程一轮没有取到任何工作时的做法
+enum class IdleStrategy : uint8_t
+{
+    BLOCK,      // 阻塞在 epoll_wait / eventfd 上，由生产者唤醒（省 CPU，唤醒要经过调度器）
+    SPIN_YIELD, // 先空转 idle_spin_us 微秒，之后每轮空转让出一次 CPU
+    SPIN        // 一直空转，独占一个核心，没有调度唤醒延迟
+};
+
+struct ThreadOptions
+{
+    IdleStrategy idle = IdleStrategy::BLOCK;
+    uint32_t idle_spin_us = 100; // SPIN_YIELD：连续空闲多久后开始让出 CPU
+    int cpu = -1;                // 绑定的 CPU 编号，-1 不绑定
+    int rt_priority = 0;         // SCHED_FIFO 优先级（1-99），0 保持普通调度
+};
+
+// 在线程自己的入口处调用：按 options 绑核并切换调度策略。
+// 失败（CPU 不存在、没有 CAP_SYS_NICE 等）只记录警告，线程照常运行
+void applyThreadOptions(const std::string &name, const ThreadOptions &options);
+
+// 空转节拍：有工作时调用 busy()，一轮没有工作时调用 idle()（BLOCK 策略由调用方自己阻塞，不会调用）
+class IdleSpinner
+{
+public:
+    explicit IdleSpinner(const ThreadOptions &options)
+        : strategy_(options.idle), spinLimit_(std::chrono::microseconds(options.idle_spin_us))
+    {
+    }
+
+    bool blocks() const { return strategy_ == IdleStrategy::BLOCK; }
+
+    void busy() { idling_ = false; }
+
+    void idle()
+    {
+        if (strategy_ == IdleStrategy::SPIN_YIELD)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (!idling_)
+            {
+                idling_ = true;
+                idleSince_ = now;
+            }
+            else if (now - idleSince_ >= spinLimit_)
+            {
+                sched_yield();
+                return;
+            }
+        }
+        pause();
+    }
+
+private:
+    static void pause()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause(); // 降低空转对同核超线程的干扰
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    IdleStrategy strategy_;
+    std::chrono::steady_clock::duration spinLimit_;
+    std::chrono::steady_clock::time_point idleSince_;
+    bool idling_ = false;
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// 基于 eventfd 的休眠 / 唤醒。消费者空闲时登记 sleeping_ 后阻塞在 eventfd 上，
+// 生产者仅在对方确实休眠时才写 eventfd，忙时不产生系统调用。
+class WaitNotifier
+{
+public:
+    WaitNotifier() : fd_(eventfd(0, EFD_CLOEXEC)) {}
+    ~WaitNotifier() { close(fd_); }
+    WaitNotifier(const WaitNotifier &) = delete;
+    WaitNotifier &operator=(const WaitNotifier &) = delete;
+
+    // 消费者调用：ready() 为 false 时阻塞，直到被 notify()（可能虚假返回，调用方需循环）
+    template <typename Ready>
+    void wait(Ready ready)
+    {
+        waitWith(ready, [this]
+                 { consume(); });
+    }
+
+    // 同 wait()，但由调用方决定如何阻塞（例如与其他 fd 一起 epoll_wait，此时需监听 fd()）
+    template <typename Ready, typename Block>
+    void waitWith(Ready ready, Block block)
+    {
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ready())
+        {
+            block();
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+    // 读掉 eventfd 计数（fd 可读时调用不会阻塞）
+    void consume()
+    {
+        uint64_t value;
+        ssize_t n = read(fd_, &value, sizeof(value));
+        (void)n;
+    }
+
+    int fd() const { return fd_; }
+
+    // 生产者调用：发布数据之后调用
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed))
+        {
+            uint64_t one = 1;
+            ssize_t n = write(fd_, &one, sizeof(one));
+            (void)n;
+        }
+    }
+
+    // 无条件唤醒（用于停止等待中的线程）
+    void wake()
+    {
+        uint64_t one = 1;
+        ssize_t n = write(fd_, &one, sizeof(one));
+        (void)n;
+    }
+
+private:
+    int fd_;
+    std::atomic<bool> sleeping_{false};
+};